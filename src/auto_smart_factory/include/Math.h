@@ -61,9 +61,18 @@ public:
 	static bool doesLineSegmentIntersectNonInflatedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 	static bool isPointInRectangle(const Point& p, const Rectangle& rectangle);
 	static bool isPointInNonInflatedRectangle(const Point& p, const Rectangle& rectangle);
+	
+	// Exact time ranges of timed reservations, false if the reservation never covers the segment/point
+	static bool getReservedTimeRangeOnLineSegment(const Point& lStart, const Point& lEnd, const Rectangle& reservation, double& start, double& end);
+	static bool getReservedTimeRangeAtPoint(const Point& p, const Rectangle& reservation, double& start, double& end);
+	
+	// Conflict between reservations of two robots: their non-inflated areas overlap while both reservations hold the overlapping part
+	static bool doReservationsConflict(const Rectangle& r1, const Rectangle& r2);
 
 	static double projectPointOnLineSegment(const Point& lStart, const Point& lEnd, const Point& point);
 	static double getDistanceToLineSegment(const Point& lStart, const Point& lEnd, const Point& point);
+	static double getDistanceBetweenLineSegments(const Point& l1Start, const Point& l1End, const Point& l2Start, const Point& l2End);
+	static bool getLineSegmentRangeNearLineSegment(const Point& lStart, const Point& lEnd, const Point& qStart, const Point& qEnd, double distance, double& fromAlpha, double& toAlpha);
 	static int getDirectionToLineSegment(const Point& lStart, const Point& lEnd, const Point& point);
 
 	static double getDistanceToLine(const Point& lStart, const Point& lEnd, const Point& point);
@@ -84,6 +93,11 @@ private:
 	static bool doesLineSegmentIntersectAxisAlignedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 	static bool doesLineSegmentIntersectNonAxisAlignedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 	static bool isPointInAxisAlignedRectangle(const Point& p, const Rectangle& rectangle);
+	static bool doesLineSegmentIntersectCapsule(const Point& lStart, const Point& lEnd, const Rectangle& capsule);
+	static bool isPointInCapsule(const Point& p, const Rectangle& capsule);
+	static bool getAxisRangeNearReservation(const Rectangle& capsule, const Rectangle& other, double& fromAlpha, double& toAlpha);
+	static bool doNonInflatedRectanglesOverlap(const Rectangle& r1, const Rectangle& r2);
+	static void clipLineRange(double offset, double slope, double min, double max, double& fromAlpha, double& toAlpha);
 };
 
 #endif //PROJECT_MATH_H
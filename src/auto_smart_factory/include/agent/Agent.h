@@ -44,6 +44,7 @@
 
 // forward declaration of TaskHandler class
 class TaskHandler;
+class AgentHost;
 
 /* The agent component manages all robot related stuff and holds a motion planner, obstacle detection &
  * gripper instance. Furthermore it subscribes to robots sensor topics like pose, laser & battery sensor
@@ -56,6 +57,12 @@ public:
 	 * @param agent_id: id of this agent */
 	Agent(std::string agent_id);
 
+	/* Constructor for an agent hosted together with other agents in one process (see AgentHost).
+	 * @param agent_id: id of this agent
+	 * @param agent_node_handle: node handle for the services, topics and parameters of this agent
+	 * @param agent_host: the host, which provides the shared map and the reservation broadcasts */
+	Agent(std::string agent_id, ros::NodeHandle agent_node_handle, AgentHost* agent_host);
+
 	virtual ~Agent();
 
 	/* Returns ID of this agent */
@@ -169,6 +176,12 @@ protected:
 	// ROS Nodehandle
 	ros::NodeHandle n;
 
+	// Node handle of this agent. The private node handle of the agent process or the namespace of the agent id if hosted
+	ros::NodeHandle pn;
+
+	// Host of this agent, nullptr if the agent runs in its own process
+	AgentHost* host;
+
 	// ID of this agent
 	std::string agentID;
 	int agentIdInt;
@@ -0,0 +1,81 @@
+#ifndef AUTO_SMART_FACTORY_SRC_AGENTHOST_H_
+#define AUTO_SMART_FACTORY_SRC_AGENTHOST_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_set>
+
+#include "ros/ros.h"
+#include "auto_smart_factory/ReservationBroadcast.h"
+#include "auto_smart_factory/WarehouseConfiguration.h"
+#include "agent/path_planning/Map.h"
+#include "agent/path_planning/ReservationManager.h"
+#include "agent/path_planning/ReservationSynchronizer.h"
+#include "agent/path_planning/RobotHardwareProfile.h"
+
+class Agent;
+
+/* Hosts several agents in one process. The static obstacles, the theta* map and the reservations are held once in a shared map,
+ * every agent plans on a view of it (see Map). Reservation broadcasts are decoded and applied to the shared reservations once and
+ * then handed to the reservation managers of all agents. Everything runs on the thread which calls update */
+class AgentHost {
+public:
+	/* Constructor, creates the agents. Each agent uses the namespace of its id for services, topics and parameters, like an agent in its own process
+	 * @param agentIds: ids of the hosted agents */
+	AgentHost(const std::vector<std::string>& agentIds);
+
+	virtual ~AgentHost();
+
+	/* Updates all agents, called every tick (see AgentHostNode.cpp) */
+	void update();
+
+	/* Returns the map for a hosted agent. The first call builds the shared map, later calls return views of it.
+	 * Agents with a different warehouse configuration get their own map
+	 * @param warehouseConfig: the warehouse configuration of the agent
+	 * @param obstacles: static obstacles
+	 * @param hardwareProfile: hardware profile of the agent
+	 * @param agentId: id of the agent
+	 * @param thetaStarMapArtifactPath: path of the precomputed theta* map, empty to build it (see ThetaStarMapArtifact)
+	 * @return The map, owned by the agent */
+	Map* createAgentMap(const auto_smart_factory::WarehouseConfiguration& warehouseConfig, std::vector<Rectangle>& obstacles, RobotHardwareProfile* hardwareProfile,
+	                    int agentId, const std::string& thetaStarMapArtifactPath);
+
+	/* Registers the reservation manager of a hosted agent to receive the reservation broadcasts
+	 * @param agentId: id of the agent
+	 * @param reservationManager: the reservation manager, must use the map created by createAgentMap for the agent */
+	void registerReservationManager(int agentId, ReservationManager* reservationManager);
+
+private:
+	/* Applies a broadcast to the shared reservations and hands it to all reservation managers
+	 * @param msg: the received message */
+	void reservationBroadcastCallback(const auto_smart_factory::ReservationBroadcast& msg);
+
+	ros::NodeHandle n;
+
+	// Hosted agents
+	std::vector<Agent*> agents;
+
+	// Map holding the data shared by all agent maps. Belongs to no agent, it is only used to apply reservation changes
+	std::unique_ptr<Map> sharedMap;
+
+	// Keeps the shared reservations in sync with the reservation master
+	ReservationSynchronizer sharedMapSynchronizer;
+
+	// Hash of the warehouse configuration the shared map was built for
+	uint64_t sharedMapConfigHash = 0;
+
+	// Reservation managers of the agents using the shared map
+	std::vector<ReservationManager*> reservationManagers;
+
+	// Reservation managers of agents with their own map, these apply broadcasts to their map themselves
+	std::vector<ReservationManager*> ownMapReservationManagers;
+
+	// Ids of the agents which could not use the shared map
+	std::unordered_set<int> agentsWithOwnMap;
+
+	ros::Subscriber reservationBroadcast_sub;
+};
+
+#endif /* AUTO_SMART_FACTORY_SRC_AGENTHOST_H_ */
@@ -0,0 +1,96 @@
+#ifndef PROTOTYPE_CLUSTERGRAPH_HPP
+#define PROTOTYPE_CLUSTERGRAPH_HPP
+
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+#include "agent/path_planning/GridNode.h"
+#include "agent/path_planning/Point.h"
+
+/* Abstract graph for hierarchical path planning (HPA*) on large theta* maps. The nodes are split into square clusters. Neighbouring clusters
+ * are connected by entrances, one per continuous section of their shared border. Entrances of the same cluster are connected by their static
+ * shortest path length inside the cluster. Path queries first search this graph and then only expand the clusters the abstract path passes through.
+ * Only node ids are stored, so the graph does not depend on the node objects and can be shared by copies of a theta* map */
+class ClusterGraph {
+public:
+	/** Constructor, computes the entrances and their connections from the static links of the nodes
+	 * @param nodes All nodes of the theta* map
+	 * @param origin Position of the grid node with index (0, 0), the lower left corner of the first cluster
+	 * @param clusterWidth Edge length of a cluster */
+	ClusterGraph(const std::vector<const GridNode*>& nodes, const Point& origin, float clusterWidth);
+
+	/** Search the abstract path between two nodes and add the clusters it passes through to a corridor
+	 * @param start Start node
+	 * @param target Target node
+	 * @param corridor Flag per cluster id, the clusters of the abstract path are set to true (input/output, must have getClusterCount elements)
+	 * @return True iff an abstract path was found */
+	bool addToCorridor(const GridNode* start, const GridNode* target, std::vector<bool>& corridor) const;
+
+	/** Checks if a node is inside a corridor
+	 * @param node The node
+	 * @param corridor Flag per cluster id
+	 * @return True iff the cluster of the node is part of the corridor */
+	bool isInCorridor(const GridNode* node, const std::vector<bool>& corridor) const;
+
+	/** Returns the number of clusters. Cluster ids are in the range [0, getClusterCount())
+	 * @return Cluster count */
+	int getClusterCount() const;
+
+	/** Returns the number of entrances, the nodes of the abstract graph
+	 * @return Entrance count */
+	int getEntranceCount() const;
+
+private:
+	// A node at the border of a cluster through which the cluster can be entered from a neighbouring cluster
+	struct Entrance {
+		int nodeId;
+		Point pos;
+		int cluster;
+
+		// Connected entrances: (entrance index, static path length)
+		std::vector<std::pair<int, float>> edges;
+	};
+
+	// Lower left corner and edge length of the clusters
+	Point origin;
+	float clusterWidth;
+
+	// Cluster grid dimensions
+	int clusterColumns = 0;
+	int clusterRows = 0;
+
+	// Cluster id per node id
+	std::vector<int> clusterOfNode;
+
+	// Entrance index per node id, -1 if the node is no entrance
+	std::vector<int> entranceOfNode;
+
+	// Nodes of the abstract graph
+	std::vector<Entrance> entrances;
+
+	// Entrance indices per cluster id
+	std::vector<std::vector<int>> entrancesOfCluster;
+
+	/** Returns the id of the cluster which contains a position. Positions outside the cluster grid are clamped to its border
+	 * @param pos The position
+	 * @return Cluster id */
+	int getClusterOf(const Point& pos) const;
+
+	/** Returns the id of the cluster of a node
+	 * @param node The node
+	 * @return Cluster id */
+	int getClusterOf(const GridNode* node) const;
+
+	/** Returns the entrance at a node, creating it on first use
+	 * @param node The node
+	 * @return Entrance index */
+	int getOrAddEntrance(const GridNode* node);
+
+	/** Computes the static shortest path lengths from a node to all nodes of its cluster, only moving inside the cluster
+	 * @param source The node
+	 * @return Path length per reached node id */
+	std::unordered_map<int, float> getDistancesInCluster(const GridNode* source) const;
+};
+
+#endif //PROTOTYPE_CLUSTERGRAPH_HPP
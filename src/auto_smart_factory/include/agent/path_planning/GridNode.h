@@ -5,13 +5,17 @@
 
 #include "agent/path_planning/Point.h"
 
-/* Class to hold a theta star grid node data. Contains position and link to neighbours */
+/* Class to hold a theta star grid node data. Contains position, id and link to neighbours */
 class GridNode {
 public:
 	Point pos;
+	
+	// Unique index of this node inside its theta star map. Used to address per node search data
+	int id;
+	
 	std::vector<GridNode*> neighbours;
 
-	explicit GridNode(Point pos);
+	explicit GridNode(Point pos, int id);
 };
 
 #endif //PROTOTYPE_GRIDNODE_HPP
@@ -0,0 +1,76 @@
+#ifndef PROTOTYPE_GRIDTRAVERSAL_HPP
+#define PROTOTYPE_GRIDTRAVERSAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Math.h"
+#include "agent/path_planning/Point.h"
+
+/* Helper functions for uniform grids with square cells and the origin at (0, 0). Coordinates outside of the grid are clamped to the border cells */
+class GridTraversal {
+public:
+	/** Converts a coordinate to the index of the containing cell, clamped to the grid
+	 * @param value The coordinate
+	 * @param cellSize Edge length of a grid cell
+	 * @param cellCount Number of cells in this direction
+	 * @return The cell index */
+	static int toCell(double value, float cellSize, int cellCount);
+
+	/** Calls visitor(row, spanStart, spanEnd) for every row touched by the line segment, bottom to top. Per row, the touched cells form the contiguous
+	 * span [spanStart, spanEnd]. The spans are padded by EPS, so every cell the segment touches (supercover) is visited, including cells only touched at a corner
+	 * @param lStart Line segment start
+	 * @param lEnd Line segment end
+	 * @param cellSize Edge length of a grid cell
+	 * @param columns Number of columns in the grid
+	 * @param rows Number of rows in the grid
+	 * @param visitor Callable returning true to continue the traversal */
+	template<typename Visitor>
+	static void forEachRowSpanOnLineSegment(const Point& lStart, const Point& lEnd, float cellSize, int columns, int rows, Visitor visitor);
+};
+
+inline int GridTraversal::toCell(double value, float cellSize, int cellCount) {
+	auto cell = static_cast<int>(std::floor(value / cellSize));
+	return std::max(0, std::min(cellCount - 1, cell));
+}
+
+template<typename Visitor>
+void GridTraversal::forEachRowSpanOnLineSegment(const Point& lStart, const Point& lEnd, float cellSize, int columns, int rows, Visitor visitor) {
+	if(columns <= 0 || rows <= 0) {
+		return;
+	}
+
+	double minY = std::min(lStart.y, lEnd.y) - EPS;
+	double maxY = std::max(lStart.y, lEnd.y) + EPS;
+	double minX = std::min(lStart.x, lEnd.x) - EPS;
+	double maxX = std::max(lStart.x, lEnd.x) + EPS;
+	double dx = lEnd.x - lStart.x;
+	double dy = lEnd.y - lStart.y;
+
+	int firstRow = toCell(minY, cellSize, rows);
+	int lastRow = toCell(maxY, cellSize, rows);
+
+	for(int row = firstRow; row <= lastRow; row++) {
+		// Border rows extend to infinity because coordinates outside of the grid are clamped
+		double bandLow = row == 0 ? -std::numeric_limits<double>::infinity() : row * static_cast<double>(cellSize);
+		double bandHigh = row == rows - 1 ? std::numeric_limits<double>::infinity() : (row + 1) * static_cast<double>(cellSize);
+		double yLow = std::max(minY, bandLow);
+		double yHigh = std::min(maxY, bandHigh);
+
+		double xLow = minX;
+		double xHigh = maxX;
+		if(std::abs(dy) > EPS) {
+			double x1 = lStart.x + (yLow - lStart.y) * dx / dy;
+			double x2 = lStart.x + (yHigh - lStart.y) * dx / dy;
+			xLow = std::max(minX, std::min(x1, x2) - EPS);
+			xHigh = std::min(maxX, std::max(x1, x2) + EPS);
+		}
+
+		if(!visitor(row, toCell(xLow, cellSize, columns), toCell(xHigh, cellSize, columns))) {
+			return;
+		}
+	}
+}
+
+#endif //PROTOTYPE_GRIDTRAVERSAL_HPP
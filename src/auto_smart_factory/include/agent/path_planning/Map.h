@@ -2,6 +2,9 @@
 #define PROTOTYPE_MAP_H
 
 #include <vector>
+#include <unordered_set>
+#include <string>
+#include <memory>
 
 #include "auto_smart_factory/Tray.h"
 #include "auto_smart_factory/WarehouseConfiguration.h"
@@ -12,15 +15,25 @@
 #include "agent/path_planning/OrientedPoint.h"
 #include "agent/path_planning/RobotHardwareProfile.h"
 #include "agent/path_planning/TimedLineOfSightResult.h"
+#include "agent/path_planning/TimedEdge.h"
+#include "agent/path_planning/ReservationTable.h"
+#include "agent/path_planning/StaticObstacleGrid.h"
+#include "agent/path_planning/SafeInterval.h"
 
 #include "visualization_msgs/Marker.h"
 
+// Search algorithm used for path queries
+enum class PathPlannerType {THETA_STAR, LAZY_THETA_STAR, SIPP};
+
 /* Represents the agents local copy of the map. Contains static obstacles, timed reservations and a theta star map (collection of theta star grid nodes) */
 class Map {
 public:
 	/* Duration to use for a infinite reservation */
 	static double infiniteReservationTime;
 	
+	/* Sequence number of the idle reservations, which are created by every agent for all idle positions */
+	static constexpr int idleReservationSequence = 0;
+	
 private:
 	// For visualisation messages
 	static int visualisationId;
@@ -31,23 +44,82 @@ private:
 	float margin;
 	auto_smart_factory::WarehouseConfiguration warehouseConfig;
 	
-	// Static obstacles, set in constructor
-	std::vector<Rectangle> obstacles;
+	// Static obstacles, set in constructor. Never change, so copies and views of this map share them
+	std::shared_ptr<const std::vector<Rectangle>> obstacles;
+	
+	// Edge length of the cells of the static obstacle raster
+	static constexpr float staticObstacleCellSize = 0.5f;
 	
-	// Timed reservations, including own reservations
-	std::vector<Rectangle> reservations;
+	// Rasterized static obstacles for fast point and line of sight checks, shared like the obstacles
+	std::shared_ptr<const StaticObstacleGrid> staticObstacleGrid;
+	
+	// Edge length of the cells of the reservations spatial index
+	static constexpr float reservationCellSize = 1.f;
+	
+	// Timed reservations, including own reservations. Copy on write: snapshots taken with getReservationSnapshot share the table
+	// until the next change copies it. Shared with views of this map, copies start with a snapshot of the table
+	std::shared_ptr<std::shared_ptr<const ReservationTable>> reservations;
 	
 	// Theta star map used for theta star path queries
 	ThetaStarMap thetaStarMap;
 	
+	// Theta* maps with at least this many nodes are searched hierarchically
+	static constexpr int hierarchicalPlanningMinNodeCount = 5000;
+	
+	// Edge length of the clusters for hierarchical path queries, in theta* grid cells
+	static constexpr int hierarchicalPlanningClusterSize = 16;
+	
 	// Hardware profile of the agent using this map. Necessary for path estimations (battery, duration...)
 	RobotHardwareProfile* hardwareProfile;
 	
 	// Id of the owning agent. Used to determine own reservations (which should be ignored)
 	int ownerId;
+	
+	// Next sequence number for reservations added without one. Counts down from -2 so these ids never collide with the ones of a reservation manager
+	int nextLocalReservationSequence = -2;
+	
+	// Search algorithm used for path queries
+	PathPlannerType pathPlannerType = PathPlannerType::THETA_STAR;
+	
+	/** Returns the reservation table for changes. Copies it first if snapshots of it are in use
+	 * @return The reservation table */
+	ReservationTable& getWritableReservations();
+	
+	/** Compute a path with the selected path planner
+	 * @param start start point for path
+	 * @param end end point for the path
+	 * @param startingTime The time point when the path should start
+	 * @param targetReservationTime Duration the reservations at the end of the path should last
+	 * @param ignoreStartingReservations Ignore any reservations the start point is inside 
+	 * @return The computed Path. Check path.isValid before using it, errors are returned via an invalid path object */
+	Path findPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations);
 
 public:
 	Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector<Rectangle> &obstacles, RobotHardwareProfile* hardwareProfile, int ownerId);
+	
+	/** Constructor which loads the static part of the theta star map from a precomputed artifact file. If the file is missing or was built
+	 * for another configuration, the theta star map is built from scratch and written to the file for the next start
+	 * @param warehouseConfig The warehouse configuration
+	 * @param obstacles Static obstacles
+	 * @param hardwareProfile Hardware profile of the owning agent
+	 * @param ownerId Id of the owning agent
+	 * @param thetaStarMapArtifactPath Path of the artifact file, empty to always build the theta star map from scratch */
+	Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector<Rectangle> &obstacles, RobotHardwareProfile* hardwareProfile, int ownerId, const std::string& thetaStarMapArtifactPath);
+	
+	/** Copy constructor. The copy shares the static obstacles and the theta star grid nodes, which never change, with the original,
+	 * but has its own reservations (starting with a snapshot of the original ones) and search data. Used to plan on other threads without touching the original map
+	 * @param other The map to copy */
+	Map(const Map& other);
+	
+	/** Constructor for a view of a map, used for the maps of several agents hosted in one process. The view shares the static obstacles,
+	 * the theta star grid nodes and the reservations with the other map, so reservations changed through one of them are seen by all.
+	 * Only the owner and the search data are separate. Views must be used on the same thread as the other map and must not outlive it,
+	 * copy a view to plan on other threads
+	 * @param other The map to share the data of
+	 * @param hardwareProfile Hardware profile of the agent using the view
+	 * @param ownerId Id of the agent using the view */
+	Map(Map& other, RobotHardwareProfile* hardwareProfile, int ownerId);
+	Map& operator=(const Map& other) = delete;
 	~Map() = default;
 
 	/** Construct RViz visualisation marker message containing the visual representation of the obstacles */
@@ -82,9 +154,18 @@ public:
 	 * @param pos2 End point
 	 * @param startTime time when the connection starts at the start point
 	 * @param endTime time when the connection is planned to end at the end point
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/ 
-	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const;
+	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const;
+
+	/** Same as whenIsTimedLineOfSightFree, but skips the static obstacle check. Only use if the static line of sight is known to be free
+	 * @param pos1 Start point
+	 * @param pos2 End point
+	 * @param startTime time when the connection starts at the start point
+	 * @param endTime time when the connection is planned to end at the end point
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
+	TimedLineOfSightResult whenIsTimedLineOfSightFreeOfReservations(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const;
 
 	/** Check if certain line of sight connection is actually free for both driving and waiting during the connection
 	 * @param pos1 Start point
@@ -92,9 +173,32 @@ public:
 	 * @param startTime time when the connection starts at the start point
 	 * @param waitingTime Time to wait at the start point
 	 * @param drivingTime Time to drive from start to end
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
-	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const;
+	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::unordered_set<ReservationId>& smallerReservations) const;
+
+	/** Collect everything needed for timed checks along a line segment in a single pass over the reservations. Use this instead of
+	 * whenIsTimedLineOfSightFree and isTimedConnectionFree if several checks are done for the same segment
+	 * @param pos1 Start point
+	 * @param pos2 End point
+	 * @param earliestTime Earliest start time of the checks which will be done on the edge
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param edge The edge to fill (output) */
+	void collectTimedEdge(const Point& pos1, const Point& pos2, double earliestTime, const std::unordered_set<ReservationId>& smallerReservations, TimedEdge& edge) const;
+
+	/** Same as collectTimedEdge, but skips the static obstacle check and only adds the reservations to the edge. Only use if the static line of sight is known to be free
+	 * @param pos1 Start point
+	 * @param pos2 End point
+	 * @param earliestTime Earliest start time of the checks which will be done on the edge
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param edge The edge to add the reservations to (output) */
+	void collectTimedEdgeReservations(const Point& pos1, const Point& pos2, double earliestTime, const std::unordered_set<ReservationId>& smallerReservations, TimedEdge& edge) const;
+	
+	/** Compute the safe intervals of a point, the time intervals in which it is not inside any reservation of another robot
+	 * @param pos The point
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return The safe intervals, sorted by time */
+	std::vector<SafeInterval> getSafeIntervals(const Point& pos, const std::unordered_set<ReservationId>& smallerReservations) const;
 	
 	/** Checks whether a certain point is in the map 
 	 * @param pos the point to check
@@ -117,6 +221,30 @@ public:
 	/** Delete all reservations from this agent 
 	 * @param the agent id from which to delete reservations */
 	std::vector<Rectangle> deleteReservationsFromAgent(int agentId);
+	
+	/** Delete all reservations from this agent except the specified ones
+	 * @param agentId The agent id from which to delete reservations
+	 * @param keptSequences Sequence numbers of the reservations to keep
+	 * @return The deleted reservations */
+	std::vector<Rectangle> deleteReservationsFromAgent(int agentId, const std::vector<int>& keptSequences);
+	
+	/** Delete a single reservation
+	 * @param id Id of the reservation
+	 * @return True iff the reservation existed */
+	bool deleteReservation(ReservationId id);
+	
+	/** Returns all current reservations. Use getReservationSnapshot for reservations which can be used by other threads
+	 * @return The reservation table */
+	const ReservationTable& getReservations() const;
+	
+	/** Returns an immutable snapshot of the current reservations which can be used by other threads. The table is not copied,
+	 * the next change of the reservations copies it instead. Snapshots taken between two changes are the same object
+	 * @return The snapshot */
+	std::shared_ptr<const ReservationTable> getReservationSnapshot() const;
+	
+	/** Replaces all reservations with a snapshot, e.g. of another map. The snapshot is not copied
+	 * @param reservations The snapshot */
+	void setReservations(std::shared_ptr<const ReservationTable> reservations);
 		
 	/** Compute a theta star path inside this map. If a OrientedPoint is given, use this point, if a tray is given, compute the approach point in front of this tray and use this point instead
 	 * @param start start point or tray for path
@@ -129,6 +257,42 @@ public:
 	Path getThetaStarPath(const OrientedPoint& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime);
 	Path getThetaStarPath(const auto_smart_factory::Tray& start, const OrientedPoint& end, double startingTime, double targetReservationTime);
 	Path getThetaStarPath(const auto_smart_factory::Tray& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime);
+
+	/** Compute theta star paths from one start to multiple trays with a single search. The approach points in front of the trays are used as path targets
+	 * @param start start point or tray for the paths
+	 * @param ends end trays for the paths
+	 * @param startingTime The time point when the paths should start
+	 * @param targetReservationTime Duration the reservations at the end of the paths should last
+	 * @return One path per end tray, in the same order. Check path.isValid before using them, errors are returned via invalid path objects */
+	std::vector<Path> getThetaStarPaths(const OrientedPoint& start, const std::vector<auto_smart_factory::Tray>& ends, double startingTime, double targetReservationTime);
+	std::vector<Path> getThetaStarPaths(const auto_smart_factory::Tray& start, const std::vector<auto_smart_factory::Tray>& ends, double startingTime, double targetReservationTime);
+	
+	/** Select the search algorithm for path queries. With SIPP, theta* specific queries (multiple targets, search tree repair) fall back to a
+	 * single search per target
+	 * @param type The path planner type */
+	void setPathPlannerType(PathPlannerType type);
+	
+	/** Compute a theta star path and keep its search tree in the given search arena, so a later query between the same points can repair it
+	 * @param start start point for path
+	 * @param end end point for the path
+	 * @param startingTime The time point when the path should start
+	 * @param targetReservationTime Duration the reservations at the end of the path should last
+	 * @param ignoreStartingReservations Ignore any reservations the start point is inside 
+	 * @param arena Search arena of the caller
+	 * @return The computed Path. Check path.isValid before using it, errors are returned via an invalid path object */
+	Path getThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations, ThetaStarSearchArena* arena);
+	
+	/** Compute a theta star path by repairing the search tree of the previous query in the given search arena instead of searching from scratch.
+	 * Only the parts of the tree invalidated by changed reservations or the later starting time are searched again
+	 * @param start start point for path, must be the start point of the previous query
+	 * @param end end point for the path
+	 * @param startingTime The time point when the path should start
+	 * @param targetReservationTime Duration the reservations at the end of the path should last
+	 * @param ignoreStartingReservations Ignore any reservations the start point is inside 
+	 * @param arena Search arena of the caller, containing the search tree of the previous query
+	 * @param previousStartingTime Starting time of the previous query
+	 * @return The computed Path. Check path.isValid before using it, errors are returned via an invalid path object */
+	Path repairThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations, ThetaStarSearchArena* arena, double previousStartingTime);
 	
 	/** Checks whether a position is the current target of another robot 
 	 * @param pos The position to check 
@@ -141,7 +305,10 @@ public:
 	float getMargin() const;
 	int getOwnerId() const;
 
-	std::vector<Rectangle> getRectanglesOnStartingPoint(Point p) const;
+	/** Returns the ids of all reservations of other agents which contain the specified point
+	 * @param p The point
+	 * @return Set of reservation ids */
+	std::unordered_set<ReservationId> getReservationIdsOnStartingPoint(Point p) const;
 
 private:
 
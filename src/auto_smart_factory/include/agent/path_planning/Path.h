@@ -22,6 +22,13 @@ public:
 	double reservationTimeMarginAhead = 0.6f;
 	double reservationTimeMarginBehind = 0.4f;
 	
+	// Reserve driving segments and curves with one swept capsule each instead of a chain of rectangles
+	bool useSweptReservations = true;
+	
+	// Duration every point of a swept capsule is additionally held before and after the robot is expected there.
+	// Covers accelerating and braking, which the linear timing along the center line ignores
+	double sweptReservationTimeSlack = 0.5f;
+	
 	// Additional time included to approach the final path point due to motion planner precision mode
 	double finalPointAdditionalTime = 0.35f;
 	
@@ -120,7 +127,7 @@ public:
 	visualization_msgs::Marker getVisualizationMsgLines(std_msgs::ColorRGBA color);
 
 private:
-	/** Generate reservations for a straight line segment
+	/** Generate reservations for a straight line segment, a swept capsule or a chain of rectangles
 	 * @param reservations The reservations vector to add these reservations to
 	 * @param startPoint Line segment start point
 	 * @param endPoint Line segment end point
@@ -130,7 +137,7 @@ private:
 	 * */
 	void generateReservationsForSegment(std::vector<Rectangle>& reservations, Point startPoint, Point endPoint, double timeAtStartPoint, double deltaDuration, int ownerId) const;
 
-	/** Generate reservations for a curved line segment
+	/** Generate reservations for a curved line segment, a swept capsule or a chain of rectangles
 	 * @param reservations The reservations vector to add these reservations to
 	 * @param points List of Points describing the curved line segment
 	 * @param timeAtStartPoint TimeStamp for the start point
@@ -139,6 +146,17 @@ private:
 	 * */
 	void generateReservationsForCurvePoints(std::vector<Rectangle>& reservations, std::vector<Point> points, double timeAtStartPoint, double deltaTime, int ownerId) const;
 	
+	/** Generate a swept capsule reservation for driving along a line segment with constant speed
+	 * @param reservations The reservations vector to add the reservation to
+	 * @param startPoint Start of the center line
+	 * @param endPoint End of the center line
+	 * @param radius Reserved distance to the center line
+	 * @param timeAtStartPoint TimeStamp for the start point
+	 * @param deltaDuration Duration to drive to the end point
+	 * @param ownerId Owner id for the generated reservation
+	 * */
+	void generateSweptReservation(std::vector<Rectangle>& reservations, Point startPoint, Point endPoint, double radius, double timeAtStartPoint, double deltaDuration, int ownerId) const;
+	
 	/** Generate reservations in front of a tray
 	 * @param reservations The reservations vector to add these reservations to
 	 * @param pos the Position in front of the tray
@@ -0,0 +1,57 @@
+#ifndef PROTOTYPE_PLANNINGWORKERPOOL_HPP
+#define PROTOTYPE_PLANNINGWORKERPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "agent/path_planning/Map.h"
+
+/* Pool of worker threads for path planning jobs which must not block the agents control loop.
+ * Every worker owns a copy of the map (see Map), which shares the theta* grid nodes with the map of the agent but has its own reservations
+ * and search data, so jobs never touch the map of the agent. Jobs get the worker map as parameter
+ * and are expected to install the reservation snapshot they should plan against before planning. */
+class PlanningWorkerPool {
+public:
+	typedef std::function<void(Map& workerMap)> Job;
+
+	/** Constructor, starts the workers
+	 * @param map Map to copy for every worker
+	 * @param workerCount Number of worker threads */
+	PlanningWorkerPool(const Map& map, int workerCount);
+	PlanningWorkerPool(const PlanningWorkerPool& other) = delete;
+	PlanningWorkerPool& operator=(const PlanningWorkerPool& other) = delete;
+
+	/** Destructor. Discards pending jobs and waits for running jobs to finish */
+	~PlanningWorkerPool();
+
+	/** Queue a job. Jobs are started in submission order by the next free worker
+	 * @param job The job */
+	void submit(Job job);
+
+	/** Returns the number of jobs which were not started yet
+	 * @return Pending job count */
+	int getPendingJobCount() const;
+
+private:
+	// Maps of the workers, one per worker
+	std::vector<Map*> workerMaps;
+	std::vector<std::thread> workers;
+
+	// Jobs which were not started yet
+	std::deque<Job> jobs;
+
+	// Guards jobs and stopping
+	mutable std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool stopping = false;
+
+	/** Worker loop, runs jobs until the pool is destroyed
+	 * @param workerMap Map of this worker */
+	void work(Map* workerMap);
+};
+
+#endif //PROTOTYPE_PLANNINGWORKERPOOL_HPP
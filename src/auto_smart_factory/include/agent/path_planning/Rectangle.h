@@ -1,9 +1,20 @@
 #ifndef PROTOTYPE_RECTANGLE_HPP
 #define PROTOTYPE_RECTANGLE_HPP
 
+#include <cstdint>
+
 #include "agent/path_planning/Point.h"
 
-/* Class representing an obstacle or a reservation (which is a timed obstacle). A rotated rectangle is used as geometric representation */
+// Stable identifier of a reservation, combines the owner id and the sequence number assigned by the owner
+typedef uint64_t ReservationId;
+
+// Geometric representation of a rectangle, values match the shape constants of auto_smart_factory/Rectangle
+enum class RectangleShape : unsigned char {RECTANGLE = 0, SWEPT_CAPSULE = 1};
+
+/* Class representing an obstacle or a reservation (which is a timed obstacle). A rotated rectangle is used as geometric representation.
+ * Reservations of driving robots can instead be swept capsules: all points within size.y / 2 of a center line with length size.x, which
+ * runs through pos in the direction of rotation. The owner moves along the center line, so every point of it is only held for the hold
+ * duration. The hold times move linearly from the start of the center line at startTime to its end at endTime */
 class Rectangle {
 private:
 	// Center position of the rectangle
@@ -22,11 +33,24 @@ private:
 	// The owner id of the reservation
 	int ownerId;
 	
+	// Sequence number of the reservation among all reservations of its owner, noSequence if none was assigned
+	int sequence;
+	
+	// Geometric representation
+	RectangleShape shape;
+	
+	// Duration every point of the center line of a swept capsule is held. Always the whole time range for rectangles
+	double holdDuration;
+	
+	// Start and end of the center line of a swept capsule
+	Point axisStart;
+	Point axisEnd;
+	
 	// ==== Internal data for faster physic processing
-	// Corner points of the inflated rectangle
+	// Corner points of the inflated rectangle, the bounding rectangle for swept capsules
 	Point pointsInflated[4];
 
-	// Corner points of the non-inflated rectangle
+	// Corner points of the non-inflated rectangle, the bounding rectangle for swept capsules
 	Point pointsNonInflated[4];
 	
 	// Is this rectangle axis aligned (rotation is multiple of 90°)
@@ -36,8 +60,24 @@ private:
 	double minXInflated, maxXInflated, minYInflated, maxYInflated;
 
 public:
+	// Sequence number of reservations which were not assigned one
+	static const int noSequence = -1;
+	
 	Rectangle(Point pos, Point size, float rotation);
 	Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId);
+	Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId, int sequence);
+	Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId, int sequence, RectangleShape shape, double holdDuration);
+	
+	/** Creates a swept capsule reservation along a line segment
+	 * @param start Start of the center line, reached first
+	 * @param end End of the center line
+	 * @param radius Distance to the center line which is reserved
+	 * @param startTime Time when the start of the center line is first held
+	 * @param endTime Time when the end of the center line is last held
+	 * @param holdDuration Duration every point of the center line is held, at most endTime - startTime
+	 * @param ownerId The owner id of the reservation
+	 * @return The swept capsule */
+	static Rectangle createSweptCapsule(const Point& start, const Point& end, double radius, double startTime, double endTime, double holdDuration, int ownerId);
 	
 	// Getter
 	const Point* getPointsInflated() const;
@@ -46,6 +86,19 @@ public:
 	Point getSize() const;
 	float getRotation() const;
 	int getOwnerId() const;
+	int getSequence() const;
+	RectangleShape getShape() const;
+	double getHoldDuration() const;
+	const Point& getAxisStart() const;
+	const Point& getAxisEnd() const;
+	
+	/** Returns the radius of a swept capsule, inflated by the robot radius
+	 * @return Inflated radius */
+	double getRadiusInflated() const;
+	
+	/** Returns the stable id of the reservation, only unique if a sequence number was assigned
+	 * @return (owner id, sequence) packed into one value */
+	ReservationId getId() const;
 	
 	bool getIsAxisAligned() const;
 	double getMinXInflated() const;
@@ -63,6 +116,13 @@ public:
 	 * @param ownerId Owner Id of the caller. This is used to check if the reservation belongs to the owner
 	 * @return True iff the time ranges overlap AND the rectangle does not belong the the specified owner id */
 	bool doesOverlapTimeRange(double start, double end, int ownerId) const;
+	
+	/** Computes when a section of the center line is held. Rectangles are held completely during [startTime, endTime]
+	 * @param fromAlpha Start of the section, relative position on the center line in [0, 1]
+	 * @param toAlpha End of the section, relative position on the center line in [fromAlpha, 1]
+	 * @param start First time any point of the section is held (output)
+	 * @param end Last time any point of the section is held (output) */
+	void getHoldTimeRange(double fromAlpha, double toAlpha, double& start, double& end) const;
 };
 
 // Overloaded operators for rectangle comparison
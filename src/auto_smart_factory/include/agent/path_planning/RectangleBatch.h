@@ -0,0 +1,70 @@
+#ifndef PROTOTYPE_RECTANGLEBATCH_HPP
+#define PROTOTYPE_RECTANGLEBATCH_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+
+/* Collection of rectangles for batched intersection tests. The inflated AABBs are stored as structure of arrays so that one segment or point
+ * can be tested against 8 (AVX2), 4 (SSE2) or 1 (scalar fallback) rectangles per instruction. Rectangles passing this broad phase
+ * are tested with the exact Math functions, so the results are identical to testing every rectangle one by one. */
+class RectangleBatch {
+public:
+	RectangleBatch() = default;
+
+	/** Add a rectangle to the batch
+	 * @param rectangle The rectangle
+	 * @return Index of the rectangle */
+	int add(const Rectangle& rectangle);
+
+	/** Remove all rectangles */
+	void clear();
+
+	/** Returns the number of rectangles
+	 * @return Rectangle count */
+	int size() const;
+
+	/** Returns the rectangle with the specified index
+	 * @param index The index
+	 * @return The rectangle */
+	const Rectangle& get(int index) const;
+
+	/** Searches the first rectangle in [begin, end) which intersects the line segment, see Math::doesLineSegmentIntersectRectangle
+	 * @param lStart Line segment start
+	 * @param lEnd Line segment end
+	 * @param begin First index to test
+	 * @param end Index after the last index to test
+	 * @return Index of the first intersecting rectangle, -1 if there is none */
+	int findIntersectionWithLineSegment(const Point& lStart, const Point& lEnd, int begin, int end) const;
+
+	/** Searches the first rectangle in [begin, end) which contains the point, see Math::isPointInRectangle
+	 * @param p The point
+	 * @param begin First index to test
+	 * @param end Index after the last index to test
+	 * @return Index of the first containing rectangle, -1 if there is none */
+	int findRectangleContainingPoint(const Point& p, int begin, int end) const;
+
+private:
+	// Inflated AABBs, rounded outwards to float so the broad phase never rejects a rectangle the exact test would accept
+	std::vector<float> minX;
+	std::vector<float> maxX;
+	std::vector<float> minY;
+	std::vector<float> maxY;
+
+	// The rectangles for the exact test
+	std::vector<Rectangle> rectangles;
+
+	/** Computes the broad phase for the rectangles [index, index + count) with count <= 8
+	 * @param index First index to test
+	 * @param count Number of rectangles to test
+	 * @param segMinX, segMaxX, segMinY, segMaxY AABB of the query
+	 * @param nx, ny Normal of the query segment, (0, 0) to skip the separating axis test
+	 * @param offset Dot product of the normal with the segment start
+	 * @param slack Tolerance of the separating axis test
+	 * @return Bit mask, bit i is set iff rectangle index + i may intersect the query */
+	uint32_t getCandidateMask(int index, int count, float segMinX, float segMaxX, float segMinY, float segMaxY, float nx, float ny, float offset, float slack) const;
+};
+
+#endif //PROTOTYPE_RECTANGLEBATCH_HPP
@@ -0,0 +1,38 @@
+#ifndef PROTOTYPE_RESERVATIONBROADCASTCODEC_HPP
+#define PROTOTYPE_RESERVATIONBROADCASTCODEC_HPP
+
+#include <vector>
+
+#include "auto_smart_factory/ReservationBroadcast.h"
+#include "agent/path_planning/Rectangle.h"
+
+/* Compact wire format of the reservations in reservation broadcasts. Positions and sizes are stored as float32, times as float32 relative
+ * to the base time of the broadcast and rotations quantized to 1/65536 of a full turn. The sizeY values are stored once per broadcast as
+ * size classes, the reservations of a broadcast usually share a few of them. A broadcast only carries the new reservations of its owner,
+ * reservations which stay are referenced by their sequence number */
+class ReservationBroadcastCodec {
+public:
+	/** Sets the reservations of a broadcast
+	 * @param msg The broadcast
+	 * @param keptSequences Sequence numbers of the reservations of the owner which stay
+	 * @param newReservations New reservations of the owner
+	 * @param baseTime Time the reservation times are stored relative to */
+	static void encode(auto_smart_factory::ReservationBroadcast& msg, const std::vector<int>& keptSequences, const std::vector<Rectangle>& newReservations, double baseTime);
+
+	/** Returns the new reservations of a broadcast
+	 * @param msg The broadcast
+	 * @return The reservations, owned by the owner of the broadcast */
+	static std::vector<Rectangle> decode(const auto_smart_factory::ReservationBroadcast& msg);
+
+	/** Checks whether a reservation is kept by a broadcast
+	 * @param msg The broadcast
+	 * @param sequence Sequence number of a reservation of the owner of the broadcast
+	 * @return True iff the reservation stays */
+	static bool isKept(const auto_smart_factory::ReservationBroadcast& msg, int sequence);
+
+private:
+	// Quantization steps of a full turn
+	static constexpr double rotationSteps = 65536.0;
+};
+
+#endif //PROTOTYPE_RESERVATIONBROADCASTCODEC_HPP
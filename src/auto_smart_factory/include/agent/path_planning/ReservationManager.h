@@ -3,8 +3,14 @@
 
 #include "ros/publisher.h"
 #include "auto_smart_factory/ReservationBroadcast.h"
+#include "agent/path_planning/ReservationBroadcastCodec.h"
+#include "agent/path_planning/ReservationSynchronizer.h"
+#include "agent/path_planning/ReservationZones.h"
 #include "agent/path_planning/OrientedPoint.h"
 #include "Map.h"
+#include "agent/path_planning/RectangleBatch.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
+#include "map"
 #include "queue"
 #include "vector"
 
@@ -26,6 +32,35 @@ public:
 	/** Callback for the reservations coordination communication
 	 * @param msg The received message */
 	void reservationBroadcastCallback(const auto_smart_factory::ReservationBroadcast& msg);
+	
+	/** Replaces the reservations of the map with a snapshot from the reservation master. Only for agents which receive the broadcasts
+	 * through reservationBroadcastCallback
+	 * @return True iff the snapshot was applied */
+	bool synchronizeReservations();
+	
+	/** Receives the broadcasts of the zones near the own route instead of all broadcasts, if the warehouse is partitioned into zones (see ReservationZones).
+	 * Only for agents which receive the broadcasts through reservationBroadcastCallback, call before synchronizeReservations
+	 * @return True iff the broadcasts of zones are received, otherwise all broadcasts have to be passed to reservationBroadcastCallback */
+	bool receiveZoneBroadcasts();
+	
+	/** Sets the synchronizer of the reservations of the map, if the map shares its reservations with another map (see AgentHost).
+	 * Requests tell the reservation master which broadcasts the reservations contained when the path was planned
+	 * @param mapSynchronizer The synchronizer, must outlive this reservation manager */
+	void setMapSynchronizer(const ReservationSynchronizer* mapSynchronizer);
+	
+	/** Applies a reservation broadcast to the reservations of a map. Used once per broadcast for reservations shared by several agents,
+	 * see handleAppliedReservationBroadcast
+	 * @param map The map
+	 * @param msg The received message
+	 * @param oldReservations The removed reservations of the owner of the message (output)
+	 * @param reservations The new reservations in the message (output) */
+	static void applyReservationBroadcast(Map* map, const auto_smart_factory::ReservationBroadcast& msg, std::vector<Rectangle>& oldReservations, std::vector<Rectangle>& reservations);
+	
+	/** Reacts to a reservation broadcast which was already applied to the reservations of the map, see applyReservationBroadcast
+	 * @param msg The received message
+	 * @param oldReservations The removed reservations of the owner of the message
+	 * @param reservations The new reservations in the message */
+	void handleAppliedReservationBroadcast(const auto_smart_factory::ReservationBroadcast& msg, const std::vector<Rectangle>& oldReservations, const std::vector<Rectangle>& reservations);
 
 	/** Start to bid for a path reservation
 	 * @param startPoint Path start point
@@ -52,6 +87,33 @@ private:
 	// Pointer to Map
 	Map* map;
 	
+	// Detects lost broadcasts and synchronizes the reservations of the map
+	ReservationSynchronizer synchronizer;
+	
+	// Synchronizer of the reservations of the map, the own one unless the reservations are shared
+	const ReservationSynchronizer* mapSynchronizer;
+	
+	// Zone layout of the reservation master
+	ReservationZones zoneLayout;
+	
+	// Are the broadcasts of the zones near the own route received instead of all broadcasts
+	bool receivesZoneBroadcasts;
+	
+	// Received zones and their subscribers
+	std::vector<int> receivedZones;
+	std::map<int, ros::Subscriber> zoneBroadcastSubscribers;
+	
+	// Distance around the own route within which the broadcasts of zones are received
+	static constexpr double zoneMargin = 2.0;
+	
+	/** Receives the broadcasts of the specified zones only. Reservations in added zones are synchronized
+	 * @param zones The zones, sorted */
+	void setReceivedZones(const std::vector<int>& zones);
+	
+	/** Returns the zones around the last reserved reservations
+	 * @return The zones, sorted */
+	std::vector<int> getZonesOfLastReserved() const;
+	
 	// Agent id of the owning agent
 	int agentId;
 	
@@ -74,22 +136,48 @@ private:
 	// The times this path has been retrieved
 	int pathRetrievedCount;
 	
-	/** Save the reservations in the message as the last reserved path reservations. These are used to check if the agent is currently inside one of its own reservations 
-	 * @param msg Message contaiing the last reserved reservations */
-	void saveReservationsAsLastReserved(const auto_smart_factory::ReservationBroadcast& msg);
+	// Sequence number for the next reservation this agent requests. Together with the agent id it identifies the reservation
+	int nextReservationSequence;
+	
+	// Reservations of the pending request and of the last granted request, as generated from the path
+	std::vector<Rectangle> requestedReservations;
+	std::vector<Rectangle> grantedReservations;
 	
-	/** Extracts the reservations for a reservation broadcast message
-	 * @param msg The message contaiing the reservations */
-	std::vector<Rectangle> getReservationsFromMessage(const auto_smart_factory::ReservationBroadcast& msg);
+	/** Save the reservations kept by the message and the new reservations in the message as the last reserved path reservations.
+	 * These are used to check if the agent is currently inside one of its own reservations 
+	 * @param msg Message containing the last reserved reservations
+	 * @param reservations The new reservations in the message */
+	void saveReservationsAsLastReserved(const auto_smart_factory::ReservationBroadcast& msg, const std::vector<Rectangle>& reservations);
+	
+	/** Returns the sequence number of a granted reservation which equals the specified reservation apart from the sequence number.
+	 * Reusing it lets the reservation master keep the reservation instead of broadcasting it again
+	 * @param reservation The reservation
+	 * @return The sequence number, Rectangle::noSequence if there is no such reservation */
+	int findGrantedReservationSequence(const Rectangle& reservation) const;
 	
 	/** Request reservations for the current path */
 	void requestPathReservation();
 	
-	/** Calculate new Path from current start to finish */
-	bool calculateNewPath();
+	/** Calculate new Path from current start to finish
+	 * @param repairLastSearch Repair the search tree of the last calculation instead of searching from scratch
+	 * @return True iff a valid path was found */
+	bool calculateNewPath(bool repairLastSearch);
+	
+	// Repair the search tree of the denied path when bidding again, instead of planning from scratch
+	static constexpr bool useIncrementalReplanning = true;
+	
+	// Search tree of the last path calculation, repaired after a denial
+	ThetaStarSearchArena planningArena;
+	
+	// Starting time of the last path calculation
+	double lastPlanningTime;
+	
+	// Broadcasts contained in the reservations the current path to reserve was planned with, see ReservationSynchronizer::getKnownBroadcastSequence
+	uint64_t pathKnownBroadcastSequence;
+	uint32_t pathKnownEpoch;
 	
 	// Last reserved reservations. Used to check if the robot is currently in a spot reserved by him
-	std::vector<Rectangle> lastReservedPathReservations;
+	RectangleBatch lastReservedPathReservations;
 	
 	// Is replanning necessary
 	bool replanningNecessary;
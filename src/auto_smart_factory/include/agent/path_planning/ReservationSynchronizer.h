@@ -0,0 +1,100 @@
+#ifndef PROTOTYPE_RESERVATIONSYNCHRONIZER_HPP
+#define PROTOTYPE_RESERVATIONSYNCHRONIZER_HPP
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "ros/ros.h"
+#include "auto_smart_factory/ReservationBroadcast.h"
+#include "agent/path_planning/Map.h"
+
+/* Keeps the reservations of a map in sync with the reservation table of the reservation master. Broadcasts are numbered per topic by the master,
+ * so lost broadcasts show up as gaps in the sequence numbers. On a gap, and on start, the reservations are replaced by a snapshot of the
+ * master's table. Broadcasts which are already contained in a snapshot must not be applied again, the ones that arrive after the snapshot
+ * was taken are only handled. Agents receiving the broadcasts of some zones only (see ReservationZones) get a broadcast once per zone
+ * and not necessarily in order across zones, so every owner is tracked by the broadcast its reservations in the map correspond to */
+class ReservationSynchronizer {
+public:
+	// What to do with a received broadcast
+	enum class Action {
+		// Already handled
+		IGNORE,
+		// Already contained in the reservations of the map, only react to it
+		HANDLE,
+		// Apply to the reservations of the map and react to it
+		APPLY_AND_HANDLE
+	};
+
+	ReservationSynchronizer() = default;
+
+	/** Constructor
+	 * @param map The map whose reservations are kept in sync */
+	explicit ReservationSynchronizer(Map* map);
+
+	/** Replaces the reservations with a snapshot. All broadcasts contained in it count as handled
+	 * @return True iff the snapshot was applied */
+	bool bootstrap();
+
+	/** Sets the zones whose broadcasts are received. The reservations are synchronized with a snapshot if zones are added
+	 * @param zones The zones, sorted. Empty if all broadcasts are received on /reservation_broadcast
+	 * @return False iff a needed snapshot could not be applied */
+	bool setZones(const std::vector<int>& zones);
+
+	/** Classifies a received broadcast. On a gap the reservations are synchronized with a snapshot first
+	 * @param msg The broadcast
+	 * @return What to do with the broadcast */
+	Action onBroadcast(const auto_smart_factory::ReservationBroadcast& msg);
+
+	/** Returns the sequence number up to which all broadcasts of the received topics are contained in the reservations of the map.
+	 * Broadcasts of different topics can arrive in any order, so this is the oldest of the last broadcasts received on each topic
+	 * @return The sequence number, 0 if the reservations were not synchronized with a snapshot */
+	uint64_t getKnownBroadcastSequence() const;
+
+	/** Returns the epoch of the reservation master the sequence numbers belong to
+	 * @return The epoch */
+	uint32_t getEpoch() const;
+
+private:
+	// Map whose reservations are kept in sync
+	Map* map = nullptr;
+
+	ros::ServiceClient snapshotClient;
+
+	// Zones whose broadcasts are received, empty for /reservation_broadcast
+	std::vector<int> zones;
+
+	// Whether the epoch and the sequence numbers are known
+	bool hasSequence = false;
+
+	// Whether the reservations were synchronized with the last requested snapshot. Otherwise broadcasts may be missing
+	bool isSynchronized = false;
+
+	// Epoch of the reservation master
+	uint32_t epoch = 0;
+
+	// Sequence number of the last broadcast received on each topic, by zone (-1 for /reservation_broadcast)
+	std::map<int, uint64_t> topicSequences;
+
+	// Sequence number of the broadcast (broadcastSequence) last received on each topic or contained in the last snapshot, by zone
+	std::map<int, uint64_t> topicBroadcastSequences;
+
+	// Sequence number of the broadcast the reservations of each owner in the map correspond to
+	std::unordered_map<int, uint64_t> ownerSequences;
+
+	// Sequence number of the last handled broadcast of each owner
+	std::unordered_map<int, uint64_t> handledSequences;
+
+	// All broadcasts up to this sequence number count as handled
+	uint64_t handledSequence = 0;
+
+	// Sequence number of the last broadcast contained in the last snapshot
+	uint64_t snapshotSequence = 0;
+
+	/** Replaces the reservations of all robots listed in a snapshot of the received zones
+	 * @return True iff the snapshot was applied */
+	bool synchronize();
+};
+
+#endif //PROTOTYPE_RESERVATIONSYNCHRONIZER_HPP
@@ -0,0 +1,237 @@
+#ifndef PROTOTYPE_RESERVATIONTABLE_HPP
+#define PROTOTYPE_RESERVATIONTABLE_HPP
+
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+#include "agent/path_planning/GridTraversal.h"
+
+/* Storage for timed reservations with a uniform grid spatial index over the inflated reservation AABBs.
+ * Every reservation is stored in a slot which stays valid until the reservation is removed. Free slots are reused.
+ * Spatial queries only visit reservations listed in the grid cells touched by the query. Every cell entry carries the time range
+ * of its reservation, so reservations which cannot overlap the queried time range are skipped before any geometry is tested.
+ * Reservations are additionally ordered by their end time, which makes removing expired reservations logarithmic per reservation.
+ * Reservations with an assigned sequence number can be looked up by their id. */
+class ReservationTable {
+public:
+	ReservationTable() = default;
+	
+	/** Constructor
+	 * @param width Width of the indexed area
+	 * @param height Height of the indexed area
+	 * @param cellSize Edge length of a grid cell */
+	ReservationTable(float width, float height, float cellSize);
+
+	/** Add a reservation to the table
+	 * @param reservation The reservation
+	 * @return The slot of the reservation */
+	int add(const Rectangle& reservation);
+
+	/** Remove the reservation in the specified slot
+	 * @param slot Slot of the reservation */
+	void remove(int slot);
+
+	/** Returns the slot of the reservation with the specified id
+	 * @param id Id of the reservation
+	 * @return The slot of the reservation, -1 if no stored reservation has this id */
+	int findSlot(ReservationId id) const;
+
+	/** Remove all reservations which end before the specified time
+	 * @param time The time
+	 * @return Number of removed reservations */
+	int removeExpired(double time);
+	
+	/** Checks whether any reservation ends before the specified time
+	 * @param time The time
+	 * @return True iff removeExpired would remove reservations */
+	bool hasExpired(double time) const;
+
+	/** Returns the reservation in the specified slot. Only valid for used slots
+	 * @param slot Slot of the reservation
+	 * @return The reservation */
+	const Rectangle& get(int slot) const;
+	
+	/** Checks whether a slot currently holds a reservation
+	 * @param slot The slot
+	 * @return True iff the slot holds a reservation */
+	bool isUsed(int slot) const;
+	
+	/** Returns the number of slots. Slot ids are in the range [0, getSlotCount())
+	 * @return Slot count */
+	int getSlotCount() const;
+
+	/** Calls visitor(slot, reservation) for every stored reservation
+	 * @param visitor Callable returning true to continue the iteration */
+	template<typename Visitor>
+	void forEachReservation(Visitor visitor) const;
+
+	/** Calls visitor(slot, reservation) for every reservation whose inflated AABB may contain the specified point
+	 * and whose time range overlaps [startTime, endTime]
+	 * @param p The point
+	 * @param startTime Start of the queried time range
+	 * @param endTime End of the queried time range
+	 * @param visitor Callable returning true to continue the iteration */
+	template<typename Visitor>
+	void forEachReservationAt(const Point& p, double startTime, double endTime, Visitor visitor) const;
+
+	/** Calls visitor(slot, reservation) exactly once for every reservation whose inflated AABB shares a grid cell with the specified line segment
+	 * and whose time range overlaps [startTime, endTime]
+	 * @param lStart Line segment start
+	 * @param lEnd Line segment end
+	 * @param startTime Start of the queried time range
+	 * @param endTime End of the queried time range
+	 * @param visitor Callable returning true to continue the iteration */
+	template<typename Visitor>
+	void forEachReservationOnLineSegment(const Point& lStart, const Point& lEnd, double startTime, double endTime, Visitor visitor) const;
+
+	/** Calls visitor(slot, reservation) exactly once for every reservation whose inflated AABB shares a grid cell with the specified axis aligned box
+	 * and whose time range overlaps [startTime, endTime]
+	 * @param minX Minimum x of the box
+	 * @param maxX Maximum x of the box
+	 * @param minY Minimum y of the box
+	 * @param maxY Maximum y of the box
+	 * @param startTime Start of the queried time range
+	 * @param endTime End of the queried time range
+	 * @param visitor Callable returning true to continue the iteration */
+	template<typename Visitor>
+	void forEachReservationInBox(double minX, double maxX, double minY, double maxY, double startTime, double endTime, Visitor visitor) const;
+
+private:
+	// Bookkeeping for one slot
+	struct Slot {
+		bool used;
+		
+		// Range of grid cells covered by the inflated AABB of the reservation
+		int minX, maxX, minY, maxY;
+	};
+	
+	// Reservations, indexed by slot
+	std::vector<Rectangle> reservations;
+	std::vector<Slot> slots;
+	
+	// Unused slots which can be reused
+	std::vector<int> freeSlots;
+	
+	// Reference to a reservation in a grid cell. The time range is duplicated to filter without touching the reservation
+	struct CellEntry {
+		int slot;
+		double startTime;
+		double endTime;
+	};
+
+	// Entries of the reservations overlapping each grid cell, in row-major order
+	std::vector<std::vector<CellEntry>> cells;
+	
+	// (end time, slot) of all stored reservations, ordered by end time
+	std::set<std::pair<double, int>> expiryOrder;
+	
+	// Slot per id of the stored reservations which were assigned a sequence number
+	std::unordered_map<ReservationId, int> slotsById;
+	
+	float cellSize = 1.f;
+	int columns = 0;
+	int rows = 0;
+};
+
+template<typename Visitor>
+void ReservationTable::forEachReservation(Visitor visitor) const {
+	for(int slot = 0; slot < static_cast<int>(slots.size()); slot++) {
+		if(slots[slot].used && !visitor(slot, reservations[slot])) {
+			return;
+		}
+	}
+}
+
+template<typename Visitor>
+void ReservationTable::forEachReservationAt(const Point& p, double startTime, double endTime, Visitor visitor) const {
+	if(cells.empty()) {
+		return;
+	}
+	
+	for(const CellEntry& entry : cells[GridTraversal::toCell(p.y, cellSize, rows) * columns + GridTraversal::toCell(p.x, cellSize, columns)]) {
+		if(entry.endTime < startTime || entry.startTime > endTime) {
+			continue;
+		}
+		
+		if(!visitor(entry.slot, reservations[entry.slot])) {
+			return;
+		}
+	}
+}
+
+template<typename Visitor>
+void ReservationTable::forEachReservationOnLineSegment(const Point& lStart, const Point& lEnd, double startTime, double endTime, Visitor visitor) const {
+	bool isFirstRow = true;
+	int prevRow = 0;
+	int prevSpanStart = 0;
+	int prevSpanEnd = -1;
+
+	GridTraversal::forEachRowSpanOnLineSegment(lStart, lEnd, cellSize, columns, rows, [&](int row, int spanStart, int spanEnd) {
+		for(int column = spanStart; column <= spanEnd; column++) {
+			for(const CellEntry& entry : cells[row * columns + column]) {
+				if(entry.endTime < startTime || entry.startTime > endTime) {
+					continue;
+				}
+				
+				const Slot& s = slots[entry.slot];
+				
+				// Skip reservations which were already visited in the previous cell of this row or in the previous row
+				bool visitedInRow = column > spanStart && column - 1 >= s.minX;
+				bool visitedInPrevRow = !isFirstRow && prevRow >= s.minY && prevSpanStart <= s.maxX && prevSpanEnd >= s.minX;
+				if(visitedInRow || visitedInPrevRow) {
+					continue;
+				}
+				
+				if(!visitor(entry.slot, reservations[entry.slot])) {
+					return false;
+				}
+			}
+		}
+		
+		isFirstRow = false;
+		prevRow = row;
+		prevSpanStart = spanStart;
+		prevSpanEnd = spanEnd;
+		
+		return true;
+	});
+}
+
+template<typename Visitor>
+void ReservationTable::forEachReservationInBox(double minX, double maxX, double minY, double maxY, double startTime, double endTime, Visitor visitor) const {
+	if(cells.empty()) {
+		return;
+	}
+	
+	int minColumn = GridTraversal::toCell(minX, cellSize, columns);
+	int maxColumn = GridTraversal::toCell(maxX, cellSize, columns);
+	int minRow = GridTraversal::toCell(minY, cellSize, rows);
+	int maxRow = GridTraversal::toCell(maxY, cellSize, rows);
+	
+	for(int row = minRow; row <= maxRow; row++) {
+		for(int column = minColumn; column <= maxColumn; column++) {
+			for(const CellEntry& entry : cells[row * columns + column]) {
+				if(entry.endTime < startTime || entry.startTime > endTime) {
+					continue;
+				}
+				
+				// Only visit reservations in the first cell they share with the box
+				const Slot& s = slots[entry.slot];
+				if(column != std::max(s.minX, minColumn) || row != std::max(s.minY, minRow)) {
+					continue;
+				}
+				
+				if(!visitor(entry.slot, reservations[entry.slot])) {
+					return;
+				}
+			}
+		}
+	}
+}
+
+#endif //PROTOTYPE_RESERVATIONTABLE_HPP
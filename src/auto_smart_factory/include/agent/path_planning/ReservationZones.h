@@ -0,0 +1,79 @@
+#ifndef PROTOTYPE_RESERVATIONZONES_HPP
+#define PROTOTYPE_RESERVATIONZONES_HPP
+
+#include <string>
+#include <vector>
+
+#include "agent/path_planning/Rectangle.h"
+
+/* Partition of the warehouse into a grid of zones. Each zone runs its own reservation rounds in the reservation master and has its own
+ * broadcast topic, agents only receive the broadcasts of the zones near their routes. A reservation belongs to every zone its inflated
+ * AABB touches, so conflicting reservations always share a zone. The layout is set by the parameters zone_columns and zone_rows of
+ * the reservation master, a single zone (the default) disables the zone topics */
+class ReservationZones {
+public:
+	ReservationZones() = default;
+
+	/** Constructor
+	 * @param width Width of the warehouse
+	 * @param height Height of the warehouse
+	 * @param columns Number of zones along x
+	 * @param rows Number of zones along y */
+	ReservationZones(float width, float height, int columns, int rows);
+
+	/** Reads the zone layout from the parameters of the reservation master
+	 * @param width Width of the warehouse
+	 * @param height Height of the warehouse
+	 * @return The zone layout */
+	static ReservationZones fromParameters(float width, float height);
+
+	/** Returns the number of zones
+	 * @return Zone count */
+	int getZoneCount() const;
+
+	/** Checks whether there is more than one zone
+	 * @return True iff broadcasts are published on zone topics */
+	bool isPartitioned() const;
+
+	/** Returns the zones touched by an axis aligned box, sorted
+	 * @param minX Minimum x of the box
+	 * @param maxX Maximum x of the box
+	 * @param minY Minimum y of the box
+	 * @param maxY Maximum y of the box
+	 * @return The zones */
+	std::vector<int> getZonesInBox(double minX, double maxX, double minY, double maxY) const;
+
+	/** Returns the zones touched by the inflated AABBs of reservations, sorted
+	 * @param reservations The reservations
+	 * @param margin Distance by which the AABBs are enlarged
+	 * @return The zones */
+	std::vector<int> getZones(const std::vector<Rectangle>& reservations, double margin) const;
+
+	/** Returns the broadcast topic of a zone
+	 * @param zone The zone
+	 * @return Topic name */
+	static std::string getBroadcastTopic(int zone);
+
+	/** Returns the sorted union of two sorted zone lists
+	 * @param a Zones
+	 * @param b Zones
+	 * @return The zones in a or b */
+	static std::vector<int> unite(const std::vector<int>& a, const std::vector<int>& b);
+
+private:
+	int columns = 1;
+	int rows = 1;
+
+	// Edge lengths of a zone
+	float zoneWidth = 1;
+	float zoneHeight = 1;
+
+	/** Returns the zone column or row of a coordinate, clamped to the grid
+	 * @param coordinate The coordinate
+	 * @param zoneSize Edge length of a zone along the axis of the coordinate
+	 * @param count Number of zones along the axis
+	 * @return Column or row */
+	static int toZoneIndex(double coordinate, float zoneSize, int count);
+};
+
+#endif //PROTOTYPE_RESERVATIONZONES_HPP
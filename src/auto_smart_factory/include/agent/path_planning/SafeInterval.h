@@ -0,0 +1,13 @@
+#ifndef PROTOTYPE_SAFEINTERVAL_HPP
+#define PROTOTYPE_SAFEINTERVAL_HPP
+
+// Time interval in which a position is not covered by any reservation of another robot
+struct SafeInterval {
+	// First point in time the position is free
+	double start;
+
+	// Last point in time the position is free
+	double end;
+};
+
+#endif //PROTOTYPE_SAFEINTERVAL_HPP
@@ -0,0 +1,150 @@
+#ifndef PROTOTYPE_SIPPPATHPLANNER_HPP
+#define PROTOTYPE_SIPPPATHPLANNER_HPP
+
+#include <vector>
+#include <unordered_set>
+#include <utility>
+
+#include "agent/path_planning/ThetaStarMap.h"
+#include "agent/path_planning/Path.h"
+#include "agent/path_planning/SafeInterval.h"
+#include "agent/path_planning/TimedEdge.h"
+#include "agent/path_planning/TimingCalculator.h"
+#include "RobotHardwareProfile.h"
+
+// Safe Interval Path Planner on the theta* map. Search states are pairs of a node and one of its safe intervals, which are derived from the reservations once per node.
+// Waiting only happens inside safe intervals, so the earliest arrival per state is optimal. Like theta*, a state connects to the prev of the expanded state if there is line of sight.
+// The planner is intended to be used only once, a new one needs to be constructed for every path query
+class SippPathPlanner {
+public:
+	/** Constructor for a new path query
+	 * @param thetaStarMap ThetaStar Map to search on
+	 * @param hardwareProfile HardwareProfile for the robot the path if for
+	 * @param start Start point with orientation
+	 * @param target Target point with orientation
+	 * @param startingTime Start Time of the path
+	 * @param targetReservationTime Duration of the reservations at the path target
+	 * @param ignoreStartingReservations Should reservations at the starting position be ignored? */
+	explicit SippPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations);
+
+	/** Search the path
+	 * @return The path. Check path.isValid before using it */
+	Path findPath();
+
+private:
+	// A node during one of its safe intervals
+	struct State {
+		const GridNode* node;
+
+		// Index of the safe interval of the node
+		int interval;
+
+		// Earliest known arrival time
+		double time;
+
+		// Index of the previous state, -1 for the start state
+		int prev;
+
+		// Waiting time at the previous path node
+		double waitTimeAtPrev;
+	};
+
+	// Open list entry: (priority, state index)
+	typedef std::pair<double, int> QueueEntry;
+	struct QueueEntryComparator {
+		bool operator()(QueueEntry const& lhs, QueueEntry const& rhs) const {
+			return lhs.first > rhs.first;
+		}
+	};
+
+	// Maximum number of times the departure is moved past blocking reservations for one connection
+	static constexpr int maxDepartureAttempts = 8;
+
+	// Maximum waiting time at a single node, later safe intervals are treated as unreachable
+	static constexpr double maxWaitingTime = 1000;
+
+	/** Returns the safe intervals of a node, computing them on first use
+	 * @param node The node
+	 * @return The safe intervals, sorted by time */
+	const std::vector<SafeInterval>& getSafeIntervals(const GridNode* node);
+
+	/** Returns the index of the state for a node and safe interval, creating it on first use
+	 * @param node The node
+	 * @param interval Index of the safe interval
+	 * @return Index of the state */
+	int getState(const GridNode* node, int interval);
+
+	/** Computes the heuristic for a node, the estimated duration to the target
+	 * @param node The node
+	 * @return The heuristic */
+	double getHeuristic(const GridNode* node) const;
+
+	/** Estimated time to turn towards and drive to a node, starting from a state
+	 * @param from The state
+	 * @param to The node
+	 * @return Turning and driving time */
+	double getDrivingAndTurningTime(int from, const GridNode* to) const;
+
+	/** Connects a state to every safe interval of a node that can be reached when departing within [minDeparture, maxDeparture]
+	 * and updates the reached states
+	 * @param from Index of the state to depart from
+	 * @param minDeparture Earliest departure time
+	 * @param maxDeparture Latest departure time, the robot waits at the state until then
+	 * @param to The node to connect to
+	 * @param queue The open list */
+	void connect(int from, double minDeparture, double maxDeparture, const GridNode* to, std::vector<QueueEntry>& queue);
+
+	/** Construct the path from the chain of previous states
+	 * @param targetState Index of the reached target state
+	 * @return The constructed Path */
+	Path constructPath(int targetState) const;
+
+	// ==== Query information ====
+	// Theta star map used for path queries
+	ThetaStarMap* map;
+
+	// Robot hardware profile in use
+	RobotHardwareProfile* hardwareProfile;
+
+	// Path start and target point, orientation in degree
+	OrientedPoint start;
+	OrientedPoint target;
+
+	// Used timing calculator
+	TimingCalculator timing;
+
+	// Used path start and target node
+	const GridNode* startNode;
+	const GridNode* targetNode;
+
+	// Static distance field towards the target node, nullptr if the target has none
+	const float* targetDistanceField;
+
+	// Path starting time offset
+	double startingTime;
+
+	// Reservation duration at path target
+	double targetReservationTime;
+
+	// Is this path query valid?
+	bool isValidPathQuery;
+
+	// List of reservations to use the smaller variant for
+	std::unordered_set<ReservationId> smallerReservations;
+
+	// ==== Search data ====
+	// Safe intervals per node id, computed on first use
+	std::vector<std::vector<SafeInterval>> safeIntervals;
+	std::vector<bool> hasSafeIntervals;
+
+	// State index per node id and safe interval, -1 if the state was not reached yet
+	std::vector<std::vector<int>> stateIndices;
+
+	// All reached states
+	std::vector<State> states;
+
+	// Reservations along the connection currently checked. Kept to reuse its storage
+	TimedEdge edge;
+};
+
+#endif //PROTOTYPE_SIPPPATHPLANNER_HPP
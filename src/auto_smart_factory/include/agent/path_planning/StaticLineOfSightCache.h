@@ -0,0 +1,52 @@
+#ifndef PROTOTYPE_STATICLINEOFSIGHTCACHE_HPP
+#define PROTOTYPE_STATICLINEOFSIGHTCACHE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/* Bounded cache of static line of sight results between two theta* nodes, keyed by the ordered node id pair.
+ * It is shared by a theta* map and all its copies and views, which may plan on several threads. The entries are split into shards
+ * with their own lock, so concurrent path queries rarely wait for each other. A shard which is full is cleared, its results are
+ * computed again when they are needed. */
+class StaticLineOfSightCache {
+public:
+	StaticLineOfSightCache() = default;
+	StaticLineOfSightCache(const StaticLineOfSightCache& other) = delete;
+	StaticLineOfSightCache& operator=(const StaticLineOfSightCache& other) = delete;
+
+	/** Looks up a cached result
+	 * @param key Ordered node id pair
+	 * @param isFree The cached result (output)
+	 * @return True iff a result is cached for the key */
+	bool find(uint64_t key, bool& isFree) const;
+
+	/** Caches a result. Clears the shard of the key if it is full
+	 * @param key Ordered node id pair
+	 * @param isFree The result */
+	void insert(uint64_t key, bool isFree);
+
+	/** Returns a copy of all cached results, e.g. to write them to an artifact file
+	 * @return The results keyed by the ordered node id pair */
+	std::unordered_map<uint64_t, bool> getEntries() const;
+
+private:
+	struct Shard {
+		mutable std::mutex mutex;
+		std::unordered_map<uint64_t, bool> entries;
+	};
+
+	// Must match the number of top bits used by getShardIndex
+	static constexpr int shardCount = 16;
+	Shard shards[shardCount];
+
+	// Maximum number of results per shard, about one million results in total
+	static constexpr unsigned long maxShardEntryCount = (1ul << 20) / shardCount;
+
+	/** Returns the shard a key is stored in
+	 * @param key Ordered node id pair
+	 * @return Index of the shard */
+	static int getShardIndex(uint64_t key);
+};
+
+#endif //PROTOTYPE_STATICLINEOFSIGHTCACHE_HPP
@@ -0,0 +1,54 @@
+#ifndef PROTOTYPE_STATICOBSTACLEGRID_HPP
+#define PROTOTYPE_STATICOBSTACLEGRID_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+#include "agent/path_planning/RectangleBatch.h"
+
+/* Rasterized static obstacles. Every grid cell touched by the inflated AABB of an obstacle is marked in a bit-packed occupancy bitmap.
+ * Queries only walk the cells covered by the query geometry and test only the obstacles of occupied cells with a batched intersection test,
+ * so the cost is proportional to the segment length instead of the number of obstacles. Results are identical to testing every obstacle. */
+class StaticObstacleGrid {
+public:
+	StaticObstacleGrid() = default;
+
+	/** Constructor
+	 * @param obstacles The static obstacles
+	 * @param width Width of the rasterized area
+	 * @param height Height of the rasterized area
+	 * @param cellSize Edge length of a grid cell */
+	StaticObstacleGrid(const std::vector<Rectangle>& obstacles, float width, float height, float cellSize);
+
+	/** Checks whether a point is inside any inflated obstacle
+	 * @param p The point
+	 * @return True iff the point is inside any inflated obstacle */
+	bool isInsideAnyObstacle(const Point& p) const;
+
+	/** Checks whether the line segment intersects any inflated obstacle
+	 * @param lStart Line segment start
+	 * @param lEnd Line segment end
+	 * @return True iff the line segment does not intersect any inflated obstacle */
+	bool isLineOfSightFree(const Point& lStart, const Point& lEnd) const;
+
+private:
+	// One bit per grid cell in row-major order, set iff the cell is touched by any obstacle
+	std::vector<uint64_t> occupancy;
+
+	// Obstacles per occupied cell in compressed row storage: Obstacles of cell c are cellObstacles[cellStart[c], cellStart[c + 1])
+	std::vector<int> cellStart;
+	RectangleBatch cellObstacles;
+
+	float cellSize = 1.f;
+	int columns = 0;
+	int rows = 0;
+
+	/** Checks whether the occupancy bit of a cell is set
+	 * @param cell Row-major cell index
+	 * @return True iff the cell is touched by any obstacle */
+	bool isOccupied(int cell) const;
+};
+
+#endif //PROTOTYPE_STATICOBSTACLEGRID_HPP
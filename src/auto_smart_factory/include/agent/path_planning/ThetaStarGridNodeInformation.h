@@ -13,6 +13,12 @@ public:
 	// Waiting time at the previous path node. This is ONLY for reversal path construction
 	double waitTimeAtPrev;
 	
+	// Was the connection to prev checked against obstacles? Lazy theta* assumes connections and checks them when the node is expanded
+	bool isConnectionVerified;
+	
+	// Was an assumed connection of this node blocked? Further connections are checked immediately, so the node is not reopened endlessly
+	bool hadBlockedConnection;
+	
 	ThetaStarGridNodeInformation(const GridNode* node, ThetaStarGridNodeInformation* prev, double time);
 };
 
@@ -1,11 +1,22 @@
 #ifndef PROTOTYPE_THETASTARMAP_HPP
 #define PROTOTYPE_THETASTARMAP_HPP
 
-#include <map>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <cstdint>
+#include <string>
 
 #include "Math.h"
 #include "agent/path_planning/GridNode.h"
 #include "agent/path_planning/TimedLineOfSightResult.h"
+#include "agent/path_planning/TimedEdge.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
+#include "agent/path_planning/SafeInterval.h"
+#include "agent/path_planning/ClusterGraph.h"
+#include "agent/path_planning/ThetaStarMapArtifact.h"
+#include "agent/path_planning/StaticLineOfSightCache.h"
 
 #include "visualization_msgs/Marker.h"
 
@@ -17,24 +28,84 @@ private:
 	// Pointer to the normal map for line of sight checks
 	Map* map;
 	
-	// Theta* Grid Nodes
-	std::map<Point, GridNode*, Math::PointComparator> nodes;
+	// Theta* Grid Nodes in row-major order (index = iy * columns + ix), nullptr if the grid position is inside an obstacle
+	std::vector<GridNode*> grid;
+	
+	// Additional nodes (tray approach points) which are not aligned to the grid
+	std::vector<GridNode*> additionalNodes;
+	
+	// Additional nodes sorted by the grid index of the cell they are in, used for constant time lookups
+	std::unordered_map<int, std::vector<GridNode*>> additionalNodesPerCell;
 	
 	// Resolution of the Theta* Grid Nodes
-	float resolution;
+	float resolution = 1.f;
+	
+	// Position of the grid node with index (0, 0)
+	Point origin;
+	
+	// Grid dimensions
+	int columns = 0;
+	int rows = 0;
+	
+	// Search data reused by all path queries on this map
+	ThetaStarSearchArena searchArena;
+	
+	// Lazily filled results of static line of sight checks between two nodes. Static obstacles never change after the map was created,
+	// so entries never become invalid. Shared with copies and views of this map
+	std::shared_ptr<StaticLineOfSightCache> staticLineOfSightCache;
+	
+	// Precomputed static part this map was created from, nullptr if it was built from scratch. Holds the static line of sight results
+	// which are not in the cache and the memory of the distance fields
+	std::shared_ptr<const ThetaStarMapArtifact> artifact;
+	
+	// Static shortest path distances from every node to fixed path targets, keyed by the id of the target node, indexed by node id.
+	// Never change after creation, so copies of this map share them
+	std::unordered_map<int, std::shared_ptr<const float>> distanceFields;
+	
+	// Abstract graph for hierarchical path queries, nullptr if the map is searched flat. Static, so copies of this map share it
+	std::shared_ptr<const ClusterGraph> clusterGraph;
 	
 public:
 	ThetaStarMap() = default;
 	ThetaStarMap(Map* map, float resolution);
+	
+	/** Constructor from a precomputed artifact. Creates the nodes and links stored in the artifact without any geometric checks
+	 * and uses its static line of sight results and distance fields
+	 * @param map The map this theta* map belongs to
+	 * @param artifact The artifact, must have been built for the configuration of the map */
+	ThetaStarMap(Map* map, std::shared_ptr<const ThetaStarMapArtifact> artifact);
+	
+	/** Creates a view of a map for another map, e.g. of another agent in the same process or a copy used on another thread. The grid nodes
+	 * never change once the map is built, so the view shares them and the thread safe static line of sight cache with the original,
+	 * but has its own search data. Views must not outlive the original
+	 * @param other The theta* map to share the nodes of
+	 * @param map The map the view belongs to
+	 * @return The view */
+	static ThetaStarMap createView(const ThetaStarMap& other, Map* map);
 
 	/** Compute if and when a certain line of sight connection is free
 	 * @param pos1 Start point
 	 * @param pos2 End point
 	 * @param startTime time when the connection starts at the start point
 	 * @param endTime time when the connection is planned to end at the end point
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
-	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const;
+	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const;
+
+	/** Compute if and when a certain line of sight connection between two nodes is free. The static part of the check is cached
+	 * @param node1 Start node
+	 * @param node2 End node
+	 * @param startTime time when the connection starts at the start node
+	 * @param endTime time when the connection is planned to end at the end node
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
+	TimedLineOfSightResult whenIsTimedLineOfSightFree(const GridNode* node1, double startTime, const GridNode* node2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const;
+	
+	/** Checks whether the static line of sight between two nodes is free. Results are cached
+	 * @param node1 First node
+	 * @param node2 Second node
+	 * @return True iff no static obstacle blocks the line of sight */
+	bool isStaticLineOfSightFree(const GridNode* node1, const GridNode* node2) const;
 
 	/** Check if certain line of sight connection is actually free for both driving and waiting during the connection
 	 * @param pos1 Start point
@@ -42,25 +113,71 @@ public:
 	 * @param startTime time when the connection starts at the start point
 	 * @param waitingTime Time to wait at the start point
 	 * @param drivingTime Time to drive from start to end
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
-	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const;
+	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::unordered_set<ReservationId>& smallerReservations) const;
+
+	/** Collect everything needed for timed checks along the connection of two nodes, see Map::collectTimedEdge. The static part is cached
+	 * @param node1 Start node
+	 * @param node2 End node
+	 * @param earliestTime Earliest start time of the checks which will be done on the edge
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param edge The edge to fill (output) */
+	void collectTimedEdge(const GridNode* node1, const GridNode* node2, double earliestTime, const std::unordered_set<ReservationId>& smallerReservations, TimedEdge& edge) const;
+	
+	/** Compute the safe intervals of a node, see Map::getSafeIntervals
+	 * @param node The node
+	 * @param smallerReservations ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return The safe intervals, sorted by time */
+	std::vector<SafeInterval> getSafeIntervals(const GridNode* node, const std::unordered_set<ReservationId>& smallerReservations) const;
 	
 	/** Searches the GridNode closest to the specified position
 	 * @param pos Position to search from 
 	 * @return Closest grid node, nullptr if none could be found */
 	const GridNode* getNodeClosestTo(const Point& pos) const;
 
-	/** Returns a list of rectangles which contain the specified point
+	/** Returns the ids of all reservations of other agents which contain the specified point
 	 * @param p The point
-	 * @return List of rectangles */
-	std::vector<Rectangle> getRectanglesOnStartingPoint(Point p) const;
+	 * @return Set of reservation ids */
+	std::unordered_set<ReservationId> getReservationIdsOnStartingPoint(Point p) const;
 
-	/** Add a new Theta* Grid Node at the specified position and connect it to neighbouring nodes
+	/** Add a new Theta* Grid Node at the specified position and connect it to neighbouring nodes. Must not be called once copies or views of this map exist
 	 * @param Pos Position for the new node
 	 * @return True iff a new node was successfully added. Failure reasons include: Position is outside of the map, There already exists a GridNode at this exact position */
 	bool addAdditionalNode(Point pos);
 	
+	/** Computes the static any-angle distance field towards the node closest to the given target, by a backward search over the node links.
+	 * Does nothing if the target is not in the theta* map or the field already exists
+	 * @param target Fixed path target, e.g. a tray approach point */
+	void addDistanceField(const Point& target);
+	
+	/** Returns the static distance field towards a target node
+	 * @param target The target node
+	 * @return Shortest static path length from every node (getNodeCount values, indexed by node id) to the target, infinity if unreachable. nullptr if no field exists for the target */
+	const float* getDistanceField(const GridNode* target) const;
+	
+	/** Writes the nodes, links, static line of sight results and distance fields of this map to an artifact file, see ThetaStarMapArtifact::write
+	 * @param path Path of the artifact file
+	 * @param configHash Hash of the configuration this map was built for
+	 * @return True iff the file was written */
+	bool writeArtifact(const std::string& path, uint64_t configHash) const;
+	
+	/** Builds the abstract graph for hierarchical path queries. Must be called after all additional nodes were added
+	 * @param clusterSize Edge length of the clusters in grid cells */
+	void buildClusterGraph(int clusterSize);
+	
+	/** Returns the abstract graph for hierarchical path queries
+	 * @return The cluster graph, nullptr if none was built */
+	const ClusterGraph* getClusterGraph() const;
+	
+	/** Returns the number of nodes in this map. Node ids are in the range [0, getNodeCount())
+	 * @return Node count */
+	int getNodeCount() const;
+	
+	/** Returns the search arena which holds the per node search data for path queries on this map
+	 * @return The search arena */
+	ThetaStarSearchArena* getSearchArena();
+	
 	/** Returns the owner if of the theta* Map
 	 * @return Owner Id*/
 	int getOwnerId() const;
@@ -71,10 +188,41 @@ public:
 
 
 private:
-	/** Connect the specified Grid Node to the node at the target position
+	/** Connect the specified Grid Node to the grid node at the target grid position
 	 * @param node Node to connect 
-	 * @param targetPos Position to look for the node to connect to */
-	void linkToNode(GridNode* node, Point targetPos);
+	 * @param ix Column of the node to connect to
+	 * @param iy Row of the node to connect to */
+	void linkToNode(GridNode* node, int ix, int iy);
+
+	/** Returns the grid node at the specified grid position
+	 * @param ix Column
+	 * @param iy Row
+	 * @return The grid node, nullptr if the position is outside of the grid or blocked */
+	GridNode* getGridNode(int ix, int iy) const;
+
+	/** Returns the grid index of the cell the specified position is in. Positions outside the grid are clamped to the grid border
+	 * @param pos The position
+	 * @param ix Column of the cell (output)
+	 * @param iy Row of the cell (output) */
+	void getCellOf(const Point& pos, int& ix, int& iy) const;
+	
+	/** Returns the position of the grid node at the specified grid position
+	 * @param ix Column
+	 * @param iy Row
+	 * @return Position of the grid node */
+	Point getGridPosition(int ix, int iy) const;
+
+	/** Updates nearestNode if any node in the specified cell is closer to pos than shortestDistance
+	 * @param pos Position to search from
+	 * @param ix Column of the cell
+	 * @param iy Row of the cell
+	 * @param nearestNode Nearest node found so far (input/output)
+	 * @param shortestDistance Squared distance to the nearest node found so far (input/output) */
+	void findClosestNodeInCell(const Point& pos, int ix, int iy, const GridNode*& nearestNode, double& shortestDistance) const;
+	
+	/** Returns all grid nodes and additional nodes
+	 * @return List of all nodes */
+	std::vector<const GridNode*> getAllNodes() const;
 };
 
 
@@ -0,0 +1,170 @@
+#ifndef PROTOTYPE_THETASTARMAPARTIFACT_HPP
+#define PROTOTYPE_THETASTARMAPARTIFACT_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "auto_smart_factory/WarehouseConfiguration.h"
+#include "agent/path_planning/GridNode.h"
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+
+/* Precomputed static part of a theta* map, stored in a versioned binary file which is memory mapped on load.
+ * Contains the nodes (grid nodes and tray approach nodes), their links, the cached static line of sight results and the distance fields,
+ * so a theta* map can be created from it without any geometric checks. Files are keyed by a hash of everything the static part is computed from.
+ * All values are stored in native byte order, files are only valid on machines with the same architecture */
+class ThetaStarMapArtifact {
+public:
+	/** Maps an artifact file and validates it
+	 * @param path Path of the artifact file
+	 * @param configHash Expected hash, see computeConfigHash
+	 * @return The artifact, nullptr if the file does not exist, is invalid or was built for another configuration */
+	static std::shared_ptr<const ThetaStarMapArtifact> load(const std::string& path, uint64_t configHash);
+
+	/** Writes an artifact file. The file is written to a temporary file first and then renamed, so readers never see partial files
+	 * @param path Path of the artifact file
+	 * @param configHash Hash of the configuration the map was built for, see computeConfigHash
+	 * @param resolution Resolution of the grid nodes
+	 * @param origin Position of the grid node with index (0, 0)
+	 * @param columns Grid columns
+	 * @param rows Grid rows
+	 * @param nodes All nodes indexed by node id, nullptr for grid positions without a node
+	 * @param lineOfSight Static line of sight results keyed by the ordered node id pair
+	 * @param distanceFields Distance fields (getNodeCount values each) keyed by the id of their target node
+	 * @return True iff the file was written */
+	static bool write(const std::string& path, uint64_t configHash, float resolution, const Point& origin, int columns, int rows,
+	                  const std::vector<const GridNode*>& nodes, const std::unordered_map<uint64_t, bool>& lineOfSight,
+	                  const std::unordered_map<int, const float*>& distanceFields);
+
+	/** Computes the hash of everything the static part of a theta* map depends on: map dimensions and resolution, obstacles, trays,
+	 * idle positions, robot dimensions and the file format version
+	 * @param warehouseConfig The warehouse configuration
+	 * @param obstacles Static obstacles of the map
+	 * @return The hash */
+	static uint64_t computeConfigHash(const auto_smart_factory::WarehouseConfiguration& warehouseConfig, const std::vector<Rectangle>& obstacles);
+
+	ThetaStarMapArtifact(const ThetaStarMapArtifact& other) = delete;
+	ThetaStarMapArtifact& operator=(const ThetaStarMapArtifact& other) = delete;
+	~ThetaStarMapArtifact();
+
+	float getResolution() const;
+	Point getOrigin() const;
+	int getColumns() const;
+	int getRows() const;
+
+	/** Returns the number of nodes, including ids of grid positions without a node
+	 * @return Node count */
+	int getNodeCount() const;
+
+	/** Checks if a node exists
+	 * @param id Node id
+	 * @return True iff there is a node with this id */
+	bool hasNode(int id) const;
+
+	/** Returns the position of a node
+	 * @param id Node id of an existing node
+	 * @return The position */
+	Point getNodePosition(int id) const;
+
+	/** Returns the linked neighbours of a node, in the order they were linked
+	 * @param id Node id
+	 * @param count Number of neighbours (output)
+	 * @return Node ids of the neighbours */
+	const int32_t* getLinks(int id, int& count) const;
+
+	/** Looks up a stored static line of sight result
+	 * @param key Ordered node id pair, see ThetaStarMap::isStaticLineOfSightFree
+	 * @param isFree The stored result (output)
+	 * @return True iff a result is stored for the pair */
+	bool findStaticLineOfSight(uint64_t key, bool& isFree) const;
+
+	/** Returns the number of stored distance fields
+	 * @return Distance field count */
+	int getDistanceFieldCount() const;
+
+	/** Returns the id of the target node of a distance field
+	 * @param index Index of the distance field
+	 * @return Node id */
+	int getDistanceFieldTarget(int index) const;
+
+	/** Returns a distance field, see ThetaStarMap::getDistanceField
+	 * @param index Index of the distance field
+	 * @return getNodeCount distances, valid as long as this artifact exists */
+	const float* getDistanceField(int index) const;
+
+private:
+	// Incremented on every change of the file layout or of the way the stored data is computed
+	static constexpr uint32_t version = 1;
+
+	// Sections of the file, in file order
+	enum Section {
+		NODE_FLAGS = 0,
+		NODE_POSITIONS,
+		LINK_STARTS,
+		LINKS,
+		LINE_OF_SIGHT_KEYS,
+		LINE_OF_SIGHT_VALUES,
+		DISTANCE_FIELD_TARGETS,
+		DISTANCE_FIELDS,
+		SECTION_COUNT
+	};
+
+	// Byte range of a section, offsets are aligned to 8 bytes
+	struct SectionRange {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// File header, followed by the sections
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrderMark;
+		uint64_t configHash;
+		uint64_t fileSize;
+
+		double originX;
+		double originY;
+		float resolution;
+		int32_t columns;
+		int32_t rows;
+		int32_t nodeCount;
+
+		uint64_t linkCount;
+		uint64_t lineOfSightCount;
+		uint64_t distanceFieldCount;
+
+		SectionRange sections[SECTION_COUNT];
+	};
+
+	// Mapped file
+	void* data;
+	size_t size;
+
+	// Section contents inside the mapped file
+	const Header* header;
+	const uint8_t* nodeFlags;
+	const double* nodePositions;
+	const uint64_t* linkStarts;
+	const int32_t* links;
+	const uint64_t* lineOfSightKeys;
+	const uint8_t* lineOfSightValues;
+	const int32_t* distanceFieldTargets;
+	const float* distanceFields;
+
+	/** Constructor, takes ownership of a mapped file
+	 * @param data Start of the mapping
+	 * @param size Size of the mapping */
+	ThetaStarMapArtifact(void* data, size_t size);
+
+	/** Checks the header and the section bounds and sets the section pointers
+	 * @param configHash Expected hash
+	 * @return True iff the file is a valid artifact for the configuration */
+	bool validate(uint64_t configHash);
+};
+
+#endif //PROTOTYPE_THETASTARMAPARTIFACT_HPP
@@ -0,0 +1,74 @@
+#ifndef PROTOTYPE_THETASTAROPENLIST_HPP
+#define PROTOTYPE_THETASTAROPENLIST_HPP
+
+#include <vector>
+#include <utility>
+
+#include "agent/path_planning/GridNode.h"
+#include "agent/path_planning/ThetaStarGridNodeInformation.h"
+
+/* Open list of theta* searches: a binary min heap of node records ordered by priority. Every node is queued at most once and its heap position
+ * is tracked by node id, so changing the priority of a queued node updates its entry in place instead of adding a duplicate entry */
+class ThetaStarOpenList {
+public:
+	// Recorded operation: a push of a node with a priority, or a pop if nodeId is -1
+	struct Operation {
+		int nodeId;
+		double priority;
+	};
+
+	ThetaStarOpenList() = default;
+
+	/** Remove all entries and prepare the list for nodes with ids in [0, nodeCount). Keeps the capacity
+	 * @param nodeCount Number of nodes in the theta star map */
+	void clear(int nodeCount);
+
+	/** Queue a node or change the priority of an already queued node
+	 * @param priority Priority of the node, lower priorities are popped first
+	 * @param information Search record of the node */
+	void push(double priority, ThetaStarGridNodeInformation* information);
+
+	/** Remove the node with the lowest priority. Must not be called on an empty list
+	 * @return Search record of the node */
+	ThetaStarGridNodeInformation* pop();
+
+	/** Checks if any node is queued
+	 * @return True iff no node is queued */
+	bool isEmpty() const;
+
+	/** Returns the number of queued nodes
+	 * @return Queued node count */
+	int getSize() const;
+
+	/** Record all following pushes and pops, e.g. to replay the queue operations of real searches in a benchmark
+	 * @param trace Operation log to append to, nullptr stops recording */
+	void setTrace(std::vector<Operation>* trace);
+
+private:
+	// Heap entry: (priority, node information)
+	typedef std::pair<double, ThetaStarGridNodeInformation*> Entry;
+
+	// Binary min heap
+	std::vector<Entry> heap;
+
+	// Heap index per node id, -1 if the node is not queued
+	std::vector<int> positions;
+
+	// Operation log, nullptr if not recording
+	std::vector<Operation>* trace = nullptr;
+
+	/** Move the entry at the specified heap index up until the heap property holds
+	 * @param index Heap index */
+	void siftUp(int index);
+
+	/** Move the entry at the specified heap index down until the heap property holds
+	 * @param index Heap index */
+	void siftDown(int index);
+
+	/** Store an entry at a heap index and update its position
+	 * @param index Heap index
+	 * @param entry The entry */
+	void place(int index, const Entry& entry);
+};
+
+#endif //PROTOTYPE_THETASTAROPENLIST_HPP
@@ -1,15 +1,23 @@
 #ifndef PROTOTYPE_THETASTARPATHPLANNER_HPP
 #define PROTOTYPE_THETASTARPATHPLANNER_HPP
 
-#include <queue>
+#include <vector>
+#include <unordered_set>
 
 #include "Math.h"
 #include "agent/path_planning/ThetaStarMap.h"
 #include "agent/path_planning/Path.h"
 #include "agent/path_planning/ThetaStarGridNodeInformation.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
+#include "agent/path_planning/TimedEdge.h"
 #include "RobotHardwareProfile.h"
 
 // This class represents a Theta* Path Planner. The search query parameters are specified with the constructor, the path planner is intended to be used only once. A new one needs to be constructed for every path query
+// A query can have multiple targets. The search then expands from the start until every target is reached and returns one path per target
+// In lazy mode (Lazy Theta*) the connection of a neighbour to the prev of the expanded node is assumed without line of sight check.
+// It is only checked when the neighbour is expanded, most neighbours are never expanded
+// On maps with a cluster graph only the corridor of clusters on the abstract paths to the targets is expanded. Targets which cannot be reached inside
+// the corridor are searched again on the whole map
 class ThetaStarPathPlanner {
 public:
 	/** Constructor for a new path query
@@ -21,8 +29,50 @@ public:
 	 * @param targetReservationTime Duration of the reservations at the path target
 	 * @param ignoreStartingReservations Should reservations at the starting position be ignored? */
 	explicit ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations);
+
+	/** Constructor for a new path query with multiple targets
+	 * @param thetaStarMap ThetaStar Mao to search on
+	 * @param hardwareProfile HardwareProfile for the robot the path if for
+	 * @param start Start point with orientation
+	 * @param targets Target points with orientation
+	 * @param startingTime Start Time of the paths
+	 * @param targetReservationTime Duration of the reservations at the path targets
+	 * @param ignoreStartingReservations Should reservations at the starting position be ignored? */
+	explicit ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, const std::vector<OrientedPoint>& targets, double startingTime, double targetReservationTime, bool ignoreStartingReservations);
 	
+	/** Search the path to the first target
+	 * @return The path. Check path.isValid before using it */
 	Path findPath();
+	
+	/** Search the paths to all targets with a single search
+	 * @return One path per target, in the order of the targets. Check path.isValid before using them */
+	std::vector<Path> findPaths();
+	
+	/** Search the path to the first target by repairing the search tree of the previous query in the search arena.
+	 * The tree must be rooted at the same start node. Every tree connection is rechecked against the current reservations,
+	 * shifted to the new starting time, invalid subtrees are reopened and only the border of the remaining tree is expanded again.
+	 * Falls back to a new search if the arena holds no suitable tree. Paths may be longer than the ones of a new search
+	 * @param previousStartingTime Starting time of the query which built the search tree
+	 * @return The path. Check path.isValid before using it */
+	Path repairPath(double previousStartingTime);
+	
+	/** Search the paths to all targets by repairing the search tree of the previous query in the search arena, see repairPath
+	 * @param previousStartingTime Starting time of the query which built the search tree
+	 * @return One path per target, in the order of the targets. Check path.isValid before using them */
+	std::vector<Path> repairPaths(double previousStartingTime);
+	
+	/** Use another search arena than the one of the theta star map, e.g. to keep the search tree for a later repair
+	 * @param arena The search arena */
+	void setSearchArena(ThetaStarSearchArena* arena);
+	
+	/** Enable or disable lazy line of sight checks (Lazy Theta*). Disabled by default
+	 * @param lazy Defer the line of sight checks of prev connections until nodes are expanded */
+	void setLazyLineOfSight(bool lazy);
+	
+	/** Returns how many timed line of sight checks lazy mode saved compared to checking every prev connection immediately.
+	 * Deferred checks and reconnections of nodes with blocked prev connections are subtracted
+	 * @return Saved line of sight checks of this query, 0 if lazy mode is disabled */
+	int getSavedLineOfSightChecks() const;
 
 private:
 	// Time value for unexplored Theta* Grid Nodes
@@ -31,32 +81,66 @@ private:
 	// Distance from the first curved point fro the curve corner for path smoothing 
 	double desiredDistanceForCurveEdge = 0.85f;
 
-	// GridNode Comparator
-	typedef std::pair<double, ThetaStarGridNodeInformation*> GridInformationPair;
-	struct GridInformationPairComparator {
-		bool operator()(GridInformationPair const& lhs, GridInformationPair const& rhs){
-			return lhs.first > rhs.first;
-		}
-	};
+	// State of a node of a search tree during repair
+	enum class TreeNodeState : unsigned char {UNKNOWN, IN_PROGRESS, VALID, INVALID};
+
+	/** Handles targets which need no search and resets the reached state of all others
+	 * @param paths The paths of the query, paths of targets which need no search are set
+	 * @return Number of targets which still need to be searched */
+	int prepareTargets(std::vector<Path>& paths);
+	
+	/** Start a new search in the search arena, containing only the start node */
+	void beginNewSearch();
 	
-	// Typedef for the Theta* Queue
-	typedef std::priority_queue<GridInformationPair, std::vector<GridInformationPair>, GridInformationPairComparator> GridInformationPairQueue;
+	/** Turn the search tree of the previous query in the search arena into the initial state of this query
+	 * @param previousStartingTime Starting time of the query which built the search tree
+	 * @return False iff the arena contains no search tree rooted at the start node and previous starting time */
+	bool repairSearchTree(double previousStartingTime);
 	
-	// Typedef for the Theta* Collection of already explored nodes
-	typedef std::map<Point, ThetaStarGridNodeInformation, Math::PointComparator> GridInformationMap;
+	/** Checks if the connection of a search tree node to its prev node is still free if both are reached later by the given shift
+	 * @param information The search tree node
+	 * @param shift Difference between the new and the previous starting time
+	 * @return True iff the connection is still free */
+	bool isTreeConnectionValid(ThetaStarGridNodeInformation* information, double shift) const;
+	
+	/** Expand the open list of the search arena until all remaining targets are reached or the open list is empty
+	 * @param paths The paths of the query, paths to reached targets are set
+	 * @param remainingTargets Number of targets not reached yet
+	 * @return Number of targets still not reached */
+	int search(std::vector<Path>& paths, int remainingTargets);
+	
+	/** Lazy theta*: check the assumed connection of a node to its prev. If it is blocked, the node is connected to the reached neighbour
+	 * which leads to the earliest arrival instead and queued again, or dropped if there is none
+	 * @param information The node to expand
+	 * @return True iff the assumed connection is free and the node can be expanded */
+	bool verifyConnection(ThetaStarGridNodeInformation* information);
+	
+	/** Compute a connection between two nodes, including the time to wait at the first node for timed obstacles to pass
+	 * @param from Node to connect from, its time and prev must be final
+	 * @param to Node to connect to
+	 * @param waitingTime Time to wait at from (output)
+	 * @param drivingTime Time to turn and drive from from to to (output)
+	 * @return True iff a connection was found */
+	bool getConnection(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to, double& waitingTime, double& drivingTime);
+	
+	/** Search targets which were not reached inside the corridor again on the whole map
+	 * @param paths The paths of the query, paths to reached targets are set
+	 * @param remainingTargets Number of targets not reached yet */
+	void searchWithoutCorridor(std::vector<Path>& paths, int remainingTargets);
 
-	/** Computes the heuristic for a specific position
+	/** Computes the heuristic for a specific position, which is the estimated duration to the closest target not reached yet.
+	 * Uses the static distance field of a target if it has one, the euclidean distance otherwise
 	 * @param current The current position
-	 * @param targetPos Target position of the current search query
 	 * @return Returns the computed heuristic */
-	double getHeuristic(ThetaStarGridNodeInformation* current, Point targetPos) const;
+	double getHeuristic(ThetaStarGridNodeInformation* current) const;
 	
 	/** Construct the path from the chain of previous pointers after theta* completion
 	 * @param startingTime Starting Time for the path 
 	 * @param targetInformation GridNode Information of the found path planning target
 	 * @param targetReservationTime Duration of the reservation at the path target 
+	 * @param target The path target point
 	 * @return The constructed Path */
-	Path constructPath(double startingTime, ThetaStarGridNodeInformation* targetInformation, double targetReservationTime) const;	
+	Path constructPath(double startingTime, ThetaStarGridNodeInformation* targetInformation, double targetReservationTime, const OrientedPoint& target) const;	
 
 	/** Smooth a given path
 	 * @param source Path to smooth 
@@ -118,6 +202,9 @@ private:
 	// Theta star map used for theta star path queries
 	ThetaStarMap* map;
 	
+	// Search arena holding the search tree and open list of this query
+	ThetaStarSearchArena* arena;
+	
 	// Robot hardware profile in use
 	RobotHardwareProfile* hardwareProfile;
 	
@@ -127,14 +214,20 @@ private:
 	// Path start point
 	OrientedPoint start;
 	
-	// Path target point
-	OrientedPoint target;
+	// Path target points
+	std::vector<OrientedPoint> targets;
 	
 	// Used path start node
 	const GridNode* startNode;
 	
-	// Path target node
-	const GridNode* targetNode;
+	// Path target nodes, nullptr if the target is not in the theta* map
+	std::vector<const GridNode*> targetNodes;
+	
+	// Static distance fields towards the target nodes, nullptr if the target has none
+	std::vector<const float*> targetDistanceFields;
+	
+	// Has the search already reached the target with the same index
+	std::vector<bool> isTargetReached;
 	
 	// Path starting time offset
 	double startingTime;
@@ -146,7 +239,23 @@ private:
 	bool isValidPathQuery;
 	
 	// List of reservations to ignore/use smaller variant for
-	std::vector<Rectangle> smallerReservations;
+	std::unordered_set<ReservationId> smallerReservations;
+	
+	// Abstract graph of the theta* map, nullptr if the map is searched flat
+	const ClusterGraph* clusterGraph;
+	
+	// Clusters the search may expand, flag per cluster id. Empty if the whole map may be expanded
+	std::vector<bool> corridor;
+	
+	// Are prev connections assumed and only checked on expansion (Lazy Theta*)?
+	bool lazyLineOfSight = false;
+	
+	// Line of sight checks saved by lazy mode, see getSavedLineOfSightChecks
+	int savedLineOfSightChecks = 0;
+	
+	// Reservations along the connections to prev and current of the relaxed neighbour. Kept to reuse their storage
+	TimedEdge prevEdge;
+	TimedEdge currentEdge;
 };
 
 
@@ -0,0 +1,57 @@
+#ifndef PROTOTYPE_THETASTARSEARCHARENA_HPP
+#define PROTOTYPE_THETASTARSEARCHARENA_HPP
+
+#include <vector>
+#include <utility>
+
+#include "agent/path_planning/GridNode.h"
+#include "agent/path_planning/ThetaStarGridNodeInformation.h"
+#include "agent/path_planning/ThetaStarOpenList.h"
+
+/* Reusable storage for Theta* searches on one theta star map. Holds one ThetaStarGridNodeInformation per grid node, indexed by node id.
+ * Records are stamped with the generation of the search which last touched them, so starting a new search invalidates all records in O(1) */
+class ThetaStarSearchArena {
+public:
+	ThetaStarSearchArena() = default;
+	
+	/** Invalidate the data of the previous search and prepare the arena for a new one
+	 * @param nodeCount Number of nodes in the theta star map */
+	void beginSearch(int nodeCount);
+	
+	/** Returns the search record for the specified node. Records not yet touched by the current search are reset first
+	 * @param node The grid node
+	 * @param initialTime Time value to use for unexplored nodes
+	 * @return The search record of the node */
+	ThetaStarGridNodeInformation* getInformation(const GridNode* node, double initialTime);
+	
+	/** Returns the search record for the specified node if the current search touched it
+	 * @param node The grid node
+	 * @return The search record of the node, nullptr if the current search did not touch it */
+	ThetaStarGridNodeInformation* findInformation(const GridNode* node);
+	
+	/** Returns all nodes touched by the current search, in the order they were touched
+	 * @return Touched nodes */
+	const std::vector<const GridNode*>& getSearchedNodes() const;
+	
+	/** Returns the open list of the current search. It is emptied by beginSearch but keeps its capacity
+	 * @return Open list */
+	ThetaStarOpenList* getOpenList();
+
+private:
+	// Search records indexed by node id
+	std::vector<ThetaStarGridNodeInformation> records;
+	
+	// Generation of the search which last initialized the record with the same index
+	std::vector<unsigned int> generations;
+	
+	// Generation of the current search
+	unsigned int generation = 0;
+	
+	// Nodes whose record was initialized by the current search
+	std::vector<const GridNode*> searchedNodes;
+	
+	// Open list
+	ThetaStarOpenList openList;
+};
+
+#endif //PROTOTYPE_THETASTARSEARCHARENA_HPP
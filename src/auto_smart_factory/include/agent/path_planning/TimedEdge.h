@@ -0,0 +1,98 @@
+#ifndef PROTOTYPE_TIMEDEDGE_HPP
+#define PROTOTYPE_TIMEDEDGE_HPP
+
+#include <vector>
+
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+#include "agent/path_planning/TimedLineOfSightResult.h"
+
+/* Reservations of other robots relevant for one line segment, collected in a single pass over the reservation table (see Map::collectTimedEdge).
+ * All timed checks of a connection along the segment are evaluated on the collected reservations without touching the reservation table again.
+ * Geometric tests against the segment are only done for reservations whose time range matters for a check, and at most once per reservation */
+class TimedEdge {
+public:
+	TimedEdge() = default;
+
+	/** Remove all collected reservations and start collecting for a new segment
+	 * @param pos1 Segment start, where the robot waits
+	 * @param pos2 Segment end
+	 * @param isStaticLineOfSightFree Is the segment free of static obstacles? */
+	void reset(const Point& pos1, const Point& pos2, bool isStaticLineOfSightFree);
+
+	/** Add a reservation near the segment. The reservation must stay valid while the edge is used
+	 * @param reservation The reservation
+	 * @param isSmaller Should the smaller variant of the reservation be used because the robot starts in it? */
+	void addReservation(const Rectangle* reservation, bool isSmaller);
+
+	/** Compute if and when the line of sight along the segment is free, see Map::whenIsTimedLineOfSightFree
+	 * @param startTime time when the connection starts at the segment start, must not be before the collection start time
+	 * @param endTime time when the connection is planned to end at the segment end
+	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
+	TimedLineOfSightResult whenIsLineOfSightFree(double startTime, double endTime);
+
+	/** Check if a connection along the segment is free for both waiting and driving, see Map::isTimedConnectionFree
+	 * @param startTime time when the connection starts at the segment start, must not be before the collection start time
+	 * @param waitingTime Time to wait at the segment start
+	 * @param drivingTime Time to drive along the segment
+	 * @return True iff the connection is free */
+	bool isConnectionFree(double startTime, double waitingTime, double drivingTime);
+
+	/** Checks whether the segment is free of static obstacles
+	 * @return True iff no static obstacle blocks the segment */
+	bool isStaticLineOfSightFree() const;
+
+private:
+	// Geometric relations of a reservation to the segment
+	enum Relation : unsigned char {
+		BLOCKS_SEGMENT = 0,
+		CONTAINS_START = 1,
+		CONTAINS_END = 2
+	};
+
+	// Time range in which a relation holds. Swept capsules only hold the part of the segment near their owner
+	struct TimeRange {
+		double start;
+		double end;
+	};
+
+	// A collected reservation with the relations tested so far
+	struct Entry {
+		double startTime;
+		double endTime;
+
+		// Latest time at which any point of the reservation starts to be held
+		double latestStartTime;
+
+		const Rectangle* reservation;
+		bool isSmaller;
+
+		// Bit set of tested relations and of the relations which hold
+		unsigned char tested;
+		unsigned char holding;
+
+		// Time range per holding relation
+		TimeRange ranges[3];
+	};
+
+	/** Returns the time range in which a relation of a reservation to the segment holds, testing it on first use
+	 * @param entry The collected reservation
+	 * @param relation The relation
+	 * @return The time range, nullptr iff the relation never holds */
+	const TimeRange* getTimeRange(Entry& entry, Relation relation) const;
+
+	// Todo make adaptive - for now assume that every reservation can be left in x seconds
+	double minTimeToLeave = 5;
+
+	// The segment
+	Point pos1;
+	Point pos2;
+
+	// Is the segment free of static obstacles?
+	bool staticLineOfSightFree = true;
+
+	// Collected reservations
+	std::vector<Entry> entries;
+};
+
+#endif //PROTOTYPE_TIMEDEDGE_HPP
@@ -11,6 +11,7 @@
 #include "agent/task_handling/ChargingTask.h"
 #include "agent/task_handling/TrayScore.h"
 #include "agent/path_planning/ReservationManager.h"
+#include "agent/path_planning/PlanningWorkerPool.h"
 #include "auto_smart_factory/TaskAnnouncement.h"
 #include "auto_smart_factory/TaskRating.h"
 #include "auto_smart_factory/TaskEvaluation.h"
@@ -166,15 +167,42 @@ class TaskHandler
 		void sendEvaluationData();
 
 		/**
-		 * Answer all announcements in the announcement queue
+		 * State of the task handler an announcement is scored against, captured when the announcement is handed to a worker
+		 */
+		struct AnnouncementContext {
+			// estimated duration and battery level after all queued tasks
+			double queuedDuration;
+			double estimatedBatteryAfterQueuedTasks;
+
+			// position and time at which the robot could start the announced task
+			OrientedPoint startPosition;
+			double startTime;
+
+			// trays of the announcement, in the order of the tray ids
+			std::vector<auto_smart_factory::Tray> inputTrays;
+			std::vector<auto_smart_factory::Tray> storageTrays;
+		};
+
+		/**
+		 * Hand all announcements in the announcement queue to the announcement workers.
+		 * All of them are scored against the same snapshot of the current reservations
 		 */
 		void answerAnnouncements();
 
 		/**
-		 * Answer the given announcement
-		 * @param taskannouncement
+		 * Captures the state needed to score the given announcement
+		 * @param taskAnnouncement
+		 * @return the announcement context
 		 */
-		void answerAnnouncement(auto_smart_factory::TaskAnnouncement& taskAnnouncement);
+		AnnouncementContext getAnnouncementContext(const auto_smart_factory::TaskAnnouncement& taskAnnouncement);
+
+		/**
+		 * Answer the given announcement. Runs on an announcement worker
+		 * @param taskAnnouncement
+		 * @param context, the state captured when the announcement was handed to the worker
+		 * @param workerMap, the map of the worker, containing the reservation snapshot
+		 */
+		void answerAnnouncement(const auto_smart_factory::TaskAnnouncement& taskAnnouncement, const AnnouncementContext& context, Map& workerMap);
 
 		/**
 		 * calculate the distance from a position to a target position
@@ -222,6 +250,12 @@ class TaskHandler
 
 		// the list of unanswered rask announcements
 		std::list<auto_smart_factory::TaskAnnouncement> announcements;
+
+		// number of threads scoring announcements
+		static constexpr int announcementWorkerCount = 2;
+
+		// workers scoring announcements, so path planning never blocks the update loop
+		PlanningWorkerPool* announcementWorkers;
 		
 		// distance from the current position (in front of a tray) to the targeted tray
 		double lastApproachDistance;
@@ -6,31 +6,189 @@
 #include <thread>
 #include <random>
 #include <vector>
+#include <unordered_set>
+#include <map>
+#include <cstdint>
 #include <exception>
 #include <sstream>
 #include <time.h>
+#include "std_msgs/Float64.h"
 #include "auto_smart_factory/ReservationRequest.h"
+#include "auto_smart_factory/ReservationBroadcast.h"
+#include "auto_smart_factory/GetReservationSnapshot.h"
+#include "agent/path_planning/ReservationTable.h"
+#include "agent/path_planning/ReservationZones.h"
 
+/* Grants reservation requests of the robots in auction rounds. Keeps the granted reservations of all robots.
+ * The warehouse is partitioned into zones (see ReservationZones), every zone resolves its own rounds over the requests touching it.
+ * In event driven mode the first request of a zone round opens a short collection window and the round is resolved when it closes,
+ * emergency stops are resolved immediately. Otherwise all rounds are resolved every tick (see ReservationMasterNode.cpp).
+ * A round votes for every request which does not conflict with a grant the requester did not know when planning, including the grants
+ * earlier in the same round in the order of the bids, or with a request still waiting for the votes of other zones. Every request names the
+ * last broadcast its path was planned with, all grants of later broadcasts are unknown to the requester. A request is granted when all
+ * its zones voted for it and denied as soon as one zone votes against it, so a request spanning several zones is granted in all of them or in none */
 class ReservationMaster {
 public:
 	explicit ReservationMaster();
 
 	virtual ~ReservationMaster() = default;
 
+	/* Resolves the emergency stops and the current round of every zone */
 	void update();
 
+	/* Returns whether rounds are resolved by incoming requests instead of by calls to update every tick
+	 * @return True iff event driven */
+	bool isEventDriven() const;
+
 private:
+	// A request waiting for the votes of its zones
+	struct PendingRequest {
+		auto_smart_factory::ReservationRequest msg;
+		std::vector<Rectangle> reservations;
+		// Zones touched by the reservations, sorted
+		std::vector<int> zones;
+		// Number of zones which voted for the request
+		int votes = 0;
+		// Wall time at which the request was received
+		double receiveTime = 0;
+	};
+
+	// The last granted request of a robot
+	struct Grant {
+		std::vector<Rectangle> reservations;
+		std::vector<int> zones;
+		// Sequence number of the broadcast of the grant
+		uint64_t broadcastSequence = 0;
+	};
+
+	struct Zone {
+		// Granted reservations touching the zone
+		ReservationTable reservations;
+		// Requests of the next round
+		std::vector<unsigned long> roundRequests;
+		// Requests the zone voted for which wait for the votes of other zones
+		std::vector<unsigned long> votedRequests;
+		ros::Publisher broadcastPublisher;
+		ros::WallTimer collectionWindowTimer;
+		// Sequence number of the last broadcast on the topic of the zone
+		uint64_t broadcastSequence = 0;
+		// Sequence number of the broadcast of the last grant which changed the reservations of the zone
+		uint64_t grantSequence = 0;
+	};
+
+	ros::NodeHandle pn;
 	ros::Publisher reservationBroadcastPublisher;
+	ros::Publisher requestLatencyPublisher;
 	ros::Subscriber reservationRequestSubscriber;
-	
+	ros::ServiceServer reservationSnapshotServer;
+
 	void reservationRequestCallback(const auto_smart_factory::ReservationRequest& msg);
+	bool reservationSnapshotCallback(auto_smart_factory::GetReservationSnapshot::Request& req, auto_smart_factory::GetReservationSnapshot::Response& res);
+
+	// Requests which are not answered yet, by request id
+	std::map<unsigned long, PendingRequest> pendingRequests;
+	unsigned long nextRequestId = 0;
+
+	// Emergency stops which are not resolved yet
+	std::vector<unsigned long> emergencyStopRequests;
+
+	// Resolve rounds on incoming requests, parameter event_driven (default off, enabled in the launch files)
+	bool eventDriven = false;
+
+	// Duration of the collection window in seconds, parameter collection_window
+	double collectionWindow = 0.005;
+
+	// Latencies from receiving a request to broadcasting the answer of the most recent requests, used as ring buffer
+	std::vector<double> requestLatencies;
+	unsigned long requestLatencyCount = 0;
+	static constexpr int requestLatencyWindow = 1000;
 	
-	std::vector<auto_smart_factory::ReservationRequest> requests;
-	
-	void sendDenyMessage(int requestIndex);
-	void sendReservationBroadcastMessage(int requestIndex);
-	void sendEmergencyStopBroadcastMessage(int requestIndex);
+	// Minimum time between two logs of the request totals in seconds. Rounds are resolved far more often
+	static constexpr double requestTotalsLogPeriod = 10.0;
+
+	// Zone layout, parameters zone_columns and zone_rows
+	ReservationZones zoneLayout;
+	std::vector<Zone> zones;
+
+	// Last grant of every robot which was granted reservations. These replace the initial reservations of the agents
+	std::map<int, Grant> grants;
+
+	// Changes on every start, so agents can tell broadcasts of a restarted master apart
+	uint32_t epoch = 0;
+
+	// Sequence number of the last broadcast
+	uint64_t broadcastSequence = 0;
 
+	// Edge length of the cells of the reservations spatial index
+	static constexpr float reservationCellSize = 1.f;
+
+	// Number of granted and denied requests since the start
+	unsigned long grantedRequestCount = 0;
+	unsigned long deniedRequestCount = 0;
+
+	/* Resolves the current round of a zone
+	 * @param zone: the zone */
+	void resolveRound(int zone);
+
+	/* Grants the pending emergency stops and denies the requests in their zones, which were planned without them */
+	void resolveEmergencyStops();
+
+	/* Grants a request in all zones, replacing all reservations of its owner, and broadcasts the grant
+	 * @param requestId: id of the pending request */
+	void grantRequest(unsigned long requestId);
+
+	/* Denies a request in all zones and broadcasts the denial
+	 * @param requestId: id of the pending request */
+	void denyRequest(unsigned long requestId);
+
+	/* Removes an answered request from the rounds and votes of its zones and records its latency
+	 * @param requestId: id of the request */
+	void finishRequest(unsigned long requestId);
+
+	/* Numbers and publishes a broadcast on /reservation_broadcast and on the topics of the specified zones
+	 * @param msg: the broadcast
+	 * @param broadcastZones: zones whose topics get the broadcast */
+	void publishBroadcast(auto_smart_factory::ReservationBroadcast& msg, const std::vector<int>& broadcastZones);
+
+	/* Publishes a numbered broadcast on the topics of the specified zones
+	 * @param msg: the broadcast
+	 * @param broadcastZones: the zones */
+	void publishZoneBroadcast(auto_smart_factory::ReservationBroadcast msg, const std::vector<int>& broadcastZones);
+
+	/* Returns the requested reservations
+	 * @param msg: the request
+	 * @return The reservations */
+	static std::vector<Rectangle> getReservationsFromRequest(const auto_smart_factory::ReservationRequest& msg);
+
+	/* Checks whether a request conflicts in a zone with the reservations of other robots granted after the last broadcast known to the requester
+	 * or with requests the zone voted for which wait for other zones
+	 * @param zone: the zone
+	 * @param request: the request
+	 * @return True iff any requested reservation conflicts */
+	bool isConflictingInZone(int zone, const PendingRequest& request) const;
+
+	/* Checks whether a zone voted for a request of a robot which waits for other zones
+	 * @param zone: the zone
+	 * @param ownerId: id of the robot
+	 * @return True iff there is such a request */
+	bool hasVotedForOwner(int zone, int ownerId) const;
+
+	/* Replaces the reservations of a robot in the table of a zone
+	 * @param zone: the zone
+	 * @param ownerId: id of the robot
+	 * @param reservations: all granted reservations of the robot, only the ones touching the zone are stored */
+	void replaceZoneReservations(int zone, int ownerId, const std::vector<Rectangle>& reservations);
+
+	/* Records the latency of an answered request
+	 * @param latency: time from receiving the request to broadcasting the answer */
+	void recordRequestLatency(double latency);
+
+	/* Publishes the median of the latencies of the most recent requests
+	 * @return The median latency */
+	double publishRequestLatencyMedian();
+	
+	/* Publishes the median latency and logs the number of granted and denied requests, at most once per requestTotalsLogPeriod */
+	void logRequestTotals();
 };
 
-#endif /* AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONMASTER_H_ */
\ No newline at end of file
+#endif /* AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONMASTER_H_ */
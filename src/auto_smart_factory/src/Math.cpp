@@ -1,5 +1,7 @@
 #include <cmath>
 #include <time.h>
+#include <limits>
+#include <algorithm>
 #include <include/Math.h>
 
 
@@ -129,6 +131,10 @@ double Math::getDistanceToLineSegment(const Point& lStart, const Point& lEnd, co
 	Point line = lEnd - lStart;
 	Point startToPoint = point - lStart;
 	double lengthSquared = getDistanceSquared(lStart, lEnd);
+	if(lengthSquared <= 0) {
+		return getDistance(lStart, point);
+	}
+	
 	double t = dotProduct(line, startToPoint) / lengthSquared;
 
 	if(t <= 0) {
@@ -140,6 +146,87 @@ double Math::getDistanceToLineSegment(const Point& lStart, const Point& lEnd, co
 	}
 }
 
+double Math::getDistanceBetweenLineSegments(const Point& l1Start, const Point& l1End, const Point& l2Start, const Point& l2End) {
+	// Crossing segments, only possible if both have a length
+	if(l1Start != l1End && l2Start != l2End && doLineSegmentsIntersect(l1Start, l1End, l2Start, l2End)) {
+		return 0;
+	}
+	
+	return std::min({getDistanceToLineSegment(l1Start, l1End, l2Start), getDistanceToLineSegment(l1Start, l1End, l2End),
+	                 getDistanceToLineSegment(l2Start, l2End, l1Start), getDistanceToLineSegment(l2Start, l2End, l1End)});
+}
+
+bool Math::getLineSegmentRangeNearLineSegment(const Point& lStart, const Point& lEnd, const Point& qStart, const Point& qEnd, double distance, double& fromAlpha, double& toAlpha) {
+	Point dir = lEnd - lStart;
+	double dirLengthSquared = dotProduct(dir, dir);
+	
+	if(dirLengthSquared <= 0) {
+		fromAlpha = 0;
+		toAlpha = 1;
+		return getDistanceToLineSegment(qStart, qEnd, lStart) <= distance;
+	}
+	
+	// All points within the distance of q form a capsule. Its intersection with the line through l is the hull of the
+	// intersections with the disks around both ends of q and with the rectangle along q
+	double lower = std::numeric_limits<double>::infinity();
+	double upper = -std::numeric_limits<double>::infinity();
+	
+	const Point centers[2] = {qStart, qEnd};
+	for(const Point& center : centers) {
+		Point toStart = lStart - center;
+		double b = dotProduct(dir, toStart);
+		double discriminant = b * b - dirLengthSquared * (dotProduct(toStart, toStart) - distance * distance);
+		
+		if(discriminant >= 0) {
+			double root = std::sqrt(discriminant);
+			lower = std::min(lower, (-b - root) / dirLengthSquared);
+			upper = std::max(upper, (-b + root) / dirLengthSquared);
+		}
+	}
+	
+	double length = getDistance(qStart, qEnd);
+	if(length > EPS) {
+		Point along = (qEnd - qStart) / length;
+		Point across = Point(-along.y, along.x);
+		Point toStart = lStart - qStart;
+		
+		double rectangleFrom = -std::numeric_limits<double>::infinity();
+		double rectangleTo = std::numeric_limits<double>::infinity();
+		clipLineRange(dotProduct(toStart, along), dotProduct(dir, along), 0, length, rectangleFrom, rectangleTo);
+		clipLineRange(dotProduct(toStart, across), dotProduct(dir, across), -distance, distance, rectangleFrom, rectangleTo);
+		
+		if(rectangleFrom <= rectangleTo) {
+			lower = std::min(lower, rectangleFrom);
+			upper = std::max(upper, rectangleTo);
+		}
+	}
+	
+	fromAlpha = std::max(lower, 0.0);
+	toAlpha = std::min(upper, 1.0);
+	
+	return fromAlpha <= toAlpha;
+}
+
+void Math::clipLineRange(double offset, double slope, double min, double max, double& fromAlpha, double& toAlpha) {
+	// Restrict [fromAlpha, toAlpha] to the alphas with offset + alpha * slope in [min, max]
+	if(std::abs(slope) < EPS) {
+		if(offset < min || offset > max) {
+			fromAlpha = std::numeric_limits<double>::infinity();
+			toAlpha = -std::numeric_limits<double>::infinity();
+		}
+		return;
+	}
+	
+	double first = (min - offset) / slope;
+	double second = (max - offset) / slope;
+	if(first > second) {
+		std::swap(first, second);
+	}
+	
+	fromAlpha = std::max(fromAlpha, first);
+	toAlpha = std::min(toAlpha, second);
+}
+
 int Math::getDirectionToLineSegment(const Point& lStart, const Point& lEnd, const Point& point) {
 	Point nEnd = lEnd - lStart;
 	Point nPoint = point - lStart;
@@ -311,6 +398,10 @@ bool Math::doesLineSegmentIntersectNonAxisAlignedRectangle(const Point& lStart,
 }
 
 bool Math::isPointInRectangle(const Point& p, const Rectangle& rectangle) {
+	if(rectangle.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		return isPointInCapsule(p, rectangle);
+	}
+	
 	// https://math.stackexchange.com/a/190373
 	// (0<AM⋅AB<AB⋅AB)∧(0<AM⋅AD<AD⋅AD)
 	bool isInAxisAligned = isPointInAxisAlignedRectangle(p, rectangle);
@@ -361,9 +452,151 @@ bool Math::isPointInAxisAlignedRectangle(const Point& p, const Rectangle& rectan
 }
 
 bool Math::doesLineSegmentIntersectRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle) {
-	if(rectangle.getIsAxisAligned()) {
+	if(rectangle.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		return doesLineSegmentIntersectCapsule(lStart, lEnd, rectangle);
+	} else if(rectangle.getIsAxisAligned()) {
 		return doesLineSegmentIntersectAxisAlignedRectangle(lStart, lEnd, rectangle);
 	} else {
 		return doesLineSegmentIntersectNonAxisAlignedRectangle(lStart, lEnd, rectangle);
 	}
 }
+
+bool Math::doesLineSegmentIntersectCapsule(const Point& lStart, const Point& lEnd, const Rectangle& capsule) {
+	return getDistanceBetweenLineSegments(lStart, lEnd, capsule.getAxisStart(), capsule.getAxisEnd()) <= capsule.getRadiusInflated();
+}
+
+bool Math::isPointInCapsule(const Point& p, const Rectangle& capsule) {
+	return getDistanceToLineSegment(capsule.getAxisStart(), capsule.getAxisEnd(), p) <= capsule.getRadiusInflated();
+}
+
+bool Math::getReservedTimeRangeOnLineSegment(const Point& lStart, const Point& lEnd, const Rectangle& reservation, double& start, double& end) {
+	if(reservation.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		// Only the section of the center line near the segment is relevant
+		double fromAlpha, toAlpha;
+		if(!getLineSegmentRangeNearLineSegment(reservation.getAxisStart(), reservation.getAxisEnd(), lStart, lEnd, reservation.getRadiusInflated(), fromAlpha, toAlpha)) {
+			return false;
+		}
+		
+		reservation.getHoldTimeRange(fromAlpha, toAlpha, start, end);
+		return true;
+	}
+	
+	if(!doesLineSegmentIntersectRectangle(lStart, lEnd, reservation)) {
+		return false;
+	}
+	
+	start = reservation.getStartTime();
+	end = reservation.getEndTime();
+	return true;
+}
+
+bool Math::getReservedTimeRangeAtPoint(const Point& p, const Rectangle& reservation, double& start, double& end) {
+	if(reservation.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		return getReservedTimeRangeOnLineSegment(p, p, reservation, start, end);
+	}
+	
+	if(!isPointInRectangle(p, reservation)) {
+		return false;
+	}
+	
+	start = reservation.getStartTime();
+	end = reservation.getEndTime();
+	return true;
+}
+
+bool Math::doReservationsConflict(const Rectangle& r1, const Rectangle& r2) {
+	double start1 = r1.getStartTime();
+	double end1 = r1.getEndTime();
+	double start2 = r2.getStartTime();
+	double end2 = r2.getEndTime();
+	double fromAlpha, toAlpha;
+	
+	// Capsules only hold the part of their center line near the other reservation at the same time
+	if(r1.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		if(!getAxisRangeNearReservation(r1, r2, fromAlpha, toAlpha)) {
+			return false;
+		}
+		r1.getHoldTimeRange(fromAlpha, toAlpha, start1, end1);
+	}
+	
+	if(r2.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		if(!getAxisRangeNearReservation(r2, r1, fromAlpha, toAlpha)) {
+			return false;
+		}
+		r2.getHoldTimeRange(fromAlpha, toAlpha, start2, end2);
+	} else if(r1.getShape() != RectangleShape::SWEPT_CAPSULE && !doNonInflatedRectanglesOverlap(r1, r2)) {
+		return false;
+	}
+	
+	return start1 < end2 && start2 < end1;
+}
+
+bool Math::getAxisRangeNearReservation(const Rectangle& capsule, const Rectangle& other, double& fromAlpha, double& toAlpha) {
+	const Point& axisStart = capsule.getAxisStart();
+	const Point& axisEnd = capsule.getAxisEnd();
+	double radius = capsule.getSize().y * 0.5f;
+	
+	if(other.getShape() == RectangleShape::SWEPT_CAPSULE) {
+		return getLineSegmentRangeNearLineSegment(axisStart, axisEnd, other.getAxisStart(), other.getAxisEnd(), radius + other.getSize().y * 0.5f, fromAlpha, toAlpha);
+	}
+	
+	// The points within the radius of the rectangle form a convex area, so its intersection with the center line is the hull of
+	// the ranges near the edges and the range inside the rectangle
+	const Point* rect = other.getPointsNonInflated();
+	double lower = std::numeric_limits<double>::infinity();
+	double upper = -std::numeric_limits<double>::infinity();
+	
+	for(int i = 0; i < 4; i++) {
+		double edgeFrom, edgeTo;
+		if(getLineSegmentRangeNearLineSegment(axisStart, axisEnd, rect[i], rect[(i + 1) % 4], radius, edgeFrom, edgeTo)) {
+			lower = std::min(lower, edgeFrom);
+			upper = std::max(upper, edgeTo);
+		}
+	}
+	
+	Point dir = axisEnd - axisStart;
+	Point toStart = axisStart - rect[0];
+	Point ab = rect[1] - rect[0];
+	Point ad = rect[3] - rect[0];
+	double insideFrom = 0;
+	double insideTo = 1;
+	clipLineRange(dotProduct(toStart, ab), dotProduct(dir, ab), 0, dotProduct(ab, ab), insideFrom, insideTo);
+	clipLineRange(dotProduct(toStart, ad), dotProduct(dir, ad), 0, dotProduct(ad, ad), insideFrom, insideTo);
+	if(insideFrom <= insideTo) {
+		lower = std::min(lower, insideFrom);
+		upper = std::max(upper, insideTo);
+	}
+	
+	fromAlpha = lower;
+	toAlpha = upper;
+	
+	return fromAlpha <= toAlpha;
+}
+
+bool Math::doNonInflatedRectanglesOverlap(const Rectangle& r1, const Rectangle& r2) {
+	// Separating axis test with the edge directions of both rectangles
+	const Point* rectangles[2] = {r1.getPointsNonInflated(), r2.getPointsNonInflated()};
+	
+	for(const Point* rect : rectangles) {
+		const Point axes[2] = {rect[1] - rect[0], rect[3] - rect[0]};
+		
+		for(const Point& axis : axes) {
+			double min[2] = {std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+			double max[2] = {-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+			
+			for(int r = 0; r < 2; r++) {
+				for(int i = 0; i < 4; i++) {
+					double projection = dotProduct(rectangles[r][i], axis);
+					min[r] = std::min(min[r], projection);
+					max[r] = std::max(max[r], projection);
+				}
+			}
+			
+			if(max[0] <= min[1] || max[1] <= min[0]) {
+				return false;
+			}
+		}
+	}
+	
+	return true;
+}
@@ -2,15 +2,23 @@
 #include <auto_smart_factory/ReservationRequest.h>
 #include "agent/Agent.h"
 #include "warehouse_management/WarehouseManagement.h"
+#include "agent/AgentHost.h"
 
-Agent::Agent(std::string agent_id) {
+Agent::Agent(std::string agent_id) :
+	Agent(agent_id, ros::NodeHandle("~"), nullptr)
+{
+}
+
+Agent::Agent(std::string agent_id, ros::NodeHandle agent_node_handle, AgentHost* agent_host) :
+	pn(agent_node_handle),
+	host(agent_host)
+{
 	agentID = agent_id;
 	std::string idStr = agentID.substr(agentID.find('_') + 1);
 	agentIdInt = std::stoi(idStr);
 	position.z = -1;
 	map = nullptr;
 
-	ros::NodeHandle pn("~");
 	//setup init_agent service
 	pn.setParam(agentID, "~init");
 	init_srv = pn.advertiseService("init", &Agent::init, this);
@@ -59,7 +67,6 @@ bool Agent::init(auto_smart_factory::InitAgent::Request& req, auto_smart_factory
 }
 
 bool Agent::initialize(auto_smart_factory::WarehouseConfiguration warehouse_configuration, auto_smart_factory::RobotConfiguration robot_configuration) {
-	ros::NodeHandle pn("~");
 	warehouseConfig = warehouse_configuration;
 	robotConfig = robot_configuration;
 	
@@ -85,7 +92,6 @@ bool Agent::initialize(auto_smart_factory::WarehouseConfiguration warehouse_conf
 	vizPublicationTimer = pn.createTimer(ros::Duration(0.25f), &Agent::publishVisualisation, this); // in seconds
 	
 	reservationRequest_pub = pn.advertise<auto_smart_factory::ReservationRequest>("/reservation_request", 100, true);
-	reservationBroadcast_sub = pn.subscribe("/reservation_broadcast", 100, &Agent::reservationBroadcastCallback, this);
 
 	try {
 		motionPlanner = new MotionPlanner(this, robotConfig, &(motion_pub));
@@ -100,13 +106,43 @@ bool Agent::initialize(auto_smart_factory::WarehouseConfiguration warehouse_conf
 		for(auto o : warehouseConfig.map_configuration.obstacles) {
 			obstacles.emplace_back(Point(o.posX, o.posY), Point(o.sizeX, o.sizeY), o.rotation);
 		}
-		map = new Map(warehouseConfig, obstacles, hardwareProfile, agentIdInt);
+		// Precomputed theta* map, see ThetaStarMapArtifact. Empty to build the theta* map on every start
+		std::string thetaStarMapArtifact;
+		pn.getParam("theta_star_map_artifact", thetaStarMapArtifact);
+		if(host != nullptr) {
+			map = host->createAgentMap(warehouseConfig, obstacles, hardwareProfile, agentIdInt, thetaStarMapArtifact);
+		} else {
+			map = new Map(warehouseConfig, obstacles, hardwareProfile, agentIdInt, thetaStarMapArtifact);
+		}
+
+		// Path planner, "theta_star" (default), "lazy_theta_star" or "sipp"
+		std::string pathPlanner = "theta_star";
+		pn.getParam("path_planner", pathPlanner);
+		if(pathPlanner == "lazy_theta_star") {
+			map->setPathPlannerType(PathPlannerType::LAZY_THETA_STAR);
+		} else if(pathPlanner == "sipp") {
+			map->setPathPlannerType(PathPlannerType::SIPP);
+		} else if(pathPlanner != "theta_star") {
+			ROS_WARN("[Agent %d] Unknown path planner %s, using theta_star", agentIdInt, pathPlanner.c_str());
+		}
 
 		// Charging Management
 		chargingManagement = new ChargingManagement(this, warehouseConfig, robotConfig, map);
 
 		// Reservation Manager
 		reservationManager = new ReservationManager(&reservationRequest_pub, map, agentIdInt, warehouse_configuration);
+		if(host != nullptr) {
+			// Hosted agents get the broadcasts from the host, which applies them to the shared reservations only once
+			host->registerReservationManager(agentIdInt, reservationManager);
+		} else {
+			// Only the broadcasts of the zones near the own route if the warehouse is partitioned into zones
+			if(!reservationManager->receiveZoneBroadcasts()) {
+				reservationBroadcast_sub = pn.subscribe("/reservation_broadcast", 100, &Agent::reservationBroadcastCallback, this);
+			}
+			
+			// Restarted or late started agents learn the current reservations
+			reservationManager->synchronizeReservations();
+		}
 		
 		// Task Handler
 		taskHandler = new TaskHandler(this, &(taskrating_pub), &(taskEvaluation_pub), &(taskStarted_pub), map, motionPlanner, gripper, chargingManagement, reservationManager);
@@ -160,7 +196,6 @@ bool Agent::registerAgent() {
  * Sets up services to communicate with task planner.
  */
 void Agent::setupTaskHandling() {
-	ros::NodeHandle pn("~");
 	pn.setParam(agentID, "~assign_task");
 	assign_task_srv = pn.advertiseService("assign_task", &Agent::assignTask, this);
 }
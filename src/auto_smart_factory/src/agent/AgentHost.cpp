@@ -0,0 +1,79 @@
+#include "agent/AgentHost.h"
+
+#include "agent/Agent.h"
+#include "agent/path_planning/ThetaStarMapArtifact.h"
+
+AgentHost::AgentHost(const std::vector<std::string>& agentIds) {
+	for(const std::string& agentId : agentIds) {
+		agents.push_back(new Agent(agentId, ros::NodeHandle(agentId), this));
+	}
+
+	reservationBroadcast_sub = n.subscribe("/reservation_broadcast", 100, &AgentHost::reservationBroadcastCallback, this);
+}
+
+AgentHost::~AgentHost() {
+	for(Agent* agent : agents) {
+		delete agent;
+	}
+}
+
+void AgentHost::update() {
+	for(Agent* agent : agents) {
+		agent->update();
+	}
+}
+
+Map* AgentHost::createAgentMap(const auto_smart_factory::WarehouseConfiguration& warehouseConfig, std::vector<Rectangle>& obstacles, RobotHardwareProfile* hardwareProfile,
+                               int agentId, const std::string& thetaStarMapArtifactPath) {
+	uint64_t configHash = ThetaStarMapArtifact::computeConfigHash(warehouseConfig, obstacles);
+
+	if(sharedMap == nullptr) {
+		sharedMap.reset(new Map(warehouseConfig, obstacles, nullptr, -1, thetaStarMapArtifactPath));
+		sharedMapConfigHash = configHash;
+		sharedMapSynchronizer = ReservationSynchronizer(sharedMap.get());
+		sharedMapSynchronizer.bootstrap();
+		ROS_INFO("[agent host]: Built shared map for %lu agents", agents.size());
+	}
+
+	if(configHash != sharedMapConfigHash) {
+		ROS_ERROR("[agent host]: Warehouse configuration of agent %d differs from the shared map, using an own map", agentId);
+		agentsWithOwnMap.insert(agentId);
+		return new Map(warehouseConfig, obstacles, hardwareProfile, agentId, thetaStarMapArtifactPath);
+	}
+
+	return new Map(*sharedMap, hardwareProfile, agentId);
+}
+
+void AgentHost::registerReservationManager(int agentId, ReservationManager* reservationManager) {
+	if(agentsWithOwnMap.count(agentId) > 0) {
+		ownMapReservationManagers.push_back(reservationManager);
+		reservationManager->synchronizeReservations();
+	} else {
+		reservationManagers.push_back(reservationManager);
+		reservationManager->setMapSynchronizer(&sharedMapSynchronizer);
+	}
+}
+
+void AgentHost::reservationBroadcastCallback(const auto_smart_factory::ReservationBroadcast& msg) {
+	if(sharedMap != nullptr) {
+		std::vector<Rectangle> oldReservations;
+		std::vector<Rectangle> reservations;
+
+		ReservationSynchronizer::Action action = sharedMapSynchronizer.onBroadcast(msg);
+		if(action == ReservationSynchronizer::Action::APPLY_AND_HANDLE) {
+			ReservationManager::applyReservationBroadcast(sharedMap.get(), msg, oldReservations, reservations);
+		} else if(action == ReservationSynchronizer::Action::HANDLE) {
+			reservations = ReservationBroadcastCodec::decode(msg);
+		}
+
+		if(action != ReservationSynchronizer::Action::IGNORE) {
+			for(ReservationManager* reservationManager : reservationManagers) {
+				reservationManager->handleAppliedReservationBroadcast(msg, oldReservations, reservations);
+			}
+		}
+	}
+
+	for(ReservationManager* reservationManager : ownMapReservationManagers) {
+		reservationManager->reservationBroadcastCallback(msg);
+	}
+}
@@ -0,0 +1,25 @@
+#include "agent/AgentHost.h"
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "agent_host");
+	ros::NodeHandle nh;
+
+	if(argc < 2) {
+		ROS_INFO("usage: AgentHost agent_id [agent_id ...]");
+		return 1;
+	}
+
+	std::vector<std::string> agentIds(argv + 1, argv + argc);
+	AgentHost host(agentIds);
+
+	ROS_INFO("Agent host with %lu agents ready!", agentIds.size());
+
+	ros::Rate r(20); //20 hz
+	while(ros::ok()) {
+		host.update();
+		ros::spinOnce();
+		r.sleep();
+	}
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+#include <string>
+#include <vector>
+
+#include "ros/ros.h"
+#include "auto_smart_factory/GetWarehouseConfig.h"
+#include "agent/path_planning/Map.h"
+
+// Builds the theta* map artifact for the current warehouse configuration, so agents configured with the same artifact path start without
+// building their theta* map. Agents build and write a missing or outdated artifact themselves, this node only moves the work out of the agent start
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "theta_star_map_builder");
+	ros::NodeHandle nh;
+	ros::NodeHandle pn("~");
+
+	std::string artifactPath;
+	if(!pn.getParam("theta_star_map_artifact", artifactPath) || artifactPath.empty()) {
+		ROS_ERROR("[theta* map builder]: Parameter theta_star_map_artifact is not set!");
+		return 1;
+	}
+
+	std::string srv_name = "config_server/get_map_configuration";
+	ros::ServiceClient client = nh.serviceClient<auto_smart_factory::GetWarehouseConfig>(srv_name.c_str());
+	auto_smart_factory::GetWarehouseConfig srv;
+	ros::service::waitForService(srv_name.c_str());
+	if(!client.call(srv)) {
+		ROS_ERROR("[theta* map builder]: Failed to call service %s!", srv_name.c_str());
+		return 1;
+	}
+	auto_smart_factory::WarehouseConfiguration warehouseConfig = srv.response.warehouse_configuration;
+
+	std::vector<Rectangle> obstacles;
+	for(auto o : warehouseConfig.map_configuration.obstacles) {
+		obstacles.emplace_back(Point(o.posX, o.posY), Point(o.sizeX, o.sizeY), o.rotation);
+	}
+
+	// The hardware profile is only needed for path queries. Loads the artifact if it is up to date, otherwise builds and writes it
+	double buildStart = ros::Time::now().toSec();
+	Map map(warehouseConfig, obstacles, nullptr, 0, artifactPath);
+	ROS_INFO("[theta* map builder]: Theta* map artifact %s is up to date (%.2fs)", artifactPath.c_str(), ros::Time::now().toSec() - buildStart);
+
+	return 0;
+}
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "ros/ros.h"
+#include "auto_smart_factory/WarehouseConfiguration.h"
+#include "agent/path_planning/Map.h"
+#include "agent/path_planning/ThetaStarOpenList.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
+#include "Math.h"
+
+// Compares the theta* open list with the former one, a std::vector driven by std::push_heap/pop_heap which queued a duplicate entry for
+// every improved connection. The open list operations of theta* queries in dense traffic are recorded and replayed on both lists.
+// The former list skips stale entries during the replay, the former planner expanded them again, so its real cost was higher
+
+typedef std::pair<double, ThetaStarGridNodeInformation*> FormerEntry;
+typedef std::vector<ThetaStarOpenList::Operation> Trace;
+
+// Former open list comparator, turns the vector into a min heap
+struct FormerEntryComparator {
+	bool operator()(FormerEntry const& lhs, FormerEntry const& rhs) const {
+		return lhs.first > rhs.first;
+	}
+};
+
+// Rows of shelves with trays on both sides, separated by aisles and a cross aisle at every shelf row
+static void generateWarehouse(float width, float height, auto_smart_factory::WarehouseConfiguration& warehouseConfig, std::vector<Rectangle>& obstacles) {
+	warehouseConfig.map_configuration.width = width;
+	warehouseConfig.map_configuration.height = height;
+	warehouseConfig.map_configuration.margin = 0.1f;
+	warehouseConfig.map_configuration.resolutionThetaStar = 0.35f;
+
+	float shelfWidth = 1.2f;
+	float shelfLength = 8.0f;
+	float aisleWidth = 3.0f;
+	float crossAisleWidth = 3.5f;
+	unsigned int trayId = 0;
+
+	for(float y = crossAisleWidth; y + shelfLength <= height - crossAisleWidth; y += shelfLength + crossAisleWidth) {
+		for(float x = aisleWidth; x + shelfWidth <= width - aisleWidth; x += shelfWidth + aisleWidth) {
+			obstacles.emplace_back(Point(x + shelfWidth * 0.5f, y + shelfLength * 0.5f), Point(shelfWidth, shelfLength), 0);
+
+			for(float trayY = y + 1.0f; trayY < y + shelfLength; trayY += 2.0f) {
+				auto_smart_factory::Tray left;
+				left.id = trayId++;
+				left.type = "storage";
+				left.x = x - 0.25f;
+				left.y = trayY;
+				left.orientation = 180;
+				warehouseConfig.trays.push_back(left);
+
+				auto_smart_factory::Tray right = left;
+				right.id = trayId++;
+				right.x = x + shelfWidth + 0.25f;
+				right.orientation = 0;
+				warehouseConfig.trays.push_back(right);
+			}
+		}
+	}
+}
+
+// Plans one path per robot in turn. Every granted path is reserved, so later queries search through the traffic of all earlier robots
+static std::vector<Trace> recordTraces(Map& map, const std::vector<auto_smart_factory::Tray>& trays, int robotCount, double startingTime, double& searchMilliseconds,
+                                       int& validPaths) {
+	std::vector<Trace> traces;
+	ThetaStarSearchArena arena;
+	validPaths = 0;
+	searchMilliseconds = 0;
+
+	for(int robot = 0; robot < robotCount; robot++) {
+		OrientedPoint start = map.getPointInFrontOfTray(trays[(robot * 37) % trays.size()]);
+		OrientedPoint end = map.getPointInFrontOfTray(trays[(robot * 53 + trays.size() / 2) % trays.size()]);
+
+		traces.emplace_back();
+		arena.getOpenList()->setTrace(&traces.back());
+		double searchStart = ros::WallTime::now().toSec();
+		Path path = map.getThetaStarPath(start, end, startingTime + robot * 0.5, 5.0, true, &arena);
+		searchMilliseconds += (ros::WallTime::now().toSec() - searchStart) * 1e3;
+		arena.getOpenList()->setTrace(nullptr);
+
+		if(path.isValid()) {
+			validPaths++;
+			map.addReservations(path.generateReservations(robot + 2, true));
+		}
+	}
+
+	return traces;
+}
+
+static int getNodeCount(const std::vector<Trace>& traces) {
+	int nodeCount = 0;
+	for(const Trace& trace : traces) {
+		for(const ThetaStarOpenList::Operation& operation : trace) {
+			nodeCount = std::max(nodeCount, operation.nodeId + 1);
+		}
+	}
+	return nodeCount;
+}
+
+// Returns the time in milliseconds per replay of all traces. The sum of the popped priorities is returned as checksum
+static double replayIndexed(const std::vector<Trace>& traces, int nodeCount, int iterations, double& checksum, int& maxSize) {
+	std::vector<GridNode> nodes;
+	std::vector<ThetaStarGridNodeInformation> records;
+	for(int id = 0; id < nodeCount; id++) {
+		nodes.emplace_back(Point(0, 0), id);
+	}
+	for(const GridNode& node : nodes) {
+		records.emplace_back(&node, nullptr, 0);
+	}
+
+	ThetaStarOpenList openList;
+	checksum = 0;
+	maxSize = 0;
+
+	double start = ros::WallTime::now().toSec();
+	for(int i = 0; i < iterations; i++) {
+		for(const Trace& trace : traces) {
+			openList.clear(nodeCount);
+			for(const ThetaStarOpenList::Operation& operation : trace) {
+				if(operation.nodeId == -1) {
+					checksum += openList.pop()->time;
+				} else {
+					ThetaStarGridNodeInformation* information = &records[operation.nodeId];
+					information->time = operation.priority;
+					openList.push(operation.priority, information);
+					maxSize = std::max(maxSize, openList.getSize());
+				}
+			}
+		}
+	}
+
+	return (ros::WallTime::now().toSec() - start) * 1e3 / iterations;
+}
+
+// Returns the time in milliseconds per replay of all traces. Entries of nodes which were pushed again or already popped are stale and skipped
+static double replayFormer(const std::vector<Trace>& traces, int nodeCount, int iterations, double& checksum, int& maxSize, long& stalePops) {
+	std::vector<GridNode> nodes;
+	std::vector<ThetaStarGridNodeInformation> records;
+	for(int id = 0; id < nodeCount; id++) {
+		nodes.emplace_back(Point(0, 0), id);
+	}
+	for(const GridNode& node : nodes) {
+		records.emplace_back(&node, nullptr, 0);
+	}
+
+	std::vector<FormerEntry> queue;
+	std::vector<bool> isQueued(static_cast<unsigned long>(nodeCount), false);
+	FormerEntryComparator comparator;
+	checksum = 0;
+	maxSize = 0;
+	stalePops = 0;
+
+	double start = ros::WallTime::now().toSec();
+	for(int i = 0; i < iterations; i++) {
+		for(const Trace& trace : traces) {
+			for(const FormerEntry& entry : queue) {
+				isQueued[entry.second->node->id] = false;
+			}
+			queue.clear();
+
+			for(const ThetaStarOpenList::Operation& operation : trace) {
+				if(operation.nodeId == -1) {
+					while(true) {
+						std::pop_heap(queue.begin(), queue.end(), comparator);
+						FormerEntry entry = queue.back();
+						queue.pop_back();
+
+						if(isQueued[entry.second->node->id] && entry.first == entry.second->time) {
+							isQueued[entry.second->node->id] = false;
+							checksum += entry.first;
+							break;
+						}
+						stalePops++;
+					}
+				} else {
+					ThetaStarGridNodeInformation* information = &records[operation.nodeId];
+					information->time = operation.priority;
+					isQueued[operation.nodeId] = true;
+					queue.emplace_back(operation.priority, information);
+					std::push_heap(queue.begin(), queue.end(), comparator);
+					maxSize = std::max(maxSize, static_cast<int>(queue.size()));
+				}
+			}
+		}
+	}
+	stalePops /= iterations;
+
+	return (ros::WallTime::now().toSec() - start) * 1e3 / iterations;
+}
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "theta_star_open_list_benchmark");
+	ros::NodeHandle pn("~");
+
+	double width;
+	double height;
+	int robotCount;
+	int iterations;
+	pn.param("width", width, 60.0);
+	pn.param("height", height, 50.0);
+	pn.param("robots", robotCount, 200);
+	pn.param("iterations", iterations, 20);
+
+	auto_smart_factory::WarehouseConfiguration warehouseConfig;
+	std::vector<Rectangle> obstacles;
+	generateWarehouse(static_cast<float>(width), static_cast<float>(height), warehouseConfig, obstacles);
+
+	RobotHardwareProfile hardwareProfile(0.5, 60, 0.1, 0.1);
+	Map map(warehouseConfig, obstacles, &hardwareProfile, 1);
+
+	double searchMilliseconds;
+	int validPaths;
+	std::vector<Trace> traces = recordTraces(map, warehouseConfig.trays, robotCount, ros::Time::now().toSec() + 10, searchMilliseconds, validPaths);
+	int nodeCount = getNodeCount(traces);
+
+	// Pushes of already queued nodes are priority updates for the open list and duplicates for the former list
+	long pushes = 0;
+	long pops = 0;
+	long updates = 0;
+	std::vector<bool> isQueued(static_cast<unsigned long>(nodeCount), false);
+	for(const Trace& trace : traces) {
+		std::fill(isQueued.begin(), isQueued.end(), false);
+		for(const ThetaStarOpenList::Operation& operation : trace) {
+			if(operation.nodeId == -1) {
+				pops++;
+			} else {
+				pushes++;
+				if(isQueued[operation.nodeId]) {
+					updates++;
+				}
+				isQueued[operation.nodeId] = true;
+			}
+		}
+	}
+
+	double indexedChecksum;
+	double formerChecksum;
+	int indexedMaxSize;
+	int formerMaxSize;
+	long stalePops;
+	double indexedMilliseconds = replayIndexed(traces, nodeCount, iterations, indexedChecksum, indexedMaxSize);
+	double formerMilliseconds = replayFormer(traces, nodeCount, iterations, formerChecksum, formerMaxSize, stalePops);
+
+	if(std::abs(indexedChecksum - formerChecksum) > 1e-6 * std::abs(formerChecksum)) {
+		ROS_ERROR("[theta* open list benchmark]: Open lists popped different priorities");
+	}
+
+	ROS_INFO("[theta* open list benchmark]: %d queries (%d valid, %.2fms search each) on %d nodes: %ld pushes, %ld priority updates, %ld pops",
+	         robotCount, validPaths, searchMilliseconds / robotCount, nodeCount, pushes, updates, pops);
+	ROS_INFO("[theta* open list benchmark]: Former vector heap: %.3fms per query, max %d entries, %ld stale pops",
+	         formerMilliseconds / robotCount, formerMaxSize, stalePops);
+	ROS_INFO("[theta* open list benchmark]: Indexed heap: %.3fms per query, max %d entries",
+	         indexedMilliseconds / robotCount, indexedMaxSize);
+
+	return 0;
+}
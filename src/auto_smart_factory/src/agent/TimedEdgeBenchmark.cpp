@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "ros/ros.h"
+#include "auto_smart_factory/WarehouseConfiguration.h"
+#include "agent/path_planning/Map.h"
+#include "agent/path_planning/TimedEdge.h"
+#include "Math.h"
+
+// Compares the timed checks of one theta* edge on reservations collected once (Map::collectTimedEdge) with the former checks, which walked
+// the reservation table and repeated the geometric tests for every line of sight and connection check of the edge. Each edge is relaxed
+// the way ThetaStarPathPlanner::search does it, so it takes two to four checks
+
+// Path like reservations of other robots: waiting rectangles at the turns and swept capsules along short segments
+static std::vector<Rectangle> generatePathReservations(std::mt19937& random, float size, int ownerId, int count, double startTime) {
+	std::uniform_real_distribution<float> coordinate(1, size - 1);
+	std::uniform_real_distribution<float> offset(-4, 4);
+	std::uniform_real_distribution<double> duration(0.5, 6);
+	double reservationSize = ROBOT_RADIUS * 2;
+
+	std::vector<Rectangle> reservations;
+	Point pos(coordinate(random), coordinate(random));
+	double time = startTime;
+	for(int i = 0; i < count; i++) {
+		if(i % 4 == 0) {
+			reservations.emplace_back(pos, Point(reservationSize, reservationSize) * 0.98f, 0, time - 0.5, time + 1.5, ownerId, i + 1);
+		} else {
+			Point next(std::min<double>(std::max<double>(pos.x + offset(random), 1), size - 1), std::min<double>(std::max<double>(pos.y + offset(random), 1), size - 1));
+			double segmentDuration = duration(random);
+			Rectangle capsule = Rectangle::createSweptCapsule(pos, next, reservationSize * 0.5f, time - 0.6, time + segmentDuration + 1.2, 1.8, ownerId);
+			reservations.emplace_back(capsule.getPosition(), capsule.getSize(), capsule.getRotation(), capsule.getStartTime(), capsule.getEndTime(), ownerId,
+			                          i + 1, capsule.getShape(), capsule.getHoldDuration());
+			pos = next;
+			time += segmentDuration;
+		}
+	}
+
+	return reservations;
+}
+
+// A segment with the time the robot is at its start and the time it needs to drive along it
+struct EdgeQuery {
+	Point pos1;
+	Point pos2;
+	double startTime;
+	double drivingTime;
+};
+
+// Former checks, each walks the reservation table on its own and does the geometric tests of every reservation it visits
+class FormerEdge {
+public:
+	FormerEdge(const Map& map, const EdgeQuery& query, const std::unordered_set<ReservationId>& smallerReservations) :
+			map(map),
+			query(query),
+			smallerReservations(smallerReservations)
+	{
+	}
+
+	TimedLineOfSightResult whenIsLineOfSightFree(double startTime, double endTime) {
+		TimedLineOfSightResult result;
+		if(!map.isStaticLineOfSightFree(query.pos1, query.pos2)) {
+			result.blockedByStatic = true;
+			return result;
+		}
+
+		double minTimeToLeave = 5;
+		map.getReservations().forEachReservationOnLineSegment(query.pos1, query.pos2, startTime + 0.01f, std::numeric_limits<double>::max(), [&](int slot, const Rectangle& reservation) {
+			if(reservation.getOwnerId() == map.getOwnerId()) {
+				return true;
+			}
+
+			// Directly blocked
+			double start, end;
+			if(startTime + 0.01f <= reservation.getEndTime() && endTime >= reservation.getStartTime() && getTimeRangeOnSegment(reservation, start, end) &&
+			   startTime + 0.01f <= end && endTime >= start) {
+				result.blockedByTimed = true;
+				if(end > result.freeAfter) {
+					result.freeAfter = end;
+				}
+			}
+
+			// Upcoming obstacles
+			if(getTimeRangeAtPoint(query.pos2, reservation, start, end) && start > endTime) {
+				result.hasUpcomingObstacle = true;
+
+				double lastValidEntryTime = start - minTimeToLeave;
+				if(lastValidEntryTime < result.lastValidEntryTime) {
+					result.lastValidEntryTime = lastValidEntryTime;
+					result.freeAfterUpcomingObstacle = end;
+				}
+			}
+
+			return true;
+		});
+
+		double maxTime = endTime + 1000.f;
+		if((result.blockedByTimed && result.freeAfter > maxTime) ||
+		   (result.hasUpcomingObstacle && (result.lastValidEntryTime > maxTime || result.freeAfterUpcomingObstacle > maxTime))) {
+			result.blockedByStatic = true;
+		}
+
+		return result;
+	}
+
+	bool isConnectionFree(double startTime, double waitingTime, double drivingTime) {
+		double endTime = startTime + waitingTime + drivingTime;
+		bool isFree = true;
+
+		map.getReservations().forEachReservationOnLineSegment(query.pos1, query.pos2, startTime, endTime, [&](int slot, const Rectangle& reservation) {
+			if(reservation.getOwnerId() == map.getOwnerId()) {
+				return true;
+			}
+
+			// Check if the waiting part is free
+			double start, end;
+			if(startTime <= reservation.getEndTime() && startTime + waitingTime - 0.01f >= reservation.getStartTime() && getTimeRangeAtPoint(query.pos1, reservation, start, end) &&
+			   startTime <= end && startTime + waitingTime - 0.01f >= start) {
+				isFree = false;
+			}
+
+			// Check if the driving part is free
+			if(startTime + waitingTime + 0.01f <= reservation.getEndTime() && endTime >= reservation.getStartTime() && getTimeRangeOnSegment(reservation, start, end) &&
+			   startTime + waitingTime + 0.01f <= end && endTime >= start) {
+				isFree = false;
+			}
+
+			return isFree;
+		});
+
+		return isFree;
+	}
+
+private:
+	bool getTimeRangeOnSegment(const Rectangle& reservation, double& start, double& end) const {
+		if(smallerReservations.count(reservation.getId()) > 0) {
+			start = reservation.getStartTime();
+			end = reservation.getEndTime();
+			return Math::doesLineSegmentIntersectNonInflatedRectangle(query.pos1, query.pos2, reservation);
+		}
+		return Math::getReservedTimeRangeOnLineSegment(query.pos1, query.pos2, reservation, start, end);
+	}
+
+	bool getTimeRangeAtPoint(const Point& p, const Rectangle& reservation, double& start, double& end) const {
+		if(smallerReservations.count(reservation.getId()) > 0) {
+			start = reservation.getStartTime();
+			end = reservation.getEndTime();
+			return Math::isPointInNonInflatedRectangle(p, reservation);
+		}
+		return Math::getReservedTimeRangeAtPoint(p, reservation, start, end);
+	}
+
+	const Map& map;
+	const EdgeQuery& query;
+	const std::unordered_set<ReservationId>& smallerReservations;
+};
+
+// Relaxes an edge like ThetaStarPathPlanner::search: line of sight, connection check, and after a failed connection a second line of sight
+// check for the waiting time followed by another connection check. Returns the arrival time at the segment end, -1 if there is no connection
+template<typename Edge>
+static double relaxEdge(Edge& edge, const EdgeQuery& query, int& checks) {
+	double startTime = query.startTime;
+	double drivingTime = query.drivingTime;
+	double waitingTime = 0;
+
+	TimedLineOfSightResult result = edge.whenIsLineOfSightFree(startTime, startTime + drivingTime);
+	checks++;
+	if(result.blockedByStatic) {
+		return -1;
+	}
+
+	bool waitBecauseUpcomingObstacle = result.hasUpcomingObstacle && startTime + drivingTime >= result.lastValidEntryTime;
+	if(waitBecauseUpcomingObstacle) {
+		waitingTime = std::max(0.0, result.freeAfterUpcomingObstacle - startTime);
+	} else if(result.blockedByTimed) {
+		waitingTime = std::max(0.0, result.freeAfter - startTime);
+	}
+
+	checks++;
+	if(edge.isConnectionFree(startTime, waitingTime, drivingTime)) {
+		return startTime + waitingTime + drivingTime;
+	}
+
+	result = edge.whenIsLineOfSightFree(startTime, startTime + waitingTime + drivingTime);
+	checks++;
+	if(!result.blockedByStatic && result.blockedByTimed) {
+		waitingTime = std::max(waitingTime, result.freeAfter - startTime);
+
+		checks++;
+		if(edge.isConnectionFree(startTime, waitingTime, drivingTime)) {
+			return startTime + waitingTime + drivingTime;
+		}
+	}
+
+	return -1;
+}
+
+// Returns the time in nanoseconds per edge. The sum of the arrival times is returned as checksum
+static double benchmarkFormer(const Map& map, const std::vector<EdgeQuery>& queries, int iterations, double& checksum, long& checks) {
+	std::unordered_set<ReservationId> smallerReservations;
+	int checkCount = 0;
+	checksum = 0;
+
+	double start = ros::WallTime::now().toSec();
+	for(int i = 0; i < iterations; i++) {
+		for(const EdgeQuery& query : queries) {
+			FormerEdge edge(map, query, smallerReservations);
+			checksum += relaxEdge(edge, query, checkCount);
+		}
+	}
+	checks = checkCount / iterations;
+
+	return (ros::WallTime::now().toSec() - start) * 1e9 / (static_cast<double>(iterations) * queries.size());
+}
+
+// Returns the time in nanoseconds per edge. The sum of the arrival times is returned as checksum
+static double benchmarkCollected(const Map& map, const std::vector<EdgeQuery>& queries, int iterations, double& checksum, long& reservations) {
+	std::unordered_set<ReservationId> smallerReservations;
+	TimedEdge edge;
+	int checkCount = 0;
+	checksum = 0;
+	reservations = 0;
+
+	double start = ros::WallTime::now().toSec();
+	for(int i = 0; i < iterations; i++) {
+		for(const EdgeQuery& query : queries) {
+			map.collectTimedEdge(query.pos1, query.pos2, query.startTime, smallerReservations, edge);
+			checksum += relaxEdge(edge, query, checkCount);
+		}
+	}
+	double nanoseconds = (ros::WallTime::now().toSec() - start) * 1e9 / (static_cast<double>(iterations) * queries.size());
+
+	// Collected reservations per edge, counted outside of the timed loop
+	for(const EdgeQuery& query : queries) {
+		map.getReservations().forEachReservationOnLineSegment(query.pos1, query.pos2, query.startTime, std::numeric_limits<double>::max(), [&](int slot, const Rectangle& reservation) {
+			reservations++;
+			return true;
+		});
+	}
+
+	return nanoseconds;
+}
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "timed_edge_benchmark");
+	ros::NodeHandle pn("~");
+
+	double size;
+	int robotCount;
+	int reservationsPerRobot;
+	int edgeCount;
+	int iterations;
+	pn.param("size", size, 40.0);
+	pn.param("robots", robotCount, 100);
+	pn.param("reservations", reservationsPerRobot, 40);
+	pn.param("edges", edgeCount, 20000);
+	pn.param("iterations", iterations, 10);
+
+	// Empty square warehouse, only reservations block the edges
+	auto_smart_factory::WarehouseConfiguration warehouseConfig;
+	warehouseConfig.map_configuration.width = static_cast<float>(size);
+	warehouseConfig.map_configuration.height = static_cast<float>(size);
+	warehouseConfig.map_configuration.margin = 0.1f;
+	warehouseConfig.map_configuration.resolutionThetaStar = 0.35f;
+	std::vector<Rectangle> obstacles;
+
+	RobotHardwareProfile hardwareProfile(0.5, 60, 0.1, 0.1);
+	Map map(warehouseConfig, obstacles, &hardwareProfile, 1);
+
+	std::mt19937 random(42);
+	double startTime = 1000;
+	for(int robot = 0; robot < robotCount; robot++) {
+		map.addReservations(generatePathReservations(random, static_cast<float>(size), robot + 2, reservationsPerRobot, startTime + robot * 0.5));
+	}
+
+	// Short edges to grid neighbours and longer any angle edges to the parent of the current node, within the reserved time span
+	std::uniform_real_distribution<float> coordinate(1, static_cast<float>(size) - 1);
+	std::uniform_real_distribution<float> direction(-1, 1);
+	std::uniform_real_distribution<double> time(startTime, startTime + 100);
+	std::bernoulli_distribution isAnyAngle(0.5);
+	std::vector<EdgeQuery> queries;
+	while(static_cast<int>(queries.size()) < edgeCount) {
+		Point pos1(coordinate(random), coordinate(random));
+		float length = isAnyAngle(random) ? 3.0f : 0.35f;
+		Point pos2(pos1.x + direction(random) * length, pos1.y + direction(random) * length);
+		if(!map.isPointInMap(pos2)) {
+			continue;
+		}
+
+		double drivingTime = hardwareProfile.getDrivingDuration(Math::getDistance(pos1, pos2));
+		queries.push_back(EdgeQuery{pos1, pos2, time(random), drivingTime});
+	}
+
+	double formerChecksum;
+	double collectedChecksum;
+	long checks;
+	long reservations;
+	double formerNanoseconds = benchmarkFormer(map, queries, iterations, formerChecksum, checks);
+	double collectedNanoseconds = benchmarkCollected(map, queries, iterations, collectedChecksum, reservations);
+
+	if(formerChecksum != collectedChecksum) {
+		ROS_ERROR("[timed edge benchmark]: Former and collected checks differ");
+	}
+
+	ROS_INFO("[timed edge benchmark]: %d edges, %.2f checks and %.1f reservations near the segment per edge",
+	         edgeCount, static_cast<double>(checks) / edgeCount, static_cast<double>(reservations) / edgeCount);
+	ROS_INFO("[timed edge benchmark]: Former checks: %.0fns per edge | collected edge: %.0fns per edge (%.2fx)",
+	         formerNanoseconds, collectedNanoseconds, formerNanoseconds / collectedNanoseconds);
+
+	return 0;
+}
@@ -0,0 +1,267 @@
+#include <map>
+#include <queue>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#include "agent/path_planning/ClusterGraph.h"
+#include "Math.h"
+
+ClusterGraph::ClusterGraph(const std::vector<const GridNode*>& nodes, const Point& origin, float clusterWidth) :
+	origin(origin),
+	clusterWidth(clusterWidth)
+{
+	int nodeCount = 0;
+	for(const GridNode* node : nodes) {
+		nodeCount = std::max(nodeCount, node->id + 1);
+		clusterColumns = std::max(clusterColumns, static_cast<int>(std::floor((node->pos.x - origin.x) / clusterWidth + EPS)) + 1);
+		clusterRows = std::max(clusterRows, static_cast<int>(std::floor((node->pos.y - origin.y) / clusterWidth + EPS)) + 1);
+	}
+
+	clusterOfNode.assign(static_cast<unsigned long>(nodeCount), 0);
+	entranceOfNode.assign(static_cast<unsigned long>(nodeCount), -1);
+	entrancesOfCluster.resize(static_cast<unsigned long>(getClusterCount()));
+	for(const GridNode* node : nodes) {
+		clusterOfNode[node->id] = getClusterOf(node->pos);
+	}
+
+	// Links crossing a cluster border, grouped by the pair of clusters. The first node is in the cluster with the lower id
+	std::map<std::pair<int, int>, std::vector<std::pair<const GridNode*, const GridNode*>>> crossings;
+	for(const GridNode* node : nodes) {
+		for(const GridNode* neighbour : node->neighbours) {
+			if(clusterOfNode[node->id] < clusterOfNode[neighbour->id]) {
+				crossings[std::make_pair(clusterOfNode[node->id], clusterOfNode[neighbour->id])].emplace_back(node, neighbour);
+			}
+		}
+	}
+
+	for(const auto& border : crossings) {
+		// Split the border into continuous sections: crossings are in the same section if they share nodes or their nodes are linked
+		std::unordered_map<int, int> parents;
+		auto find = [&](int id) {
+			for(auto parent = parents.find(id); parent != parents.end(); parent = parents.find(id)) {
+				id = parent->second;
+			}
+			return id;
+		};
+		auto unite = [&](int a, int b) {
+			int rootA = find(a);
+			int rootB = find(b);
+			if(rootA != rootB) {
+				parents[rootA] = rootB;
+			}
+		};
+
+		std::unordered_map<int, const GridNode*> borderNodes;
+		for(const auto& crossing : border.second) {
+			borderNodes[crossing.first->id] = crossing.first;
+			borderNodes[crossing.second->id] = crossing.second;
+			unite(crossing.first->id, crossing.second->id);
+		}
+		for(const auto& borderNode : borderNodes) {
+			for(const GridNode* neighbour : borderNode.second->neighbours) {
+				if(borderNodes.count(neighbour->id) > 0) {
+					unite(borderNode.first, neighbour->id);
+				}
+			}
+		}
+
+		std::map<int, std::vector<std::pair<const GridNode*, const GridNode*>>> sections;
+		for(const auto& crossing : border.second) {
+			sections[find(crossing.first->id)].push_back(crossing);
+		}
+
+		// One entrance per section, at the crossing closest to the center of the section
+		for(const auto& section : sections) {
+			Point center;
+			for(const auto& crossing : section.second) {
+				center = center + (crossing.first->pos + crossing.second->pos) / 2.0;
+			}
+			center = center / static_cast<double>(section.second.size());
+
+			const std::pair<const GridNode*, const GridNode*>* best = nullptr;
+			double bestDistance = std::numeric_limits<double>::max();
+			for(const auto& crossing : section.second) {
+				double distance = Math::getDistanceSquared((crossing.first->pos + crossing.second->pos) / 2.0, center);
+				if(distance < bestDistance) {
+					bestDistance = distance;
+					best = &crossing;
+				}
+			}
+
+			int first = getOrAddEntrance(best->first);
+			int second = getOrAddEntrance(best->second);
+			auto length = static_cast<float>(Math::getDistance(best->first->pos, best->second->pos));
+			entrances[first].edges.emplace_back(second, length);
+			entrances[second].edges.emplace_back(first, length);
+		}
+	}
+
+	// Connect the entrances inside every cluster
+	std::vector<const GridNode*> nodesById(static_cast<unsigned long>(nodeCount), nullptr);
+	for(const GridNode* node : nodes) {
+		nodesById[node->id] = node;
+	}
+
+	for(const std::vector<int>& clusterEntrances : entrancesOfCluster) {
+		for(int entrance : clusterEntrances) {
+			std::unordered_map<int, float> distances = getDistancesInCluster(nodesById[entrances[entrance].nodeId]);
+
+			for(int other : clusterEntrances) {
+				auto distance = distances.find(entrances[other].nodeId);
+				if(other != entrance && distance != distances.end()) {
+					entrances[entrance].edges.emplace_back(other, distance->second);
+				}
+			}
+		}
+	}
+}
+
+bool ClusterGraph::addToCorridor(const GridNode* start, const GridNode* target, std::vector<bool>& corridor) const {
+	int startCluster = getClusterOf(start);
+	int targetCluster = getClusterOf(target);
+	std::unordered_map<int, float> distancesFromStart = getDistancesInCluster(start);
+	std::unordered_map<int, float> distancesToTarget = getDistancesInCluster(target);
+
+	// A* over the entrances. The target is an additional node with the index behind the last entrance
+	auto targetIndex = static_cast<int>(entrances.size());
+	std::vector<float> distances(entrances.size() + 1, std::numeric_limits<float>::infinity());
+	std::vector<int> prevs(entrances.size() + 1, -1);
+	typedef std::pair<float, int> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	auto relax = [&](int index, float distance, int prev) {
+		if(distance < distances[index]) {
+			distances[index] = distance;
+			prevs[index] = prev;
+			const Point& pos = index == targetIndex ? target->pos : entrances[index].pos;
+			queue.emplace(distance + static_cast<float>(Math::getDistance(pos, target->pos)), index);
+		}
+	};
+
+	// The start connects to the entrances of its cluster and directly to the target if both share the cluster
+	for(int entrance : entrancesOfCluster[startCluster]) {
+		auto distance = distancesFromStart.find(entrances[entrance].nodeId);
+		if(distance != distancesFromStart.end()) {
+			relax(entrance, distance->second, -1);
+		}
+	}
+	auto directDistance = distancesFromStart.find(target->id);
+	if(startCluster == targetCluster && directDistance != distancesFromStart.end()) {
+		relax(targetIndex, directDistance->second, -1);
+	}
+
+	while(!queue.empty()) {
+		QueueEntry current = queue.top();
+		queue.pop();
+
+		int index = current.second;
+		if(index == targetIndex) {
+			break;
+		}
+
+		const Entrance& entrance = entrances[index];
+		if(current.first > distances[index] + static_cast<float>(Math::getDistance(entrance.pos, target->pos))) {
+			continue;
+		}
+
+		for(const auto& edge : entrance.edges) {
+			relax(edge.first, distances[index] + edge.second, index);
+		}
+
+		if(entrance.cluster == targetCluster) {
+			auto distance = distancesToTarget.find(entrance.nodeId);
+			if(distance != distancesToTarget.end()) {
+				relax(targetIndex, distances[index] + distance->second, index);
+			}
+		}
+	}
+
+	if(!std::isfinite(distances[targetIndex])) {
+		return false;
+	}
+
+	corridor[startCluster] = true;
+	corridor[targetCluster] = true;
+	for(int index = prevs[targetIndex]; index != -1; index = prevs[index]) {
+		corridor[entrances[index].cluster] = true;
+	}
+
+	return true;
+}
+
+bool ClusterGraph::isInCorridor(const GridNode* node, const std::vector<bool>& corridor) const {
+	return corridor[getClusterOf(node)];
+}
+
+int ClusterGraph::getClusterCount() const {
+	return clusterColumns * clusterRows;
+}
+
+int ClusterGraph::getEntranceCount() const {
+	return static_cast<int>(entrances.size());
+}
+
+int ClusterGraph::getClusterOf(const Point& pos) const {
+	int cx = static_cast<int>(std::floor((pos.x - origin.x) / clusterWidth + EPS));
+	int cy = static_cast<int>(std::floor((pos.y - origin.y) / clusterWidth + EPS));
+
+	cx = std::max(0, std::min(clusterColumns - 1, cx));
+	cy = std::max(0, std::min(clusterRows - 1, cy));
+
+	return cy * clusterColumns + cx;
+}
+
+int ClusterGraph::getClusterOf(const GridNode* node) const {
+	// Nodes added after the graph was built are sorted in by position
+	if(node->id >= static_cast<int>(clusterOfNode.size())) {
+		return getClusterOf(node->pos);
+	}
+
+	return clusterOfNode[node->id];
+}
+
+int ClusterGraph::getOrAddEntrance(const GridNode* node) {
+	if(entranceOfNode[node->id] == -1) {
+		entranceOfNode[node->id] = static_cast<int>(entrances.size());
+		entrances.push_back(Entrance{node->id, node->pos, clusterOfNode[node->id], {}});
+		entrancesOfCluster[clusterOfNode[node->id]].push_back(entranceOfNode[node->id]);
+	}
+
+	return entranceOfNode[node->id];
+}
+
+std::unordered_map<int, float> ClusterGraph::getDistancesInCluster(const GridNode* source) const {
+	int cluster = getClusterOf(source);
+	std::unordered_map<int, float> distances;
+	typedef std::pair<float, const GridNode*> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	distances[source->id] = 0;
+	queue.emplace(0.f, source);
+
+	while(!queue.empty()) {
+		QueueEntry current = queue.top();
+		queue.pop();
+
+		if(current.first > distances[current.second->id]) {
+			continue;
+		}
+
+		for(const GridNode* neighbour : current.second->neighbours) {
+			if(getClusterOf(neighbour) != cluster) {
+				continue;
+			}
+
+			float distance = current.first + static_cast<float>(Math::getDistance(current.second->pos, neighbour->pos));
+			auto known = distances.find(neighbour->id);
+			if(known == distances.end() || distance < known->second) {
+				distances[neighbour->id] = distance;
+				queue.emplace(distance, neighbour);
+			}
+		}
+	}
+
+	return distances;
+}
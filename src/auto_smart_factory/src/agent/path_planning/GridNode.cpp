@@ -1,5 +1,6 @@
 #include "agent/path_planning/GridNode.h"
 
-GridNode::GridNode(Point pos) : 
-	pos(pos) {
+GridNode::GridNode(Point pos, int id) : 
+	pos(pos),
+	id(id) {
 }
@@ -1,16 +1,24 @@
 #include <utility>
+#include <algorithm>
 #include <iostream>
+#include <atomic>
 #include <include/agent/path_planning/Map.h>
 
 #include "agent/path_planning/Map.h"
 
 #include "ros/ros.h"
 #include "agent/path_planning/ThetaStarPathPlanner.h"
+#include "agent/path_planning/SippPathPlanner.h"
 
 int Map::visualisationId = 0;
 double Map::infiniteReservationTime = 0;
 
 Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector<Rectangle>& obstacles, RobotHardwareProfile* hardwareProfile, int ownerId) :
+		Map(std::move(warehouseConfig), obstacles, hardwareProfile, ownerId, "")
+{
+}
+
+Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector<Rectangle>& obstacles, RobotHardwareProfile* hardwareProfile, int ownerId, const std::string& thetaStarMapArtifactPath) :
 		warehouseConfig(warehouseConfig),
 		width(warehouseConfig.map_configuration.width),
 		height(warehouseConfig.map_configuration.height),
@@ -22,19 +30,49 @@ Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector
 		infiniteReservationTime = ros::Time::now().toSec() + 100000.f;
 	}
 	
-	this->obstacles.clear();
+	auto staticObstacles = std::make_shared<std::vector<Rectangle>>();
 	for(const Rectangle& o : obstacles) {
-		this->obstacles.emplace_back(o.getPosition(), o.getSize(), o.getRotation());
+		staticObstacles->emplace_back(o.getPosition(), o.getSize(), o.getRotation());
+	}
+	this->obstacles = staticObstacles;
+	staticObstacleGrid = std::make_shared<const StaticObstacleGrid>(*staticObstacles, width, height, staticObstacleCellSize);
+	
+	// Theta star map, loaded from the precomputed artifact if there is one for this configuration
+	uint64_t configHash = 0;
+	std::shared_ptr<const ThetaStarMapArtifact> artifact;
+	if(!thetaStarMapArtifactPath.empty()) {
+		configHash = ThetaStarMapArtifact::computeConfigHash(warehouseConfig, *staticObstacles);
+		artifact = ThetaStarMapArtifact::load(thetaStarMapArtifactPath, configHash);
+	}
+	
+	if(artifact != nullptr) {
+		thetaStarMap = ThetaStarMap(this, artifact);
+	} else {
+		thetaStarMap = ThetaStarMap(this, warehouseConfig.map_configuration.resolutionThetaStar);
+		for(const auto& tray : warehouseConfig.trays) {
+			OrientedPoint p = getPointInFrontOfTray(tray);
+			thetaStarMap.addAdditionalNode(Point(p.x, p.y));
+		}
+		
+		// Static distance fields towards all fixed path targets: trays (including charging stations) and idle positions
+		for(const auto& tray : warehouseConfig.trays) {
+			OrientedPoint p = getPointInFrontOfTray(tray);
+			thetaStarMap.addDistanceField(Point(p.x, p.y));
+		}
+		for(const auto& idlePosition : warehouseConfig.idle_positions) {
+			thetaStarMap.addDistanceField(Point(static_cast<float>(idlePosition.pose.x), static_cast<float>(idlePosition.pose.y)));
+		}
+		
+		if(!thetaStarMapArtifactPath.empty() && thetaStarMap.writeArtifact(thetaStarMapArtifactPath, configHash)) {
+			ROS_INFO("[Agent %d] Wrote theta* map artifact %s", ownerId, thetaStarMapArtifactPath.c_str());
+		}
 	}
 	
-	// Theta star map
-	thetaStarMap = ThetaStarMap(this, warehouseConfig.map_configuration.resolutionThetaStar);
-	for(const auto& tray : warehouseConfig.trays) {
-		OrientedPoint p = getPointInFrontOfTray(tray);
-		thetaStarMap.addAdditionalNode(Point(p.x, p.y));
+	if(thetaStarMap.getNodeCount() >= hierarchicalPlanningMinNodeCount) {
+		thetaStarMap.buildClusterGraph(hierarchicalPlanningClusterSize);
 	}
 	
-	reservations.clear();
+	reservations = std::make_shared<std::shared_ptr<const ReservationTable>>(std::make_shared<ReservationTable>(width, height, reservationCellSize));
 	
 	// Add idle reservations
 	double infiniteReservationStartTime = ros::Time::now().toSec() - 1000;
@@ -43,122 +81,130 @@ Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector
 		int id = std::stoi(idStr);
 		Point pos = Point(static_cast<float>(idlePosition.pose.x), static_cast<float>(idlePosition.pose.y));
 		
-		reservations.emplace_back(pos, Point(Path::getReservationSize(), Path::getReservationSize()), 0, infiniteReservationStartTime, infiniteReservationTime, id);
+		getWritableReservations().add(Rectangle(pos, Point(Path::getReservationSize(), Path::getReservationSize()), 0, infiniteReservationStartTime, infiniteReservationTime, id, idleReservationSequence));
 	}
 }
 
-bool Map::isInsideAnyStaticInflatedObstacle(const Point& point) const {
-	for(const Rectangle& obstacle : obstacles) {
-		if(Math::isPointInRectangle(point, obstacle)) {
-			return true;
-		}
-	}
-
-	return false;
+Map::Map(const Map& other) :
+		width(other.width),
+		height(other.height),
+		margin(other.margin),
+		warehouseConfig(other.warehouseConfig),
+		obstacles(other.obstacles),
+		staticObstacleGrid(other.staticObstacleGrid),
+		reservations(std::make_shared<std::shared_ptr<const ReservationTable>>(*other.reservations)),
+		thetaStarMap(ThetaStarMap::createView(other.thetaStarMap, this)),
+		hardwareProfile(other.hardwareProfile),
+		ownerId(other.ownerId),
+		nextLocalReservationSequence(other.nextLocalReservationSequence),
+		pathPlannerType(other.pathPlannerType)
+{
 }
 
-bool Map::isStaticLineOfSightFree(const Point& pos1, const Point& pos2) const {
-	for(const Rectangle& obstacle : obstacles) {
-		if(Math::doesLineSegmentIntersectRectangle(pos1, pos2, obstacle)) {
-			return false;
-		}
-	}
+Map::Map(Map& other, RobotHardwareProfile* hardwareProfile, int ownerId) :
+		width(other.width),
+		height(other.height),
+		margin(other.margin),
+		warehouseConfig(other.warehouseConfig),
+		obstacles(other.obstacles),
+		staticObstacleGrid(other.staticObstacleGrid),
+		reservations(other.reservations),
+		thetaStarMap(ThetaStarMap::createView(other.thetaStarMap, this)),
+		hardwareProfile(hardwareProfile),
+		ownerId(ownerId),
+		pathPlannerType(other.pathPlannerType)
+{
+}
 
-	return true;
+bool Map::isInsideAnyStaticInflatedObstacle(const Point& point) const {
+	return staticObstacleGrid->isInsideAnyObstacle(point);
 }
 
-TimedLineOfSightResult Map::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const {
-	// Todo make adaptive - for now assume that every reservation can be left in x seconds
-	double minTimeToLeave = 5;
-	
-	TimedLineOfSightResult result;
+bool Map::isStaticLineOfSightFree(const Point& pos1, const Point& pos2) const {
+	return staticObstacleGrid->isLineOfSightFree(pos1, pos2);
+}
 
+TimedLineOfSightResult Map::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const {
 	if(!isStaticLineOfSightFree(pos1, pos2)) {
+		TimedLineOfSightResult result;
 		result.blockedByStatic = true;
 		return result;
 	}
 	
-	for(const Rectangle& reservation : reservations) {
-		if(std::find(smallerReservations.begin(), smallerReservations.end(), reservation) != smallerReservations.end()) {
-			// Directly blocked
-			if(reservation.doesOverlapTimeRange(startTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectNonInflatedRectangle(pos1, pos2, reservation)) {
-				result.blockedByTimed = true;
-				if(reservation.getFreeAfter() > result.freeAfter) {
-					result.freeAfter = reservation.getFreeAfter();
-				}
-			}
+	return whenIsTimedLineOfSightFreeOfReservations(pos1, startTime, pos2, endTime, smallerReservations);
+}
 
-			// Upcoming obstacles			
-			if(Math::isPointInNonInflatedRectangle(pos2, reservation) && reservation.getStartTime() > endTime && reservation.getOwnerId() != ownerId) {
-				result.hasUpcomingObstacle = true;
+TimedLineOfSightResult Map::whenIsTimedLineOfSightFreeOfReservations(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const {
+	TimedEdge edge;
+	edge.reset(pos1, pos2, true);
+	collectTimedEdgeReservations(pos1, pos2, startTime, smallerReservations, edge);
+	
+	return edge.whenIsLineOfSightFree(startTime, endTime);
+}
 
-				double lastValidEntryTime = reservation.getStartTime() - minTimeToLeave;
-				if(lastValidEntryTime < result.lastValidEntryTime) {
-					result.lastValidEntryTime = lastValidEntryTime;
-					result.freeAfterUpcomingObstacle = reservation.getEndTime();
-				}
-			}
-		} else {
-			// Directly blocked
-			if(reservation.doesOverlapTimeRange(startTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectRectangle(pos1, pos2, reservation)) {
-				result.blockedByTimed = true;
-				if(reservation.getFreeAfter() > result.freeAfter) {
-					result.freeAfter = reservation.getFreeAfter();
-				}
-			}
+bool Map::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::unordered_set<ReservationId>& smallerReservations) const {
+	// Does not check against static obstacles, this is only used to verify a already planned connection
+	TimedEdge edge;
+	edge.reset(pos1, pos2, true);
+	collectTimedEdgeReservations(pos1, pos2, startTime, smallerReservations, edge);
+	
+	return edge.isConnectionFree(startTime, waitingTime, drivingTime);
+}
 
-			// Upcoming obstacles			
-			if(Math::isPointInRectangle(pos2, reservation) && reservation.getStartTime() > endTime && reservation.getOwnerId() != ownerId) {
-				result.hasUpcomingObstacle = true;				
-
-				double lastValidEntryTime = reservation.getStartTime() - minTimeToLeave;
-				if(lastValidEntryTime < result.lastValidEntryTime) {
-					result.lastValidEntryTime = lastValidEntryTime;
-					result.freeAfterUpcomingObstacle = reservation.getEndTime();
-				}
-			}	
-		}		
-	}
+void Map::collectTimedEdge(const Point& pos1, const Point& pos2, double earliestTime, const std::unordered_set<ReservationId>& smallerReservations, TimedEdge& edge) const {
+	edge.reset(pos1, pos2, isStaticLineOfSightFree(pos1, pos2));
 	
-	// Treat "infinite" obstacles as completely blocked and dont wait forever
-	double maxTime = endTime + 1000.f;
-	if((result.blockedByTimed && result.freeAfter > maxTime) ||
-	   (result.hasUpcomingObstacle && (result.lastValidEntryTime > maxTime || result.freeAfterUpcomingObstacle > maxTime))) {
-		result.blockedByStatic = true;
+	if(edge.isStaticLineOfSightFree()) {
+		collectTimedEdgeReservations(pos1, pos2, earliestTime, smallerReservations, edge);
 	}
-
-	return result;
 }
 
-bool Map::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const {
-	// Does not check against static obstacles, this is only used to verify a already planned connection
-	double endTime = startTime + waitingTime + drivingTime;
-
-	for(const Rectangle& reservation : reservations) {
-		if(std::find(smallerReservations.begin(), smallerReservations.end(), reservation) != smallerReservations.end()) {
-			// Check if the waiting part is free
-			if(reservation.doesOverlapTimeRange(startTime, startTime + waitingTime - 0.01f, ownerId) && Math::isPointInNonInflatedRectangle(pos1, reservation)) {
-				return false;
-			}
+void Map::collectTimedEdgeReservations(const Point& pos1, const Point& pos2, double earliestTime, const std::unordered_set<ReservationId>& smallerReservations, TimedEdge& edge) const {
+	// Only reservations near the segment can block it. The waiting position pos1 and upcoming obstacles at pos2 are part of the segment as well.
+	// Reservations ending before the earliest check can not overlap any check, later reservations can still be upcoming obstacles
+	getReservations().forEachReservationOnLineSegment(pos1, pos2, earliestTime, std::numeric_limits<double>::max(), [&](int slot, const Rectangle& reservation) {
+		if(reservation.getOwnerId() != ownerId) {
+			bool isSmaller = smallerReservations.count(reservation.getId()) > 0;
+			edge.addReservation(&reservation, isSmaller);
+		}
+		
+		return true;
+	});
+}
 
-			// Check if the driving part is free
-			if(reservation.doesOverlapTimeRange(startTime + waitingTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectNonInflatedRectangle(pos1, pos2, reservation)) {
-				return false;
-			}
-		} else {
-			// Check if the waiting part is free
-			if(reservation.doesOverlapTimeRange(startTime, startTime + waitingTime - 0.01f, ownerId) && Math::isPointInRectangle(pos1, reservation)) {
-				return false;
+std::vector<SafeInterval> Map::getSafeIntervals(const Point& pos, const std::unordered_set<ReservationId>& smallerReservations) const {
+	// Time ranges in which other robots reserved the point, sorted by start
+	std::vector<std::pair<double, double>> reservedRanges;
+	getReservations().forEachReservationAt(pos, -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), [&](int slot, const Rectangle& reservation) {
+		if(reservation.getOwnerId() == ownerId) {
+			return true;
+		}
+		
+		double start, end;
+		if(smallerReservations.count(reservation.getId()) > 0) {
+			if(Math::isPointInNonInflatedRectangle(pos, reservation)) {
+				reservedRanges.emplace_back(reservation.getStartTime(), reservation.getEndTime());
 			}
-
-			// Check if the driving part is free
-			if(reservation.doesOverlapTimeRange(startTime + waitingTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectRectangle(pos1, pos2, reservation)) {
-				return false;
-			}	
-		}		
+		} else if(Math::getReservedTimeRangeAtPoint(pos, reservation, start, end)) {
+			reservedRanges.emplace_back(start, end);
+		}
+		
+		return true;
+	});
+	std::sort(reservedRanges.begin(), reservedRanges.end());
+	
+	// Safe intervals are the gaps between the merged reserved ranges. Reservation bounds are inclusive, so the gaps keep a small distance
+	std::vector<SafeInterval> safeIntervals;
+	double safeStart = -std::numeric_limits<double>::max();
+	for(const auto& range : reservedRanges) {
+		if(range.first - 0.01f > safeStart) {
+			safeIntervals.push_back(SafeInterval{safeStart, range.first - 0.01f});
+		}
+		safeStart = std::max(safeStart, range.second + 0.01f);
 	}
-
-	return true;
+	safeIntervals.push_back(SafeInterval{safeStart, std::numeric_limits<double>::max()});
+	
+	return safeIntervals;
 }
 
 float Map::getWidth() const {
@@ -173,65 +219,140 @@ float Map::getMargin() const {
 	return margin;
 }
 
-Path Map::getThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations) {
+Path Map::findPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations) {
+	if(pathPlannerType == PathPlannerType::SIPP) {
+		SippPathPlanner sippPathPlanner(&thetaStarMap, hardwareProfile, start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+		return sippPathPlanner.findPath();
+	}
+	
 	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+	thetaStarPathPlanner.setLazyLineOfSight(pathPlannerType == PathPlannerType::LAZY_THETA_STAR);
 	return thetaStarPathPlanner.findPath();
 }
 
+Path Map::getThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations) {
+	return findPath(start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+}
+
 Path Map::getThetaStarPath(const OrientedPoint& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime) {
 	const OrientedPoint endPoint = getPointInFrontOfTray(end);
-	
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, endPoint, startingTime, targetReservationTime, false);
 	//ROS_INFO("Computing path from (%f/%f) to tray of type %s (%f/%f)", start.x, start.y, end.type.c_str(), getPointInFrontOfTray(end).x, getPointInFrontOfTray(end).y);
 	
-	return thetaStarPathPlanner.findPath();
+	return findPath(start, endPoint, startingTime, targetReservationTime, false);
 }
 
 Path Map::getThetaStarPath(const auto_smart_factory::Tray& start, const OrientedPoint& end, double startingTime, double targetReservationTime) {
 	const OrientedPoint startPoint = getPointInFrontOfTray(start);
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, startPoint, end, startingTime, targetReservationTime, false);
-	
 	//ROS_INFO("Computing path from tray of type %s (%f/%f) to (%f/%f)", start.type.c_str(), getPointInFrontOfTray(start).x, getPointInFrontOfTray(start).y, end.x, end.y);
 	
-	return thetaStarPathPlanner.findPath();
+	return findPath(startPoint, end, startingTime, targetReservationTime, false);
 }
 
 Path Map::getThetaStarPath(const auto_smart_factory::Tray& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime) {
 	const OrientedPoint startPoint = getPointInFrontOfTray(start);
 	const OrientedPoint endPoint = getPointInFrontOfTray(end);
-
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, startPoint, endPoint, startingTime, targetReservationTime, false);
 	//ROS_INFO("Computing path from tray of type %s (%f/%f) to tray of type %s (%f/%f)", start.type.c_str(), getPointInFrontOfTray(start).x, getPointInFrontOfTray(start).y, end.type.c_str(), getPointInFrontOfTray(end).x, getPointInFrontOfTray(end).y);
 	
+	return findPath(startPoint, endPoint, startingTime, targetReservationTime, false);
+}
+
+std::vector<Path> Map::getThetaStarPaths(const OrientedPoint& start, const std::vector<auto_smart_factory::Tray>& ends, double startingTime, double targetReservationTime) {
+	std::vector<OrientedPoint> endPoints;
+	for(const auto& end : ends) {
+		endPoints.push_back(getPointInFrontOfTray(end));
+	}
+	
+	if(pathPlannerType == PathPlannerType::SIPP) {
+		std::vector<Path> paths;
+		for(const OrientedPoint& endPoint : endPoints) {
+			paths.push_back(findPath(start, endPoint, startingTime, targetReservationTime, false));
+		}
+		return paths;
+	}
+	
+	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, endPoints, startingTime, targetReservationTime, false);
+	thetaStarPathPlanner.setLazyLineOfSight(pathPlannerType == PathPlannerType::LAZY_THETA_STAR);
+	return thetaStarPathPlanner.findPaths();
+}
+
+std::vector<Path> Map::getThetaStarPaths(const auto_smart_factory::Tray& start, const std::vector<auto_smart_factory::Tray>& ends, double startingTime, double targetReservationTime) {
+	return getThetaStarPaths(getPointInFrontOfTray(start), ends, startingTime, targetReservationTime);
+}
+
+void Map::setPathPlannerType(PathPlannerType type) {
+	pathPlannerType = type;
+}
+
+Path Map::getThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations, ThetaStarSearchArena* arena) {
+	if(pathPlannerType == PathPlannerType::SIPP) {
+		return findPath(start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+	}
+	
+	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+	thetaStarPathPlanner.setSearchArena(arena);
+	thetaStarPathPlanner.setLazyLineOfSight(pathPlannerType == PathPlannerType::LAZY_THETA_STAR);
 	return thetaStarPathPlanner.findPath();
 }
 
+Path Map::repairThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations, ThetaStarSearchArena* arena, double previousStartingTime) {
+	if(pathPlannerType == PathPlannerType::SIPP) {
+		return findPath(start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+	}
+	
+	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, end, startingTime, targetReservationTime, ignoreStartingReservations);
+	thetaStarPathPlanner.setSearchArena(arena);
+	thetaStarPathPlanner.setLazyLineOfSight(pathPlannerType == PathPlannerType::LAZY_THETA_STAR);
+	return thetaStarPathPlanner.repairPath(previousStartingTime);
+}
+
 bool Map::isPointInMap(const Point& pos) const {
 	return pos.x >= margin && pos.x <= width - margin && pos.y >= margin && pos.y <= height - margin;
 }
 
-void Map::deleteExpiredReservations(double time) {
-	auto iter = reservations.begin();
+const ReservationTable& Map::getReservations() const {
+	return **reservations;
+}
 
-	while(iter != reservations.end()) {
-		if((*iter).getEndTime() < time) {
-			iter = reservations.erase(iter);
-		} else {
-			iter++;
-		}
+std::shared_ptr<const ReservationTable> Map::getReservationSnapshot() const {
+	return *reservations;
+}
+
+void Map::setReservations(std::shared_ptr<const ReservationTable> reservations) {
+	*this->reservations = std::move(reservations);
+}
+
+ReservationTable& Map::getWritableReservations() {
+	if(reservations->use_count() > 1) {
+		*reservations = std::make_shared<ReservationTable>(**reservations);
+	} else {
+		// Pairs with the release of the last snapshot, which may have been used on another thread
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	
+	// Tables are always created as non-const objects, only the shared pointers are const
+	return const_cast<ReservationTable&>(**reservations);
+}
+
+void Map::deleteExpiredReservations(double time) {
+	// Checked first, so snapshots are only copied if something expires
+	if(getReservations().hasExpired(time)) {
+		getWritableReservations().removeExpired(time);
 	}
 }
 
 std::vector<Rectangle> Map::deleteReservationsFromAgent(int agentId) {
+	return deleteReservationsFromAgent(agentId, std::vector<int>());
+}
+
+std::vector<Rectangle> Map::deleteReservationsFromAgent(int agentId, const std::vector<int>& keptSequences) {
 	std::vector<Rectangle> deletedReservations;
-	auto iter = reservations.begin();
-
-	while(iter != reservations.end()) {
-		if((*iter).getOwnerId() == agentId) {
-			deletedReservations.push_back(*iter);
-			iter = reservations.erase(iter);
-		} else {
-			iter++;
+
+	for(int slot = 0; slot < getReservations().getSlotCount(); slot++) {
+		const ReservationTable& table = getReservations();
+		if(table.isUsed(slot) && table.get(slot).getOwnerId() == agentId &&
+		   std::find(keptSequences.begin(), keptSequences.end(), table.get(slot).getSequence()) == keptSequences.end()) {
+			deletedReservations.push_back(table.get(slot));
+			getWritableReservations().remove(slot);
 		}
 	}
 	
@@ -240,10 +361,21 @@ std::vector<Rectangle> Map::deleteReservationsFromAgent(int agentId) {
 
 void Map::addReservations(const std::vector<Rectangle>& newReservations) {
 	for(const auto& r : newReservations) {
-		reservations.emplace_back(r.getPosition(), r.getSize(), r.getRotation(), r.getStartTime(), r.getEndTime(), r.getOwnerId());
+		int sequence = r.getSequence() == Rectangle::noSequence ? nextLocalReservationSequence-- : r.getSequence();
+		getWritableReservations().add(Rectangle(r.getPosition(), r.getSize(), r.getRotation(), r.getStartTime(), r.getEndTime(), r.getOwnerId(), sequence, r.getShape(), r.getHoldDuration()));
 	}
 }
 
+bool Map::deleteReservation(ReservationId id) {
+	int slot = getReservations().findSlot(id);
+	if(slot == -1) {
+		return false;
+	}
+	
+	getWritableReservations().remove(slot);
+	return true;
+}
+
 OrientedPoint Map::getPointInFrontOfTray(const auto_smart_factory::Tray& tray) {
 	OrientedPoint p;
 
@@ -285,7 +417,7 @@ visualization_msgs::Marker Map::getObstacleVisualization() {
 	geometry_msgs::Point p;
 	p.z = 0.f;
 	// Obstacles
-	for(const Rectangle& obstacle : obstacles) {
+	for(const Rectangle& obstacle : *obstacles) {
 		const Point* points = obstacle.getPointsInflated();
 		// First triangle
 		p.x = points[0].x;
@@ -340,13 +472,13 @@ visualization_msgs::Marker Map::getInactiveReservationVisualization(visualizatio
 	p.z = 0.f;
 
 	double now = ros::Time::now().toSec();
-	for(const Rectangle& reservation : reservations) {
+	getReservations().forEachReservation([&](int slot, const Rectangle& reservation) {
 		if(reservation.getOwnerId() != ownerId) {
-			continue;
+			return true;
 		}
 		
 		if(now >= reservation.getStartTime() && now <= reservation.getEndTime()) {
-			continue;
+			return true;
 		}
 		
 		const Point* points = reservation.getPointsInflated();
@@ -381,7 +513,9 @@ visualization_msgs::Marker Map::getInactiveReservationVisualization(visualizatio
 		p.y = points[0].y;
 		msg.points.push_back(p);
 		msg.colors.push_back(msg.color);
-	}
+
+		return true;
+	});
 
 	return msg;
 }
@@ -409,13 +543,13 @@ visualization_msgs::Marker Map::getActiveReservationVisualization(visualization_
 	p.z = 0.f;
 
 	double now = ros::Time::now().toSec();
-	for(const Rectangle& reservation : reservations) {
+	getReservations().forEachReservation([&](int slot, const Rectangle& reservation) {
 		if(reservation.getOwnerId() != ownerId) {
-			continue;
+			return true;
 		}
 
 		if(!(now >= reservation.getStartTime() && now <= reservation.getEndTime())) {
-			continue;
+			return true;
 		}
 
 		const Point* points = reservation.getPointsInflated();
@@ -450,7 +584,9 @@ visualization_msgs::Marker Map::getActiveReservationVisualization(visualization_
 		p.y = points[0].y;
 		msg.points.push_back(p);
 		msg.colors.push_back(msg.color);
-	}
+
+		return true;
+	});
 
 	return msg;
 }
@@ -464,27 +600,33 @@ visualization_msgs::Marker Map::getLinkVisualization() {
 }
 
 bool Map::isPointTargetOfAnotherRobot(OrientedPoint p) {
-	for(const auto& r : reservations) {
+	bool isTarget = false;
+	
+	getReservations().forEachReservationAt(Point(p.x, p.y), -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), [&](int slot, const Rectangle& r) {
 		if(Math::isPointInRectangle(Point(p.x, p.y), r) && r.getOwnerId() != ownerId && r.getEndTime() - r.getStartTime() >= 150.f) {
-			return true;
-		}		
-	}
+			isTarget = true;
+		}
+		
+		return !isTarget;
+	});
 	
-	return false;
+	return isTarget;
 }
 
 int Map::getOwnerId() const {
 	return ownerId;
 }
 
-std::vector<Rectangle> Map::getRectanglesOnStartingPoint(Point p) const {
-	std::vector<Rectangle> rectangles;
+std::unordered_set<ReservationId> Map::getReservationIdsOnStartingPoint(Point p) const {
+	std::unordered_set<ReservationId> ids;
 
-	for(const auto& r : reservations) {
+	getReservations().forEachReservationAt(p, -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), [&](int slot, const Rectangle& r) {
 		if(Math::isPointInRectangle(p, r) && r.getOwnerId() != ownerId) {
-			rectangles.push_back(r);
+			ids.insert(r.getId());
 		}
-	}
+		
+		return true;
+	});
 	
-	return rectangles;
+	return ids;
 }
@@ -153,6 +153,11 @@ const std::vector<Rectangle> Path::generateReservations(int ownerId, bool starts
 }
 
 void Path::generateReservationsForSegment(std::vector<Rectangle>& reservations, Point startPoint, Point endPoint, double timeAtStartPoint, double deltaTime, int ownerId) const {
+	if(useSweptReservations) {
+		generateSweptReservation(reservations, startPoint, endPoint, getReservationSize() * 0.5f, timeAtStartPoint, deltaTime, ownerId);
+		return;
+	}
+	
 	double distance = Math::getDistance(startPoint, endPoint);
 	Point normalizedDir = (endPoint - startPoint) * (1.f/distance);
 	double rotation = Math::getRotationInDeg(normalizedDir);
@@ -188,6 +193,11 @@ void Path::generateReservationsForCurvePoints(std::vector<Rectangle>& reservatio
 	Point widthDirection = (points.at(static_cast<unsigned long>(std::floor((points.size() - 1) / 2))) - halfDistance) * 0.5f;
 	double widthOffset = Math::getLength(widthDirection) * 2.f;
 	
+	if(useSweptReservations) {
+		generateSweptReservation(reservations, points.front() + widthDirection, points.back() + widthDirection, (getReservationSize() + widthOffset) * 0.5f, timeAtStartPoint, deltaTime, ownerId);
+		return;
+	}
+	
 	// Split into multiple segments
 	auto segmentCount = static_cast<unsigned int>(std::ceil(deltaTime / maxDrivingReservationDuration));
 	double deltaDuration = deltaTime / static_cast<double>(segmentCount);
@@ -210,6 +220,15 @@ void Path::generateReservationsForCurvePoints(std::vector<Rectangle>& reservatio
 	}
 }
 
+void Path::generateSweptReservation(std::vector<Rectangle>& reservations, Point startPoint, Point endPoint, double radius, double timeAtStartPoint, double deltaDuration, int ownerId) const {
+	// The uncertainty grows over time, so the margins at the end point are the largest along the segment
+	double timeAtEndPoint = timeAtStartPoint + deltaDuration;
+	double marginBehind = timing.getReservationUncertainty(timeAtEndPoint, Direction::BEHIND) + reservationTimeMarginBehind + sweptReservationTimeSlack;
+	double marginAhead = timing.getReservationUncertainty(timeAtEndPoint, Direction::AHEAD) + reservationTimeMarginAhead + sweptReservationTimeSlack;
+	
+	reservations.push_back(Rectangle::createSweptCapsule(startPoint, endPoint, radius, timeAtStartPoint - marginBehind, timeAtEndPoint + marginAhead, marginBehind + marginAhead, ownerId));
+}
+
 void Path::generateReservationForTray(std::vector<Rectangle>& reservations, OrientedPoint pos, double reservationStartTime, double duration, int ownerId) const {
 	double startTime = reservationStartTime - reservationTimeMarginBehind;
 	double endTime = reservationStartTime + duration + reservationTimeMarginAhead;
@@ -0,0 +1,60 @@
+#include "agent/path_planning/PlanningWorkerPool.h"
+
+PlanningWorkerPool::PlanningWorkerPool(const Map& map, int workerCount) {
+	for(int i = 0; i < workerCount; i++) {
+		workerMaps.push_back(new Map(map));
+	}
+
+	for(Map* workerMap : workerMaps) {
+		workers.emplace_back(&PlanningWorkerPool::work, this, workerMap);
+	}
+}
+
+PlanningWorkerPool::~PlanningWorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+
+	for(std::thread& worker : workers) {
+		worker.join();
+	}
+
+	for(Map* workerMap : workerMaps) {
+		delete workerMap;
+	}
+}
+
+void PlanningWorkerPool::submit(Job job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+int PlanningWorkerPool::getPendingJobCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return static_cast<int>(jobs.size());
+}
+
+void PlanningWorkerPool::work(Map* workerMap) {
+	while(true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+			if(stopping) {
+				return;
+			}
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		job(*workerMap);
+	}
+}
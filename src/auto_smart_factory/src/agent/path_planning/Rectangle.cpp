@@ -4,16 +4,19 @@
 #include "agent/path_planning/Rectangle.h"
 #include "Math.h"
 
-Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime, double endTime, int ownerId) :
+Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime, double endTime, int ownerId, int sequence, RectangleShape shape, double holdDuration) :
 		pos(pos_),
 		size(size_),
 		rotation(rotation_),
 		startTime(startTime),
 		endTime(endTime),
-		ownerId(ownerId)
+		ownerId(ownerId),
+		sequence(sequence),
+		shape(shape),
+		holdDuration(shape == RectangleShape::SWEPT_CAPSULE ? holdDuration : endTime - startTime)
 {
 	isAxisAligned = false;
-	if(static_cast<int>(std::roundf(rotation)) % 90 == 0) {
+	if(shape == RectangleShape::RECTANGLE && static_cast<int>(std::roundf(rotation)) % 90 == 0) {
 		rotation = std::roundf(rotation);
 		isAxisAligned = true;
 	}
@@ -25,8 +28,17 @@ Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime,
 		//color = sf::Color(200, 0, 200);
 	}
 
+	// Swept capsules are approximated by their bounding rectangle wherever the exact shape is not needed
+	Point boundingSize = size;
+	if(shape == RectangleShape::SWEPT_CAPSULE) {
+		Point halfAxis = Math::rotateVector(Point(size.x * 0.5f, 0), rotation);
+		axisStart = pos - halfAxis;
+		axisEnd = pos + halfAxis;
+		boundingSize = Point(size.x + size.y, size.y);
+	}
+
 	// Generate Points
-	Point diagonal = size * 0.5f;
+	Point diagonal = boundingSize * 0.5f;
 	Point diagonalMirrored = Point(diagonal.x, -diagonal.y);
 	pointsNonInflated[0] = pos + Math::rotateVector(diagonal, rotation);
 	pointsNonInflated[2] = pos + Math::rotateVector(diagonal, rotation + 180);
@@ -34,8 +46,7 @@ Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime,
 	pointsNonInflated[3] = pos + Math::rotateVector(diagonalMirrored, rotation + 180);
 	
 	// Generate inflated points
-	Point sizeInflated = Point(size.x + ROBOT_RADIUS * 2, size.y + ROBOT_RADIUS * 2);
-	Point diagonalInflated = Point(size.x + ROBOT_RADIUS * 2, size.y + ROBOT_RADIUS * 2) * 0.5f;
+	Point diagonalInflated = Point(boundingSize.x + ROBOT_RADIUS * 2, boundingSize.y + ROBOT_RADIUS * 2) * 0.5f;
 	Point diagonalInflatedMirrored = Point(diagonalInflated.x, -diagonalInflated.y);
 	
 	pointsInflated[0] = pos + Math::rotateVector(diagonalInflated, rotation);
@@ -49,9 +60,21 @@ Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime,
 	maxYInflated = std::max({pointsInflated[0].y, pointsInflated[1].y, pointsInflated[2].y, pointsInflated[3].y});
 }
 
+Rectangle::Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId, int sequence) :
+		Rectangle(pos, size, rotation, startTime, endTime, ownerId, sequence, RectangleShape::RECTANGLE, endTime - startTime) {}
+
+Rectangle::Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId) :
+		Rectangle(pos, size, rotation, startTime, endTime, ownerId, noSequence) {}
+
 Rectangle::Rectangle(Point pos, Point size, float rotation) :
 		Rectangle(pos, size, rotation, -1, -1, -1) {}
 
+Rectangle Rectangle::createSweptCapsule(const Point& start, const Point& end, double radius, double startTime, double endTime, double holdDuration, int ownerId) {
+	double rotation = Math::getRotationInDeg(end - start);
+	
+	return Rectangle((start + end) * 0.5f, Point(Math::getDistance(start, end), radius * 2.f), static_cast<float>(rotation), startTime, endTime, ownerId, noSequence, RectangleShape::SWEPT_CAPSULE, holdDuration);
+}
+
 const Point* Rectangle::getPointsInflated() const {
 	return pointsInflated;
 }
@@ -108,6 +131,40 @@ int Rectangle::getOwnerId() const {
 	return ownerId;
 }
 
+int Rectangle::getSequence() const {
+	return sequence;
+}
+
+RectangleShape Rectangle::getShape() const {
+	return shape;
+}
+
+double Rectangle::getHoldDuration() const {
+	return holdDuration;
+}
+
+const Point& Rectangle::getAxisStart() const {
+	return axisStart;
+}
+
+const Point& Rectangle::getAxisEnd() const {
+	return axisEnd;
+}
+
+double Rectangle::getRadiusInflated() const {
+	return size.y * 0.5f + ROBOT_RADIUS;
+}
+
+void Rectangle::getHoldTimeRange(double fromAlpha, double toAlpha, double& start, double& end) const {
+	double travelDuration = endTime - startTime - holdDuration;
+	start = startTime + fromAlpha * travelDuration;
+	end = startTime + toAlpha * travelDuration + holdDuration;
+}
+
+ReservationId Rectangle::getId() const {
+	return (static_cast<ReservationId>(static_cast<uint32_t>(ownerId)) << 32) | static_cast<uint32_t>(sequence);
+}
+
 const Point* Rectangle::getPointsNonInflated() const {
 	return pointsNonInflated;
 }
@@ -118,7 +175,10 @@ bool operator ==(const Rectangle& left, const Rectangle& right) {
 	       left.getPosition() == right.getPosition() &&
 	       left.getSize() == right.getSize() &&
 	       left.getRotation() == right.getRotation() &&
-	       left.getOwnerId() == right.getOwnerId();			
+	       left.getOwnerId() == right.getOwnerId() &&
+	       left.getSequence() == right.getSequence() &&
+	       left.getShape() == right.getShape() &&
+	       left.getHoldDuration() == right.getHoldDuration();			
 }
 
 bool operator !=(const Rectangle& left, const Rectangle& right) {
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "agent/path_planning/RectangleBatch.h"
+#include "Math.h"
+
+namespace {
+	// Rectangles tested by one call of getCandidateMask
+	const int batchWidth = 8;
+
+	float roundDown(double value) {
+		auto f = static_cast<float>(value);
+		return f > value ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+	}
+
+	float roundUp(double value) {
+		auto f = static_cast<float>(value);
+		return f < value ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+	}
+}
+
+int RectangleBatch::add(const Rectangle& rectangle) {
+	minX.push_back(roundDown(rectangle.getMinXInflated()));
+	maxX.push_back(roundUp(rectangle.getMaxXInflated()));
+	minY.push_back(roundDown(rectangle.getMinYInflated()));
+	maxY.push_back(roundUp(rectangle.getMaxYInflated()));
+	rectangles.push_back(rectangle);
+
+	return static_cast<int>(rectangles.size()) - 1;
+}
+
+void RectangleBatch::clear() {
+	minX.clear();
+	maxX.clear();
+	minY.clear();
+	maxY.clear();
+	rectangles.clear();
+}
+
+int RectangleBatch::size() const {
+	return static_cast<int>(rectangles.size());
+}
+
+const Rectangle& RectangleBatch::get(int index) const {
+	return rectangles[index];
+}
+
+int RectangleBatch::findIntersectionWithLineSegment(const Point& lStart, const Point& lEnd, int begin, int end) const {
+	float segMinX = roundDown(std::min(lStart.x, lEnd.x));
+	float segMaxX = roundUp(std::max(lStart.x, lEnd.x));
+	float segMinY = roundDown(std::min(lStart.y, lEnd.y));
+	float segMaxY = roundUp(std::max(lStart.y, lEnd.y));
+
+	// Separating axis perpendicular to the segment. Float rounding is covered by the slack
+	auto nx = static_cast<float>(lStart.y - lEnd.y);
+	auto ny = static_cast<float>(lEnd.x - lStart.x);
+	auto offset = static_cast<float>(nx * lStart.x + ny * lStart.y);
+	float slack = 0.01f * (std::abs(nx) + std::abs(ny));
+
+	for(int index = begin; index < end; index += batchWidth) {
+		uint32_t mask = getCandidateMask(index, std::min(batchWidth, end - index), segMinX, segMaxX, segMinY, segMaxY, nx, ny, offset, slack);
+
+		for(int i = 0; mask != 0; i++, mask >>= 1) {
+			if((mask & 1u) && Math::doesLineSegmentIntersectRectangle(lStart, lEnd, rectangles[index + i])) {
+				return index + i;
+			}
+		}
+	}
+
+	return -1;
+}
+
+int RectangleBatch::findRectangleContainingPoint(const Point& p, int begin, int end) const {
+	float pMinX = roundDown(p.x);
+	float pMaxX = roundUp(p.x);
+	float pMinY = roundDown(p.y);
+	float pMaxY = roundUp(p.y);
+
+	for(int index = begin; index < end; index += batchWidth) {
+		uint32_t mask = getCandidateMask(index, std::min(batchWidth, end - index), pMinX, pMaxX, pMinY, pMaxY, 0.f, 0.f, 0.f, 0.f);
+
+		for(int i = 0; mask != 0; i++, mask >>= 1) {
+			if((mask & 1u) && Math::isPointInRectangle(p, rectangles[index + i])) {
+				return index + i;
+			}
+		}
+	}
+
+	return -1;
+}
+
+uint32_t RectangleBatch::getCandidateMask(int index, int count, float segMinX, float segMaxX, float segMinY, float segMaxY, float nx, float ny, float offset, float slack) const {
+	uint32_t mask = 0;
+	int i = 0;
+
+#if defined(__AVX2__)
+	if(count == 8) {
+		__m256 rMinX = _mm256_loadu_ps(&minX[index]);
+		__m256 rMaxX = _mm256_loadu_ps(&maxX[index]);
+		__m256 rMinY = _mm256_loadu_ps(&minY[index]);
+		__m256 rMaxY = _mm256_loadu_ps(&maxY[index]);
+
+		// AABB overlap
+		__m256 overlap = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(rMaxX, _mm256_set1_ps(segMinX), _CMP_GE_OQ), _mm256_cmp_ps(rMinX, _mm256_set1_ps(segMaxX), _CMP_LE_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(rMaxY, _mm256_set1_ps(segMinY), _CMP_GE_OQ), _mm256_cmp_ps(rMinY, _mm256_set1_ps(segMaxY), _CMP_LE_OQ)));
+
+		// Separating axis: |n * (center - start)| <= |nx| * halfWidth + |ny| * halfHeight
+		__m256 half = _mm256_set1_ps(0.5f);
+		__m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		__m256 vnx = _mm256_set1_ps(nx);
+		__m256 vny = _mm256_set1_ps(ny);
+		__m256 centerX = _mm256_mul_ps(_mm256_add_ps(rMinX, rMaxX), half);
+		__m256 centerY = _mm256_mul_ps(_mm256_add_ps(rMinY, rMaxY), half);
+		__m256 halfWidth = _mm256_mul_ps(_mm256_sub_ps(rMaxX, rMinX), half);
+		__m256 halfHeight = _mm256_mul_ps(_mm256_sub_ps(rMaxY, rMinY), half);
+		__m256 distance = _mm256_and_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(vnx, centerX), _mm256_mul_ps(vny, centerY)), _mm256_set1_ps(offset)), absMask);
+		__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_and_ps(vnx, absMask), halfWidth), _mm256_mul_ps(_mm256_and_ps(vny, absMask), halfHeight)), _mm256_set1_ps(slack));
+		overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(distance, radius, _CMP_LE_OQ));
+
+		return static_cast<uint32_t>(_mm256_movemask_ps(overlap));
+	}
+#elif defined(__SSE2__)
+	for(; i + 4 <= count; i += 4) {
+		__m128 rMinX = _mm_loadu_ps(&minX[index + i]);
+		__m128 rMaxX = _mm_loadu_ps(&maxX[index + i]);
+		__m128 rMinY = _mm_loadu_ps(&minY[index + i]);
+		__m128 rMaxY = _mm_loadu_ps(&maxY[index + i]);
+
+		// AABB overlap
+		__m128 overlap = _mm_and_ps(
+			_mm_and_ps(_mm_cmpge_ps(rMaxX, _mm_set1_ps(segMinX)), _mm_cmple_ps(rMinX, _mm_set1_ps(segMaxX))),
+			_mm_and_ps(_mm_cmpge_ps(rMaxY, _mm_set1_ps(segMinY)), _mm_cmple_ps(rMinY, _mm_set1_ps(segMaxY))));
+
+		// Separating axis: |n * (center - start)| <= |nx| * halfWidth + |ny| * halfHeight
+		__m128 half = _mm_set1_ps(0.5f);
+		__m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		__m128 vnx = _mm_set1_ps(nx);
+		__m128 vny = _mm_set1_ps(ny);
+		__m128 centerX = _mm_mul_ps(_mm_add_ps(rMinX, rMaxX), half);
+		__m128 centerY = _mm_mul_ps(_mm_add_ps(rMinY, rMaxY), half);
+		__m128 halfWidth = _mm_mul_ps(_mm_sub_ps(rMaxX, rMinX), half);
+		__m128 halfHeight = _mm_mul_ps(_mm_sub_ps(rMaxY, rMinY), half);
+		__m128 distance = _mm_and_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(vnx, centerX), _mm_mul_ps(vny, centerY)), _mm_set1_ps(offset)), absMask);
+		__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(vnx, absMask), halfWidth), _mm_mul_ps(_mm_and_ps(vny, absMask), halfHeight)), _mm_set1_ps(slack));
+		overlap = _mm_and_ps(overlap, _mm_cmple_ps(distance, radius));
+
+		mask |= static_cast<uint32_t>(_mm_movemask_ps(overlap)) << i;
+	}
+#endif
+
+	// Scalar fallback and remainder
+	for(; i < count; i++) {
+		int r = index + i;
+		bool overlap = maxX[r] >= segMinX && minX[r] <= segMaxX && maxY[r] >= segMinY && minY[r] <= segMaxY;
+
+		float distance = std::abs(nx * (minX[r] + maxX[r]) * 0.5f + ny * (minY[r] + maxY[r]) * 0.5f - offset);
+		float radius = std::abs(nx) * (maxX[r] - minX[r]) * 0.5f + std::abs(ny) * (maxY[r] - minY[r]) * 0.5f + slack;
+
+		if(overlap && distance <= radius) {
+			mask |= 1u << i;
+		}
+	}
+
+	return mask;
+}
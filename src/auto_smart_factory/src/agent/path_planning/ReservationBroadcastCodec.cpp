@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cmath>
+
+#include "agent/path_planning/ReservationBroadcastCodec.h"
+
+void ReservationBroadcastCodec::encode(auto_smart_factory::ReservationBroadcast& msg, const std::vector<int>& keptSequences, const std::vector<Rectangle>& newReservations, double baseTime) {
+	msg.baseTime = baseTime;
+	msg.keptSequences.assign(keptSequences.begin(), keptSequences.end());
+	msg.sizeClasses.clear();
+	msg.reservations.clear();
+	msg.reservations.reserve(newReservations.size());
+	
+	for(const Rectangle& r : newReservations) {
+		auto_smart_factory::CompactReservation compact;
+		compact.sequence = r.getSequence();
+		compact.posX = static_cast<float>(r.getPosition().x);
+		compact.posY = static_cast<float>(r.getPosition().y);
+		compact.sizeX = static_cast<float>(r.getSize().x);
+		
+		float sizeY = static_cast<float>(r.getSize().y);
+		auto sizeClass = std::find(msg.sizeClasses.begin(), msg.sizeClasses.end(), sizeY);
+		compact.sizeClass = static_cast<uint16_t>(sizeClass - msg.sizeClasses.begin());
+		if(sizeClass == msg.sizeClasses.end()) {
+			msg.sizeClasses.push_back(sizeY);
+		}
+		
+		double turns = r.getRotation() / 360.0;
+		compact.rotation = static_cast<uint16_t>(static_cast<long>(std::lround((turns - std::floor(turns)) * rotationSteps)) & 0xFFFF);
+		
+		compact.startTime = static_cast<float>(r.getStartTime() - baseTime);
+		compact.duration = static_cast<float>(r.getEndTime() - r.getStartTime());
+		compact.shape = static_cast<uint8_t>(r.getShape());
+		compact.holdDuration = static_cast<float>(r.getHoldDuration());
+		
+		msg.reservations.push_back(compact);
+	}
+}
+
+std::vector<Rectangle> ReservationBroadcastCodec::decode(const auto_smart_factory::ReservationBroadcast& msg) {
+	std::vector<Rectangle> reservations;
+	reservations.reserve(msg.reservations.size());
+	
+	for(const auto& r : msg.reservations) {
+		double startTime = msg.baseTime + r.startTime;
+		float rotation = static_cast<float>(r.rotation * (360.0 / rotationSteps));
+		
+		reservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, msg.sizeClasses[r.sizeClass]), rotation, startTime, startTime + r.duration,
+		                          msg.ownerId, r.sequence, static_cast<RectangleShape>(r.shape), r.holdDuration);
+	}
+	
+	return reservations;
+}
+
+bool ReservationBroadcastCodec::isKept(const auto_smart_factory::ReservationBroadcast& msg, int sequence) {
+	return std::find(msg.keptSequences.begin(), msg.keptSequences.end(), sequence) != msg.keptSequences.end();
+}
@@ -1,4 +1,4 @@
-
+#include <algorithm>
 #include <include/agent/path_planning/ReservationManager.h>
 #include <auto_smart_factory/ReservationRequest.h>
 
@@ -7,13 +7,21 @@
 ReservationManager::ReservationManager(ros::Publisher* publisher, Map* map, int agentId, auto_smart_factory::WarehouseConfiguration warehouseConfig) :
 	publisher(publisher),
 	map(map),
+	synchronizer(map),
+	mapSynchronizer(&synchronizer),
+	zoneLayout(ReservationZones::fromParameters(warehouseConfig.map_configuration.width, warehouseConfig.map_configuration.height)),
+	receivesZoneBroadcasts(false),
 	agentId(agentId),
 	pathRetrievedCount(0),
 	hasReservedPath(false),
 	bidingForReservation(false),
 	replanningNecessary(false),
 	replanningBeneficial(false),
-	requestedEmergencyStop(false)
+	requestedEmergencyStop(false),
+	lastPlanningTime(0),
+	pathKnownBroadcastSequence(0),
+	pathKnownEpoch(0),
+	nextReservationSequence(Map::idleReservationSequence + 1)
 {
 	// Add infinite reservation for starting point
 	double infiniteReservationStartTime = ros::Time::now().toSec() - 1000.f;
@@ -25,7 +33,7 @@ ReservationManager::ReservationManager(ros::Publisher* publisher, Map* map, int
 		
 		if(id == agentId) {
 			Point pos = Point(static_cast<float>(idlePosition.pose.x), static_cast<float>(idlePosition.pose.y));
-			lastReservedPathReservations.emplace_back(pos, Point(Path::getReservationSize(), Path::getReservationSize()), 0, infiniteReservationStartTime, Map::infiniteReservationTime, agentId);
+			lastReservedPathReservations.add(Rectangle(pos, Point(Path::getReservationSize(), Path::getReservationSize()), 0, infiniteReservationStartTime, Map::infiniteReservationTime, agentId, Map::idleReservationSequence));
 		}
 	}
 }
@@ -42,26 +50,101 @@ void ReservationManager::update(Point pos) {
 }
 
 void ReservationManager::reservationBroadcastCallback(const auto_smart_factory::ReservationBroadcast& msg) {
-	// This only works if the messages arrive in order
+	std::vector<Rectangle> oldReservations;
+	std::vector<Rectangle> reservations;
+	
+	ReservationSynchronizer::Action action = synchronizer.onBroadcast(msg);
+	if(action == ReservationSynchronizer::Action::APPLY_AND_HANDLE) {
+		applyReservationBroadcast(map, msg, oldReservations, reservations);
+	} else if(action == ReservationSynchronizer::Action::HANDLE) {
+		reservations = ReservationBroadcastCodec::decode(msg);
+	} else {
+		return;
+	}
+	
+	handleAppliedReservationBroadcast(msg, oldReservations, reservations);
+}
+
+bool ReservationManager::synchronizeReservations() {
+	return synchronizer.bootstrap();
+}
+
+void ReservationManager::setMapSynchronizer(const ReservationSynchronizer* mapSynchronizer) {
+	this->mapSynchronizer = mapSynchronizer;
+}
+
+bool ReservationManager::receiveZoneBroadcasts() {
+	if(!zoneLayout.isPartitioned()) {
+		return false;
+	}
+	
+	receivesZoneBroadcasts = true;
+	setReceivedZones(getZonesOfLastReserved());
+	return true;
+}
+
+void ReservationManager::setReceivedZones(const std::vector<int>& zones) {
+	if(zones == receivedZones) {
+		return;
+	}
+	
+	// Subscribe before the synchronization, so no broadcast after the snapshot is missed
+	ros::NodeHandle n;
+	for(int zone : zones) {
+		if(zoneBroadcastSubscribers.count(zone) == 0) {
+			zoneBroadcastSubscribers[zone] = n.subscribe(ReservationZones::getBroadcastTopic(zone), 100, &ReservationManager::reservationBroadcastCallback, this);
+		}
+	}
+	for(auto subscriber = zoneBroadcastSubscribers.begin(); subscriber != zoneBroadcastSubscribers.end();) {
+		if(std::binary_search(zones.begin(), zones.end(), subscriber->first)) {
+			++subscriber;
+		} else {
+			subscriber = zoneBroadcastSubscribers.erase(subscriber);
+		}
+	}
+	
+	receivedZones = zones;
+	synchronizer.setZones(zones);
+}
+
+std::vector<int> ReservationManager::getZonesOfLastReserved() const {
+	std::vector<Rectangle> reservations;
+	for(int i = 0; i < lastReservedPathReservations.size(); i++) {
+		reservations.push_back(lastReservedPathReservations.get(i));
+	}
+	
+	return zoneLayout.getZones(reservations, zoneMargin);
+}
+
+void ReservationManager::applyReservationBroadcast(Map* map, const auto_smart_factory::ReservationBroadcast& msg, std::vector<Rectangle>& oldReservations, std::vector<Rectangle>& reservations) {
+	// Messages have to be applied in order, see ReservationSynchronizer
 	if(msg.isReservationBroadcastOrDenial) {
-		std::vector<Rectangle> oldReservations;
-		oldReservations = map->deleteReservationsFromAgent(msg.ownerId);	
-						
-		std::vector<Rectangle> reservations = getReservationsFromMessage(msg);
-		map->addReservations(reservations);		
+		oldReservations = map->deleteReservationsFromAgent(msg.ownerId, msg.keptSequences);
 		
+		reservations = ReservationBroadcastCodec::decode(msg);
+		map->addReservations(reservations);
+	}
+}
+
+void ReservationManager::handleAppliedReservationBroadcast(const auto_smart_factory::ReservationBroadcast& msg, const std::vector<Rectangle>& oldReservations, const std::vector<Rectangle>& reservations) {
+	if(msg.isReservationBroadcastOrDenial) {
 		if(msg.ownerId == agentId) {
 			if(msg.isEmergencyStop) {
 				requestedEmergencyStop = false;
+				grantedReservations.clear();
 			} else {
 				hasReservedPath = true;
 				bidingForReservation = false;
 				pathRetrievedCount = 0;
+				grantedReservations = requestedReservations;
 			}
 
 			replanningNecessary = false;
 			replanningBeneficial = false;
-			saveReservationsAsLastReserved(msg);
+			saveReservationsAsLastReserved(msg, reservations);
+			if(receivesZoneBroadcasts) {
+				setReceivedZones(getZonesOfLastReserved());
+			}
 			
 		} else {
 			if(!replanningBeneficial && isReplanningBeneficialWithoutTheseReservations(oldReservations)) {
@@ -79,22 +162,13 @@ void ReservationManager::reservationBroadcastCallback(const auto_smart_factory::
 	} else if (msg.ownerId == agentId) {
 		// Reservation was denied
 		if(bidingForReservation) {
-			if(calculateNewPath()) {
+			if(calculateNewPath(useIncrementalReplanning)) {
 				requestPathReservation();
 			}
 		}		
 	}	
 }
 
-std::vector<Rectangle> ReservationManager::getReservationsFromMessage(const auto_smart_factory::ReservationBroadcast& msg) {
-	std::vector<Rectangle> reservations;
-	for(auto r : msg.reservations) {
-		reservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId);
-	}
-	
-	return reservations;
-}
-
 void ReservationManager::publishEmergencyStop(Point pos) {
 	requestedEmergencyStop = true;
 	
@@ -112,16 +186,36 @@ void ReservationManager::publishEmergencyStop(Point pos) {
 	rectangle.startTime = infiniteReservationStartTime;
 	rectangle.endTime = Map::infiniteReservationTime;
 	rectangle.ownerId = agentId;
+	rectangle.sequence = nextReservationSequence++;
 
 	msg.reservations.push_back(rectangle);
 	publisher->publish(msg);
 }
 
-void ReservationManager::saveReservationsAsLastReserved(const auto_smart_factory::ReservationBroadcast& msg) {
-	lastReservedPathReservations.clear();
-	for(auto r : msg.reservations) {
-		lastReservedPathReservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId);
+void ReservationManager::saveReservationsAsLastReserved(const auto_smart_factory::ReservationBroadcast& msg, const std::vector<Rectangle>& reservations) {
+	RectangleBatch lastReserved;
+	for(int i = 0; i < lastReservedPathReservations.size(); i++) {
+		if(ReservationBroadcastCodec::isKept(msg, lastReservedPathReservations.get(i).getSequence())) {
+			lastReserved.add(lastReservedPathReservations.get(i));
+		}
 	}
+	for(const auto& r : reservations) {
+		lastReserved.add(r);
+	}
+	
+	lastReservedPathReservations = lastReserved;
+}
+
+int ReservationManager::findGrantedReservationSequence(const Rectangle& reservation) const {
+	for(const auto& r : grantedReservations) {
+		if(r.getStartTime() == reservation.getStartTime() && r.getEndTime() == reservation.getEndTime() &&
+		   r.getPosition() == reservation.getPosition() && r.getSize() == reservation.getSize() && r.getRotation() == reservation.getRotation() &&
+		   r.getShape() == reservation.getShape() && r.getHoldDuration() == reservation.getHoldDuration()) {
+			return r.getSequence();
+		}
+	}
+	
+	return Rectangle::noSequence;
 }
 
 void ReservationManager::requestPathReservation() {
@@ -130,10 +224,19 @@ void ReservationManager::requestPathReservation() {
 		msg.ownerId = agentId;
 		msg.bid = pathToReserve.getDuration();
 		msg.isEmergencyStop = static_cast<unsigned char>(false);
+		msg.knownBroadcastSequence = pathKnownBroadcastSequence;
+		msg.knownEpoch = pathKnownEpoch;
 		
 		bool startsAtTray = lastReservedPathReservations.size() > 1;
 
+		requestedReservations.clear();
 		for(const auto& r : pathToReserve.generateReservations(agentId, startsAtTray)) {
+			int sequence = findGrantedReservationSequence(r);
+			if(sequence == Rectangle::noSequence) {
+				sequence = nextReservationSequence++;
+			}
+			requestedReservations.emplace_back(r.getPosition(), r.getSize(), r.getRotation(), r.getStartTime(), r.getEndTime(), r.getOwnerId(), sequence, r.getShape(), r.getHoldDuration());
+			
 			auto_smart_factory::Rectangle rectangle;
 			rectangle.posX = r.getPosition().x;
 			rectangle.posY = r.getPosition().y;
@@ -143,9 +246,24 @@ void ReservationManager::requestPathReservation() {
 			rectangle.startTime = r.getStartTime();
 			rectangle.endTime = r.getEndTime();
 			rectangle.ownerId = r.getOwnerId();
+			rectangle.sequence = sequence;
+			rectangle.shape = static_cast<uint8_t>(r.getShape());
+			rectangle.holdDuration = r.getHoldDuration();
 
 			msg.reservations.push_back(rectangle);
 		}
+		
+		if(receivesZoneBroadcasts) {
+			std::vector<int> zones = ReservationZones::unite(receivedZones, zoneLayout.getZones(requestedReservations, zoneMargin));
+			if(zones.size() > receivedZones.size()) {
+				// The path leaves the zones it was planned with, plan again knowing the reservations of the other zones
+				setReceivedZones(zones);
+				if(calculateNewPath(false)) {
+					requestPathReservation();
+				}
+				return;
+			}
+		}
 
 		publisher->publish(msg);	
 	}	
@@ -158,8 +276,15 @@ void ReservationManager::startBiddingForPathReservation(OrientedPoint startPoint
 	this->targetReservationDuration = targetReservationDuration;
 	bidingForReservation = true;
 	hasReservedPath = false;
+	
+	if(receivesZoneBroadcasts) {
+		// Plan with the reservations around the route
+		std::vector<int> routeZones = zoneLayout.getZonesInBox(std::min(startPoint.x, endPoint.x) - zoneMargin, std::max(startPoint.x, endPoint.x) + zoneMargin,
+		                                                       std::min(startPoint.y, endPoint.y) - zoneMargin, std::max(startPoint.y, endPoint.y) + zoneMargin);
+		setReceivedZones(ReservationZones::unite(getZonesOfLastReserved(), routeZones));
+	}
 
-	if(calculateNewPath()) {
+	if(calculateNewPath(false)) {
 		requestPathReservation();
 	}
 }
@@ -182,8 +307,17 @@ Path ReservationManager::getLastReservedPath() {
 	return pathToReserve;
 }
 
-bool ReservationManager::calculateNewPath() {
-	pathToReserve = map->getThetaStarPath(startPoint, endPoint, ros::Time::now().toSec(), targetReservationDuration, true);
+bool ReservationManager::calculateNewPath(bool repairLastSearch) {
+	double now = ros::Time::now().toSec();
+	
+	if(repairLastSearch) {
+		pathToReserve = map->repairThetaStarPath(startPoint, endPoint, now, targetReservationDuration, true, &planningArena, lastPlanningTime);
+	} else {
+		pathToReserve = map->getThetaStarPath(startPoint, endPoint, now, targetReservationDuration, true, &planningArena);
+	}
+	lastPlanningTime = now;
+	pathKnownBroadcastSequence = mapSynchronizer->getKnownBroadcastSequence();
+	pathKnownEpoch = mapSynchronizer->getEpoch();
 
 	if(pathToReserve.isValid()) {
 		return true;
@@ -198,8 +332,10 @@ bool ReservationManager::isReplanningNecessary() const {
 }
 
 bool ReservationManager::isInOwnReservation(Point pos, double time) {
-	for(const Rectangle& r : lastReservedPathReservations) {
-		if(r.getStartTime() - 0.5f <= time && time <= r.getEndTime() + 0.5f && Math::isPointInRectangle(pos, r)) {
+	int count = lastReservedPathReservations.size();
+	for(int i = lastReservedPathReservations.findRectangleContainingPoint(pos, 0, count); i != -1; i = lastReservedPathReservations.findRectangleContainingPoint(pos, i + 1, count)) {
+		double start, end;
+		if(Math::getReservedTimeRangeAtPoint(pos, lastReservedPathReservations.get(i), start, end) && start - 0.5f <= time && time <= end + 0.5f) {
 			return true;
 		}
 	}
@@ -220,13 +356,19 @@ bool ReservationManager::doesEmergencyStopPreventsOwnPath(const std::vector<Rect
 	const std::vector<Point>& nodes = pathToReserve.getNodes();
 	const std::vector<double>& departureTimes = pathToReserve.getDepartureTimes();
 	
+	RectangleBatch emergencyStops;
+	for(const Rectangle& emergencyStop : emergencyStopReservations) {
+		emergencyStops.add(emergencyStop);
+	}
+	int count = emergencyStops.size();
+	
     for(int i = 0; i < nodes.size() - 1; i++) {
     	if(now > departureTimes[i + 1]) {
 		    continue;
     	}
     	
-    	for(const Rectangle& emergencyStop : emergencyStopReservations) {
-		    if(emergencyStop.doesOverlapTimeRange(departureTimes[i], departureTimes[i + 1], agentId) && Math::doesLineSegmentIntersectRectangle(nodes[i], nodes[i + 1], emergencyStop)) {
+    	for(int j = emergencyStops.findIntersectionWithLineSegment(nodes[i], nodes[i + 1], 0, count); j != -1; j = emergencyStops.findIntersectionWithLineSegment(nodes[i], nodes[i + 1], j + 1, count)) {
+		    if(emergencyStops.get(j).doesOverlapTimeRange(departureTimes[i], departureTimes[i + 1], agentId)) {
 				return true;
 		    }
 	    }
@@ -241,8 +383,17 @@ bool ReservationManager::isReplanningBeneficialWithoutTheseReservations(const st
 	}
 
 	double pathFinishTime = pathToReserve.getDepartureTimes().back();
+	Point end(pathToReserve.getEnd().x, pathToReserve.getEnd().y);
+	
+	RectangleBatch batch;
 	for(const Rectangle& r : oldReservations) {
-		if(Math::isPointInRectangle(Point(pathToReserve.getEnd().x, pathToReserve.getEnd().y), r) && r.getEndTime() - r.getStartTime() >= 45.f && std::abs(pathFinishTime - r.getEndTime()) <= 6.f) {
+		batch.add(r);
+	}
+	int count = batch.size();
+	
+	for(int i = batch.findRectangleContainingPoint(end, 0, count); i != -1; i = batch.findRectangleContainingPoint(end, i + 1, count)) {
+		const Rectangle& r = batch.get(i);
+		if(r.getEndTime() - r.getStartTime() >= 45.f && std::abs(pathFinishTime - r.getEndTime()) <= 6.f) {
 			return true;
 		}	
 	}
@@ -0,0 +1,154 @@
+#include <algorithm>
+
+#include "agent/path_planning/ReservationSynchronizer.h"
+
+#include "auto_smart_factory/GetReservationSnapshot.h"
+#include "agent/path_planning/ReservationBroadcastCodec.h"
+
+ReservationSynchronizer::ReservationSynchronizer(Map* map) :
+	map(map)
+{
+	ros::NodeHandle n;
+	snapshotClient = n.serviceClient<auto_smart_factory::GetReservationSnapshot>("/reservation_master/get_reservation_snapshot");
+}
+
+bool ReservationSynchronizer::bootstrap() {
+	if(!synchronize()) {
+		return false;
+	}
+
+	handledSequence = snapshotSequence;
+	return true;
+}
+
+bool ReservationSynchronizer::setZones(const std::vector<int>& zones) {
+	bool isAddingZones = !std::includes(this->zones.begin(), this->zones.end(), zones.begin(), zones.end()) || (this->zones.empty() != zones.empty());
+	this->zones = zones;
+
+	if(!isAddingZones) {
+		for(auto topicSequence = topicSequences.begin(); topicSequence != topicSequences.end();) {
+			if(std::binary_search(zones.begin(), zones.end(), topicSequence->first)) {
+				++topicSequence;
+			} else {
+				topicBroadcastSequences.erase(topicSequence->first);
+				topicSequence = topicSequences.erase(topicSequence);
+			}
+		}
+		return true;
+	}
+
+	// Before the bootstrap the first broadcast synchronizes the reservations
+	return !hasSequence || synchronize();
+}
+
+ReservationSynchronizer::Action ReservationSynchronizer::onBroadcast(const auto_smart_factory::ReservationBroadcast& msg) {
+	// Can still arrive after the zone was removed
+	if((msg.zone == -1) != zones.empty() || (msg.zone != -1 && !std::binary_search(zones.begin(), zones.end(), msg.zone))) {
+		return Action::IGNORE;
+	}
+
+	auto topicSequence = topicSequences.find(msg.zone);
+	bool isGap = hasSequence && msg.epoch == epoch && topicSequence != topicSequences.end() && msg.zoneSequence > topicSequence->second + 1;
+	if(!hasSequence || msg.epoch != epoch || topicSequence == topicSequences.end() || isGap) {
+		if(isGap) {
+			ROS_WARN("[Reservation Synchronizer] Missed broadcasts %lu to %lu in zone %d, synchronizing reservations", static_cast<unsigned long>(topicSequence->second + 1),
+			         static_cast<unsigned long>(msg.zoneSequence - 1), msg.zone);
+		}
+		if(msg.epoch != epoch) {
+			ownerSequences.clear();
+			handledSequences.clear();
+			handledSequence = 0;
+		}
+
+		if(!synchronize()) {
+			// Without a snapshot broadcasts are applied in the order they arrive
+			epoch = msg.epoch;
+			topicSequences[msg.zone] = msg.zoneSequence;
+			hasSequence = true;
+		}
+	}
+
+	if(msg.epoch != epoch) {
+		return Action::IGNORE;
+	}
+
+	uint64_t& lastTopicSequence = topicSequences[msg.zone];
+	lastTopicSequence = std::max(lastTopicSequence, msg.zoneSequence);
+	uint64_t& lastTopicBroadcastSequence = topicBroadcastSequences[msg.zone];
+	lastTopicBroadcastSequence = std::max(lastTopicBroadcastSequence, msg.broadcastSequence);
+
+	// Copies from other zones and broadcasts contained in the bootstrap snapshot
+	uint64_t& lastHandledSequence = handledSequences[msg.ownerId];
+	if(msg.broadcastSequence <= std::max(lastHandledSequence, handledSequence)) {
+		return Action::IGNORE;
+	}
+	lastHandledSequence = msg.broadcastSequence;
+
+	// Denials do not change reservations
+	if(!msg.isReservationBroadcastOrDenial || msg.broadcastSequence <= ownerSequences[msg.ownerId]) {
+		return Action::HANDLE;
+	}
+
+	if(msg.baseSequence != 0 && msg.baseSequence != ownerSequences[msg.ownerId]) {
+		ROS_WARN("[Reservation Synchronizer] Broadcast %lu of robot %d refers to an unknown broadcast, synchronizing reservations",
+		         static_cast<unsigned long>(msg.broadcastSequence), msg.ownerId);
+
+		// Without a snapshot the broadcast is applied anyway
+		if(synchronize() && msg.broadcastSequence <= ownerSequences[msg.ownerId]) {
+			return Action::HANDLE;
+		}
+	}
+
+	ownerSequences[msg.ownerId] = msg.broadcastSequence;
+	return Action::APPLY_AND_HANDLE;
+}
+
+bool ReservationSynchronizer::synchronize() {
+	auto_smart_factory::GetReservationSnapshot srv;
+	srv.request.zones.assign(zones.begin(), zones.end());
+	if(!snapshotClient.call(srv) || srv.response.zoneBroadcastSequences.size() != zones.size()) {
+		ROS_WARN("[Reservation Synchronizer] Failed to get a reservation snapshot");
+		isSynchronized = false;
+		return false;
+	}
+
+	for(const auto& ownerReservations : srv.response.reservations) {
+		map->deleteReservationsFromAgent(ownerReservations.ownerId);
+		map->addReservations(ReservationBroadcastCodec::decode(ownerReservations));
+		ownerSequences[ownerReservations.ownerId] = ownerReservations.broadcastSequence;
+	}
+
+	epoch = srv.response.epoch;
+	snapshotSequence = srv.response.broadcastSequence;
+	topicSequences.clear();
+	topicBroadcastSequences.clear();
+	if(zones.empty()) {
+		topicSequences[-1] = srv.response.broadcastSequence;
+		topicBroadcastSequences[-1] = srv.response.broadcastSequence;
+	}
+	for(unsigned long i = 0; i < zones.size(); i++) {
+		topicSequences[zones[i]] = srv.response.zoneBroadcastSequences[i];
+		topicBroadcastSequences[zones[i]] = srv.response.broadcastSequence;
+	}
+	hasSequence = true;
+	isSynchronized = true;
+
+	return true;
+}
+
+uint64_t ReservationSynchronizer::getKnownBroadcastSequence() const {
+	if(!isSynchronized || topicBroadcastSequences.empty()) {
+		return 0;
+	}
+
+	uint64_t knownSequence = topicBroadcastSequences.begin()->second;
+	for(const auto& topicBroadcastSequence : topicBroadcastSequences) {
+		knownSequence = std::min(knownSequence, topicBroadcastSequence.second);
+	}
+
+	return knownSequence;
+}
+
+uint32_t ReservationSynchronizer::getEpoch() const {
+	return epoch;
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+
+#include "agent/path_planning/ReservationTable.h"
+
+ReservationTable::ReservationTable(float width, float height, float cellSize) :
+	cellSize(cellSize)
+{
+	columns = std::max(1, static_cast<int>(std::ceil(width / cellSize)));
+	rows = std::max(1, static_cast<int>(std::ceil(height / cellSize)));
+	cells.resize(static_cast<unsigned long>(columns * rows));
+}
+
+int ReservationTable::add(const Rectangle& reservation) {
+	int slot;
+	if(!freeSlots.empty()) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+		reservations[slot] = reservation;
+	} else {
+		slot = static_cast<int>(reservations.size());
+		reservations.push_back(reservation);
+		slots.emplace_back();
+	}
+	
+	Slot& s = slots[slot];
+	s.used = true;
+	s.minX = GridTraversal::toCell(reservation.getMinXInflated(), cellSize, columns);
+	s.maxX = GridTraversal::toCell(reservation.getMaxXInflated(), cellSize, columns);
+	s.minY = GridTraversal::toCell(reservation.getMinYInflated(), cellSize, rows);
+	s.maxY = GridTraversal::toCell(reservation.getMaxYInflated(), cellSize, rows);
+	
+	CellEntry entry{slot, reservation.getStartTime(), reservation.getEndTime()};
+	for(int row = s.minY; row <= s.maxY; row++) {
+		for(int column = s.minX; column <= s.maxX; column++) {
+			cells[row * columns + column].push_back(entry);
+		}
+	}
+	
+	expiryOrder.emplace(reservation.getEndTime(), slot);
+	if(reservation.getSequence() != Rectangle::noSequence) {
+		slotsById[reservation.getId()] = slot;
+	}
+	
+	return slot;
+}
+
+void ReservationTable::remove(int slot) {
+	Slot& s = slots[slot];
+	if(!s.used) {
+		return;
+	}
+	
+	for(int row = s.minY; row <= s.maxY; row++) {
+		for(int column = s.minX; column <= s.maxX; column++) {
+			std::vector<CellEntry>& cell = cells[row * columns + column];
+			auto iter = std::find_if(cell.begin(), cell.end(), [slot](const CellEntry& e) { return e.slot == slot; });
+			if(iter != cell.end()) {
+				*iter = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+	
+	expiryOrder.erase(std::make_pair(reservations[slot].getEndTime(), slot));
+	auto id = slotsById.find(reservations[slot].getId());
+	if(id != slotsById.end() && id->second == slot) {
+		slotsById.erase(id);
+	}
+	s.used = false;
+	freeSlots.push_back(slot);
+}
+
+int ReservationTable::findSlot(ReservationId id) const {
+	auto iter = slotsById.find(id);
+	
+	return iter != slotsById.end() ? iter->second : -1;
+}
+
+int ReservationTable::removeExpired(double time) {
+	int count = 0;
+	
+	while(!expiryOrder.empty() && expiryOrder.begin()->first < time) {
+		remove(expiryOrder.begin()->second);
+		count++;
+	}
+	
+	return count;
+}
+
+bool ReservationTable::hasExpired(double time) const {
+	return !expiryOrder.empty() && expiryOrder.begin()->first < time;
+}
+
+const Rectangle& ReservationTable::get(int slot) const {
+	return reservations[slot];
+}
+
+bool ReservationTable::isUsed(int slot) const {
+	return slot >= 0 && slot < static_cast<int>(slots.size()) && slots[slot].used;
+}
+
+int ReservationTable::getSlotCount() const {
+	return static_cast<int>(slots.size());
+}
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "ros/ros.h"
+#include "agent/path_planning/ReservationZones.h"
+
+ReservationZones::ReservationZones(float width, float height, int columns, int rows) :
+	columns(std::max(columns, 1)),
+	rows(std::max(rows, 1))
+{
+	zoneWidth = width / static_cast<float>(this->columns);
+	zoneHeight = height / static_cast<float>(this->rows);
+}
+
+ReservationZones ReservationZones::fromParameters(float width, float height) {
+	int columns;
+	int rows;
+	ros::param::param("/reservation_master/zone_columns", columns, 1);
+	ros::param::param("/reservation_master/zone_rows", rows, 1);
+
+	return ReservationZones(width, height, columns, rows);
+}
+
+int ReservationZones::getZoneCount() const {
+	return columns * rows;
+}
+
+bool ReservationZones::isPartitioned() const {
+	return getZoneCount() > 1;
+}
+
+std::vector<int> ReservationZones::getZonesInBox(double minX, double maxX, double minY, double maxY) const {
+	int minColumn = toZoneIndex(minX, zoneWidth, columns);
+	int maxColumn = toZoneIndex(maxX, zoneWidth, columns);
+	int minRow = toZoneIndex(minY, zoneHeight, rows);
+	int maxRow = toZoneIndex(maxY, zoneHeight, rows);
+
+	std::vector<int> zones;
+	for(int row = minRow; row <= maxRow; row++) {
+		for(int column = minColumn; column <= maxColumn; column++) {
+			zones.push_back(row * columns + column);
+		}
+	}
+
+	return zones;
+}
+
+std::vector<int> ReservationZones::getZones(const std::vector<Rectangle>& reservations, double margin) const {
+	std::vector<int> zones;
+	for(const Rectangle& r : reservations) {
+		zones = unite(zones, getZonesInBox(r.getMinXInflated() - margin, r.getMaxXInflated() + margin, r.getMinYInflated() - margin, r.getMaxYInflated() + margin));
+	}
+
+	return zones;
+}
+
+std::string ReservationZones::getBroadcastTopic(int zone) {
+	return "/reservation_broadcast/zone_" + std::to_string(zone);
+}
+
+std::vector<int> ReservationZones::unite(const std::vector<int>& a, const std::vector<int>& b) {
+	std::vector<int> zones;
+	std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(zones));
+
+	return zones;
+}
+
+int ReservationZones::toZoneIndex(double coordinate, float zoneSize, int count) {
+	int index = static_cast<int>(std::floor(coordinate / zoneSize));
+
+	return std::min(std::max(index, 0), count - 1);
+}
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "agent/path_planning/SippPathPlanner.h"
+#include "agent/path_planning/TimedLineOfSightResult.h"
+#include "ros/ros.h"
+#include "Math.h"
+
+SippPathPlanner::SippPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations) :
+	map(thetaStarMap),
+	hardwareProfile(hardwareProfile),
+	start(OrientedPoint(start.x, start.y, Math::toDeg(start.o))),
+	target(OrientedPoint(target.x, target.y, Math::toDeg(target.o))),
+	timing(startingTime, this->start, hardwareProfile),
+	targetDistanceField(nullptr),
+	startingTime(startingTime),
+	targetReservationTime(targetReservationTime),
+	isValidPathQuery(true)
+{
+	auto nodeCount = static_cast<unsigned long>(map->getNodeCount());
+	safeIntervals.resize(nodeCount);
+	hasSafeIntervals.assign(nodeCount, false);
+	stateIndices.resize(nodeCount);
+
+	startNode = map->getNodeClosestTo(Point(start));
+	targetNode = map->getNodeClosestTo(Point(target));
+
+	if(startNode == nullptr) {
+		ROS_FATAL("[Agent %d] StartPoint %f/%f is not in theta* map!", map->getOwnerId(), start.x, start.y);
+		isValidPathQuery = false;
+		return;
+	}
+
+	if(targetNode == nullptr) {
+		ROS_FATAL("[Agent %d] TargetPoint %f/%f is not in theta* map!", map->getOwnerId(), target.x, target.y);
+		isValidPathQuery = false;
+		return;
+	}
+	targetDistanceField = map->getDistanceField(targetNode);
+
+	// The start must be inside a safe interval, otherwise the smaller variant of the reservations on the start point is used if allowed
+	const std::vector<SafeInterval>& startIntervals = getSafeIntervals(startNode);
+	bool isStartSafe = std::any_of(startIntervals.begin(), startIntervals.end(), [&](const SafeInterval& interval) {
+		return interval.start <= startingTime && startingTime <= interval.end;
+	});
+
+	if(!isStartSafe) {
+		if(ignoreStartingReservations) {
+			smallerReservations = map->getReservationIdsOnStartingPoint(startNode->pos);
+			hasSafeIntervals.assign(nodeCount, false);
+			ROS_WARN("[Agent %d] Start is reserved. Using %d smaller reservations instead!", map->getOwnerId(), (int) smallerReservations.size());
+		} else {
+			isValidPathQuery = false;
+		}
+	}
+}
+
+Path SippPathPlanner::findPath() {
+	if(!isValidPathQuery) {
+		return Path();
+	}
+
+	if((start.x == target.x && start.y == target.y) || startNode == targetNode) {
+		return Path(startingTime, {Point(start), Point(target)}, {0.0, 0.0}, hardwareProfile, targetReservationTime, OrientedPoint(start.x, start.y, Math::toRad(start.o)), OrientedPoint(target.x, target.y, Math::toRad(target.o)), map->getOwnerId());
+	}
+
+	// Push the start state
+	const std::vector<SafeInterval>& startIntervals = getSafeIntervals(startNode);
+	int startInterval = -1;
+	for(int i = 0; i < static_cast<int>(startIntervals.size()); i++) {
+		if(startIntervals[i].start <= startingTime && startingTime <= startIntervals[i].end) {
+			startInterval = i;
+		}
+	}
+
+	if(startInterval == -1) {
+		return Path();
+	}
+
+	std::vector<QueueEntry> queue;
+	QueueEntryComparator comparator;
+	int startState = getState(startNode, startInterval);
+	states[startState].time = startingTime;
+	queue.emplace_back(startingTime + getHeuristic(startNode), startState);
+
+	while(!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), comparator);
+		QueueEntry entry = queue.back();
+		queue.pop_back();
+
+		// Skip entries of states which were reached earlier after they were queued
+		State current = states[entry.second];
+		if(entry.first > current.time + getHeuristic(current.node)) {
+			continue;
+		}
+
+		if(current.node == targetNode) {
+			return constructPath(entry.second);
+		}
+
+		double intervalEnd = getSafeIntervals(current.node)[current.interval].end;
+
+		for(const GridNode* neighbour : current.node->neighbours) {
+			// Connect to the prev state directly, waiting there at most until its safe interval ends
+			if(current.prev != -1) {
+				const State& prev = states[current.prev];
+				double prevIntervalEnd = getSafeIntervals(prev.node)[prev.interval].end;
+
+				if(neighbour != prev.node) {
+					connect(current.prev, prev.time, prevIntervalEnd, neighbour, queue);
+				}
+			}
+
+			// Connect to the current state, waiting at most until its safe interval ends
+			connect(entry.second, current.time, intervalEnd, neighbour, queue);
+		}
+	}
+
+	return Path();
+}
+
+const std::vector<SafeInterval>& SippPathPlanner::getSafeIntervals(const GridNode* node) {
+	auto index = static_cast<unsigned long>(node->id);
+
+	if(!hasSafeIntervals[index]) {
+		safeIntervals[index] = map->getSafeIntervals(node, smallerReservations);
+		hasSafeIntervals[index] = true;
+	}
+
+	return safeIntervals[index];
+}
+
+int SippPathPlanner::getState(const GridNode* node, int interval) {
+	std::vector<int>& indices = stateIndices[node->id];
+	if(indices.empty()) {
+		indices.assign(getSafeIntervals(node).size(), -1);
+	}
+
+	if(indices[interval] == -1) {
+		indices[interval] = static_cast<int>(states.size());
+		states.push_back(State{node, interval, std::numeric_limits<double>::max(), -1, 0});
+	}
+
+	return indices[interval];
+}
+
+double SippPathPlanner::getHeuristic(const GridNode* node) const {
+	double distance = Math::getDistance(node->pos, targetNode->pos);
+
+	if(targetDistanceField != nullptr && std::isfinite(targetDistanceField[node->id])) {
+		distance = std::max(distance, static_cast<double>(targetDistanceField[node->id]));
+	}
+
+	return hardwareProfile->getDrivingDuration(distance);
+}
+
+double SippPathPlanner::getDrivingAndTurningTime(int from, const GridNode* to) const {
+	const State& state = states[from];
+	double turningTime;
+
+	if(state.prev != -1) {
+		turningTime = timing.getTurningTime(states[state.prev].node->pos, state.node->pos, to->pos);
+	} else {
+		turningTime = timing.getTurningTime(start.o, state.node->pos, to->pos);
+	}
+
+	return turningTime + hardwareProfile->getDrivingDuration(Math::getDistance(state.node->pos, to->pos));
+}
+
+void SippPathPlanner::connect(int from, double minDeparture, double maxDeparture, const GridNode* to, std::vector<QueueEntry>& queue) {
+	// Copy, the state storage may grow while connecting
+	State fromState = states[from];
+	map->collectTimedEdge(fromState.node, to, fromState.time, smallerReservations, edge);
+	if(!edge.isStaticLineOfSightFree()) {
+		return;
+	}
+
+	// Dont wait forever
+	maxDeparture = std::min(maxDeparture, fromState.time + maxWaitingTime);
+	double drivingTime = getDrivingAndTurningTime(from, to);
+	int intervalCount = static_cast<int>(getSafeIntervals(to).size());
+
+	for(int i = 0; i < intervalCount; i++) {
+		SafeInterval interval = getSafeIntervals(to)[i];
+
+		// Intervals are sorted, later intervals can not be reached either
+		double departure = std::max(minDeparture, interval.start - drivingTime);
+		if(departure > maxDeparture) {
+			break;
+		}
+
+		// Move the departure past reservations on the connection, the robot waits at the from node meanwhile.
+		// Upcoming obstacles at the node are already excluded by its safe interval
+		bool isConnected = false;
+		for(int attempt = 0; attempt < maxDepartureAttempts && departure <= maxDeparture && departure + drivingTime <= interval.end; attempt++) {
+			TimedLineOfSightResult result = edge.whenIsLineOfSightFree(departure, departure + drivingTime);
+
+			if(!result.blockedByTimed) {
+				isConnected = edge.isConnectionFree(fromState.time, departure - fromState.time, drivingTime);
+				break;
+			}
+
+			departure = std::max(departure, result.freeAfter);
+		}
+
+		double arrival = departure + drivingTime;
+
+		// The robot has to stay at the target for the target reservation time
+		if(!isConnected || (to == targetNode && arrival + targetReservationTime > interval.end)) {
+			continue;
+		}
+
+		int toState = getState(to, i);
+		if(arrival < states[toState].time) {
+			states[toState].time = arrival;
+			states[toState].prev = from;
+			states[toState].waitTimeAtPrev = departure - fromState.time;
+			queue.emplace_back(arrival + getHeuristic(to), toState);
+			std::push_heap(queue.begin(), queue.end(), QueueEntryComparator());
+		}
+	}
+}
+
+Path SippPathPlanner::constructPath(int targetState) const {
+	std::vector<Point> pathNodes;
+	std::vector<double> waitTimes;
+	double waitTimeAtPrev = 0;
+
+	for(int i = targetState; i != -1; i = states[i].prev) {
+		pathNodes.emplace_back(states[i].node->pos);
+		waitTimes.push_back(waitTimeAtPrev);
+		waitTimeAtPrev = states[i].waitTimeAtPrev;
+	}
+
+	std::reverse(pathNodes.begin(), pathNodes.end());
+	std::reverse(waitTimes.begin(), waitTimes.end());
+
+	// Convert orientation to rad
+	return Path(startingTime, pathNodes, waitTimes, hardwareProfile, targetReservationTime, OrientedPoint(start.x, start.y, Math::toRad(start.o)), OrientedPoint(target.x, target.y, Math::toRad(target.o)), map->getOwnerId());
+}
@@ -0,0 +1,39 @@
+#include "agent/path_planning/StaticLineOfSightCache.h"
+
+bool StaticLineOfSightCache::find(uint64_t key, bool& isFree) const {
+	const Shard& shard = shards[getShardIndex(key)];
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto iter = shard.entries.find(key);
+	if(iter == shard.entries.end()) {
+		return false;
+	}
+
+	isFree = iter->second;
+	return true;
+}
+
+void StaticLineOfSightCache::insert(uint64_t key, bool isFree) {
+	Shard& shard = shards[getShardIndex(key)];
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	if(shard.entries.size() >= maxShardEntryCount) {
+		shard.entries.clear();
+	}
+	shard.entries.emplace(key, isFree);
+}
+
+std::unordered_map<uint64_t, bool> StaticLineOfSightCache::getEntries() const {
+	std::unordered_map<uint64_t, bool> entries;
+	for(const Shard& shard : shards) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		entries.insert(shard.entries.begin(), shard.entries.end());
+	}
+
+	return entries;
+}
+
+int StaticLineOfSightCache::getShardIndex(uint64_t key) {
+	// Fibonacci hashing, the top bits of the product depend on both node ids, so pairs of neighbouring nodes are spread over the shards
+	return static_cast<int>((key * 0x9E3779B97F4A7C15ull) >> 60);
+}
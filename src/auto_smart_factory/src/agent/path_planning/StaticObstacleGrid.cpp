@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cmath>
+
+#include "agent/path_planning/StaticObstacleGrid.h"
+#include "agent/path_planning/GridTraversal.h"
+
+StaticObstacleGrid::StaticObstacleGrid(const std::vector<Rectangle>& obstacles, float width, float height, float cellSize) :
+	cellSize(cellSize)
+{
+	columns = std::max(1, static_cast<int>(std::ceil(width / cellSize)));
+	rows = std::max(1, static_cast<int>(std::ceil(height / cellSize)));
+	int cellCount = columns * rows;
+
+	occupancy.assign(static_cast<unsigned long>((cellCount + 63) / 64), 0);
+	cellStart.assign(static_cast<unsigned long>(cellCount + 1), 0);
+
+	// Cell range covered by the inflated AABB of each obstacle, padded like the line segment traversal
+	std::vector<int> bounds;
+	bounds.reserve(obstacles.size() * 4);
+	for(const Rectangle& obstacle : obstacles) {
+		bounds.push_back(GridTraversal::toCell(obstacle.getMinXInflated() - EPS, cellSize, columns));
+		bounds.push_back(GridTraversal::toCell(obstacle.getMaxXInflated() + EPS, cellSize, columns));
+		bounds.push_back(GridTraversal::toCell(obstacle.getMinYInflated() - EPS, cellSize, rows));
+		bounds.push_back(GridTraversal::toCell(obstacle.getMaxYInflated() + EPS, cellSize, rows));
+	}
+
+	// Count obstacles per cell, then fill the compressed row storage
+	for(unsigned long i = 0; i < obstacles.size(); i++) {
+		for(int row = bounds[i * 4 + 2]; row <= bounds[i * 4 + 3]; row++) {
+			for(int column = bounds[i * 4]; column <= bounds[i * 4 + 1]; column++) {
+				cellStart[row * columns + column + 1]++;
+			}
+		}
+	}
+
+	for(int cell = 0; cell < cellCount; cell++) {
+		if(cellStart[cell + 1] > 0) {
+			occupancy[cell / 64] |= uint64_t(1) << (cell % 64);
+		}
+		cellStart[cell + 1] += cellStart[cell];
+	}
+
+	// Sort obstacle indices by cell, then store the obstacles of each cell consecutively
+	std::vector<int> sortedObstacles(static_cast<unsigned long>(cellStart[cellCount]));
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for(unsigned long i = 0; i < obstacles.size(); i++) {
+		for(int row = bounds[i * 4 + 2]; row <= bounds[i * 4 + 3]; row++) {
+			for(int column = bounds[i * 4]; column <= bounds[i * 4 + 1]; column++) {
+				sortedObstacles[fill[row * columns + column]++] = static_cast<int>(i);
+			}
+		}
+	}
+	
+	for(int i : sortedObstacles) {
+		cellObstacles.add(obstacles[i]);
+	}
+}
+
+bool StaticObstacleGrid::isOccupied(int cell) const {
+	return (occupancy[cell / 64] >> (cell % 64)) & 1u;
+}
+
+bool StaticObstacleGrid::isInsideAnyObstacle(const Point& p) const {
+	if(cellStart.empty()) {
+		return false;
+	}
+
+	int cell = GridTraversal::toCell(p.y, cellSize, rows) * columns + GridTraversal::toCell(p.x, cellSize, columns);
+	if(!isOccupied(cell)) {
+		return false;
+	}
+
+	return cellObstacles.findRectangleContainingPoint(p, cellStart[cell], cellStart[cell + 1]) != -1;
+}
+
+bool StaticObstacleGrid::isLineOfSightFree(const Point& lStart, const Point& lEnd) const {
+	if(cellStart.empty()) {
+		return true;
+	}
+
+	bool isFree = true;
+
+	GridTraversal::forEachRowSpanOnLineSegment(lStart, lEnd, cellSize, columns, rows, [&](int row, int spanStart, int spanEnd) {
+		for(int cell = row * columns + spanStart; cell <= row * columns + spanEnd; cell++) {
+			if(isOccupied(cell) && cellObstacles.findIntersectionWithLineSegment(lStart, lEnd, cellStart[cell], cellStart[cell + 1]) != -1) {
+				isFree = false;
+				return false;
+			}
+		}
+
+		return true;
+	});
+
+	return isFree;
+}
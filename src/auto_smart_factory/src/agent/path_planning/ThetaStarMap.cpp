@@ -1,4 +1,7 @@
 
+#include <queue>
+#include <limits>
+#include <functional>
 #include <include/agent/path_planning/ThetaStarMap.h>
 
 #include "agent/path_planning/ThetaStarMap.h"
@@ -8,54 +11,184 @@
 
 ThetaStarMap::ThetaStarMap(Map* map, float resolution) :
 	map(map),
-	resolution(resolution)
+	resolution(resolution),
+	origin(map->getMargin(), map->getMargin()),
+	staticLineOfSightCache(std::make_shared<StaticLineOfSightCache>())
 {
-	Point start(map->getMargin(), map->getMargin());
 	Point end(map->getWidth() - map->getMargin(), map->getHeight() - map->getMargin());
+	columns = std::max(0, static_cast<int>(std::floor((end.x - origin.x) / resolution + EPS)) + 1);
+	rows = std::max(0, static_cast<int>(std::floor((end.y - origin.y) / resolution + EPS)) + 1);
+	grid.assign(static_cast<unsigned long>(columns * rows), nullptr);
 
 	// Generate
-	Point current = start;
-	while(current.x <= end.x) {
-		current.y = start.y;
-		while(current.y <= end.y) {
+	for(int iy = 0; iy < rows; iy++) {
+		for(int ix = 0; ix < columns; ix++) {
+			Point current = getGridPosition(ix, iy);
 			if(!map->isInsideAnyStaticInflatedObstacle(current)) {
-				nodes.emplace(std::pair<Point, GridNode*>(current, new GridNode(current)));
+				grid[iy * columns + ix] = new GridNode(current, iy * columns + ix);
 			}
-			current.y += resolution;
 		}
-		current.x += resolution;
 	}
 
 	// Link
-	for(const auto& element : nodes) {
-		linkToNode(element.second, element.second->pos + Point(- resolution, 0));
-		linkToNode(element.second, element.second->pos + Point(- resolution, - resolution));
-		linkToNode(element.second, element.second->pos + Point(- resolution, + resolution));
-		linkToNode(element.second, element.second->pos + Point(0, - resolution));
-		linkToNode(element.second, element.second->pos + Point(0, + resolution));
-		linkToNode(element.second, element.second->pos + Point(+ resolution, 0));
-		linkToNode(element.second, element.second->pos + Point(+ resolution, - resolution));
-		linkToNode(element.second, element.second->pos + Point(+ resolution, + resolution));
+	for(int iy = 0; iy < rows; iy++) {
+		for(int ix = 0; ix < columns; ix++) {
+			GridNode* node = grid[iy * columns + ix];
+			if(node == nullptr) {
+				continue;
+			}
+			
+			linkToNode(node, ix - 1, iy);
+			linkToNode(node, ix - 1, iy - 1);
+			linkToNode(node, ix - 1, iy + 1);
+			linkToNode(node, ix, iy - 1);
+			linkToNode(node, ix, iy + 1);
+			linkToNode(node, ix + 1, iy);
+			linkToNode(node, ix + 1, iy - 1);
+			linkToNode(node, ix + 1, iy + 1);
+		}
+	}
+}
+
+ThetaStarMap::ThetaStarMap(Map* map, std::shared_ptr<const ThetaStarMapArtifact> artifact) :
+	map(map),
+	resolution(artifact->getResolution()),
+	origin(artifact->getOrigin()),
+	columns(artifact->getColumns()),
+	rows(artifact->getRows()),
+	staticLineOfSightCache(std::make_shared<StaticLineOfSightCache>()),
+	artifact(artifact)
+{
+	// Node ids below columns * rows are grid indices, the remaining ids belong to additional nodes
+	std::vector<GridNode*> nodes(static_cast<unsigned long>(artifact->getNodeCount()), nullptr);
+	for(int id = 0; id < artifact->getNodeCount(); id++) {
+		if(artifact->hasNode(id)) {
+			nodes[id] = new GridNode(artifact->getNodePosition(id), id);
+		}
+	}
+
+	for(GridNode* node : nodes) {
+		if(node == nullptr) {
+			continue;
+		}
+		
+		int linkCount;
+		const int32_t* links = artifact->getLinks(node->id, linkCount);
+		node->neighbours.reserve(static_cast<unsigned long>(linkCount));
+		for(int i = 0; i < linkCount; i++) {
+			node->neighbours.push_back(nodes[links[i]]);
+		}
+	}
+
+	grid.assign(nodes.begin(), nodes.begin() + columns * rows);
+	for(auto iter = nodes.begin() + columns * rows; iter != nodes.end(); iter++) {
+		int cx, cy;
+		getCellOf((*iter)->pos, cx, cy);
+		additionalNodes.push_back(*iter);
+		additionalNodesPerCell[cy * columns + cx].push_back(*iter);
+	}
+
+	// The distance fields point into the mapped file, which stays mapped as long as any field is used
+	for(int i = 0; i < artifact->getDistanceFieldCount(); i++) {
+		distanceFields[artifact->getDistanceFieldTarget(i)] = std::shared_ptr<const float>(artifact, artifact->getDistanceField(i));
 	}
 }
 
-void ThetaStarMap::linkToNode(GridNode* node, Point targetPos) {
-	auto iter = nodes.find(targetPos);
-	if(iter != nodes.end() && map->isStaticLineOfSightFree(node->pos, targetPos)) {
-		node->neighbours.push_back(iter->second);
+ThetaStarMap ThetaStarMap::createView(const ThetaStarMap& other, Map* map) {
+	ThetaStarMap view;
+	view.map = map;
+	view.grid = other.grid;
+	view.additionalNodes = other.additionalNodes;
+	view.additionalNodesPerCell = other.additionalNodesPerCell;
+	view.resolution = other.resolution;
+	view.origin = other.origin;
+	view.columns = other.columns;
+	view.rows = other.rows;
+	view.staticLineOfSightCache = other.staticLineOfSightCache;
+	view.artifact = other.artifact;
+	view.distanceFields = other.distanceFields;
+	view.clusterGraph = other.clusterGraph;
+	
+	return view;
+}
+
+void ThetaStarMap::linkToNode(GridNode* node, int ix, int iy) {
+	GridNode* target = getGridNode(ix, iy);
+	if(target != nullptr && isStaticLineOfSightFree(node, target)) {
+		node->neighbours.push_back(target);
 	}
 }
 
-const GridNode* ThetaStarMap::getNodeClosestTo(const Point& pos) const {
-	double shortestDistance = std::numeric_limits<float>::max();
-	const GridNode* nearestNode = nullptr;
+GridNode* ThetaStarMap::getGridNode(int ix, int iy) const {
+	if(ix < 0 || ix >= columns || iy < 0 || iy >= rows) {
+		return nullptr;
+	}
+	
+	return grid[iy * columns + ix];
+}
+
+void ThetaStarMap::getCellOf(const Point& pos, int& ix, int& iy) const {
+	ix = static_cast<int>(std::lround((pos.x - origin.x) / resolution));
+	iy = static_cast<int>(std::lround((pos.y - origin.y) / resolution));
 	
-	for(const auto& element : nodes) {
-		double distance = Math::getDistanceSquared(element.first, pos);
+	ix = std::max(0, std::min(columns - 1, ix));
+	iy = std::max(0, std::min(rows - 1, iy));
+}
+
+Point ThetaStarMap::getGridPosition(int ix, int iy) const {
+	return Point(origin.x + ix * static_cast<double>(resolution), origin.y + iy * static_cast<double>(resolution));
+}
 
+void ThetaStarMap::findClosestNodeInCell(const Point& pos, int ix, int iy, const GridNode*& nearestNode, double& shortestDistance) const {
+	if(ix < 0 || ix >= columns || iy < 0 || iy >= rows) {
+		return;
+	}
+	
+	const GridNode* gridNode = grid[iy * columns + ix];
+	if(gridNode != nullptr) {
+		double distance = Math::getDistanceSquared(gridNode->pos, pos);
 		if(distance < shortestDistance) {
 			shortestDistance = distance;
-			nearestNode = element.second;
+			nearestNode = gridNode;
+		}
+	}
+	
+	auto iter = additionalNodesPerCell.find(iy * columns + ix);
+	if(iter != additionalNodesPerCell.end()) {
+		for(const GridNode* additionalNode : iter->second) {
+			double distance = Math::getDistanceSquared(additionalNode->pos, pos);
+			if(distance < shortestDistance) {
+				shortestDistance = distance;
+				nearestNode = additionalNode;
+			}
+		}
+	}
+}
+
+const GridNode* ThetaStarMap::getNodeClosestTo(const Point& pos) const {
+	double shortestDistance = std::numeric_limits<float>::max();
+	const GridNode* nearestNode = nullptr;
+	
+	if(!grid.empty()) {
+		int cx, cy;
+		getCellOf(pos, cx, cy);
+		
+		// Search rings of growing size around the cell of pos. Nodes in ring r are at least (r - 1) * resolution away,
+		// because additional nodes may be up to one cell away from the center of the cell they are sorted into
+		int maxRing = std::max(columns, rows);
+		for(int ring = 0; ring <= maxRing; ring++) {
+			for(int iy = cy - ring; iy <= cy + ring; iy++) {
+				// Only visit the border of the ring
+				int step = (ring == 0 || iy == cy - ring || iy == cy + ring) ? 1 : 2 * ring;
+				for(int ix = cx - ring; ix <= cx + ring; ix += step) {
+					findClosestNodeInCell(pos, ix, iy, nearestNode, shortestDistance);
+				}
+			}
+			
+			double nextRingDistance = (ring - 1) * resolution;
+			if(nearestNode != nullptr && ring >= 1 && shortestDistance <= nextRingDistance * nextRingDistance) {
+				break;
+			}
 		}
 	}
 
@@ -66,48 +199,207 @@ const GridNode* ThetaStarMap::getNodeClosestTo(const Point& pos) const {
 	return nearestNode;
 }
 
-TimedLineOfSightResult ThetaStarMap::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const {
+TimedLineOfSightResult ThetaStarMap::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const {
 	return map->whenIsTimedLineOfSightFree(pos1, startTime, pos2, endTime, smallerReservations);
 }
 
-bool ThetaStarMap::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const {
+TimedLineOfSightResult ThetaStarMap::whenIsTimedLineOfSightFree(const GridNode* node1, double startTime, const GridNode* node2, double endTime, const std::unordered_set<ReservationId>& smallerReservations) const {
+	if(!isStaticLineOfSightFree(node1, node2)) {
+		TimedLineOfSightResult result;
+		result.blockedByStatic = true;
+		return result;
+	}
+	
+	return map->whenIsTimedLineOfSightFreeOfReservations(node1->pos, startTime, node2->pos, endTime, smallerReservations);
+}
+
+bool ThetaStarMap::isStaticLineOfSightFree(const GridNode* node1, const GridNode* node2) const {
+	uint64_t lowId = static_cast<uint64_t>(std::min(node1->id, node2->id));
+	uint64_t highId = static_cast<uint64_t>(std::max(node1->id, node2->id));
+	uint64_t key = (lowId << 32) | highId;
+	
+	bool isFree;
+	if(staticLineOfSightCache->find(key, isFree)) {
+		return isFree;
+	}
+	
+	if(artifact == nullptr || !artifact->findStaticLineOfSight(key, isFree)) {
+		isFree = map->isStaticLineOfSightFree(node1->pos, node2->pos);
+	}
+	staticLineOfSightCache->insert(key, isFree);
+	
+	return isFree;
+}
+
+bool ThetaStarMap::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::unordered_set<ReservationId>& smallerReservations) const {
 	return map->isTimedConnectionFree(pos1, pos2, startTime, waitingTime, drivingTime, smallerReservations);
 }
 
+void ThetaStarMap::collectTimedEdge(const GridNode* node1, const GridNode* node2, double earliestTime, const std::unordered_set<ReservationId>& smallerReservations, TimedEdge& edge) const {
+	edge.reset(node1->pos, node2->pos, isStaticLineOfSightFree(node1, node2));
+	
+	if(edge.isStaticLineOfSightFree()) {
+		map->collectTimedEdgeReservations(node1->pos, node2->pos, earliestTime, smallerReservations, edge);
+	}
+}
+
+std::vector<SafeInterval> ThetaStarMap::getSafeIntervals(const GridNode* node, const std::unordered_set<ReservationId>& smallerReservations) const {
+	return map->getSafeIntervals(node->pos, smallerReservations);
+}
+
 bool ThetaStarMap::addAdditionalNode(Point pos) {
-	if(!map->isPointInMap(pos) || map->isInsideAnyStaticInflatedObstacle(pos)) {
+	if(grid.empty() || !map->isPointInMap(pos) || map->isInsideAnyStaticInflatedObstacle(pos)) {
 		return false;
 	}
+	
+	int cx, cy;
+	getCellOf(pos, cx, cy);
+	
+	// A node at this exact position would be sorted into the same cell
+	const GridNode* existingNode = nullptr;
+	double existingDistance = std::numeric_limits<float>::max();
+	findClosestNodeInCell(pos, cx, cy, existingNode, existingDistance);
+	if(existingNode != nullptr && existingNode->pos == pos) {
+		return true;
+	}
 
 	// Add new node
-	GridNode* newGridNode = new GridNode(pos);
-	auto emplaceResult = nodes.emplace(std::pair<Point, GridNode*>(pos, newGridNode));
-
-	// If node was newly added
-	if(emplaceResult.second) {
-		double maxDistance = resolution * resolution;
+	GridNode* newGridNode = new GridNode(pos, static_cast<int>(grid.size() + additionalNodes.size()));
+	double maxDistance = resolution * resolution;
+
+	// Nodes within one resolution are at most two cells away
+	for(int iy = cy - 2; iy <= cy + 2; iy++) {
+		for(int ix = cx - 2; ix <= cx + 2; ix++) {
+			std::vector<GridNode*> candidates;
+			GridNode* gridNode = getGridNode(ix, iy);
+			if(gridNode != nullptr) {
+				candidates.push_back(gridNode);
+			}
+			
+			auto iter = additionalNodesPerCell.find(iy * columns + ix);
+			if(ix >= 0 && ix < columns && iy >= 0 && iy < rows && iter != additionalNodesPerCell.end()) {
+				candidates.insert(candidates.end(), iter->second.begin(), iter->second.end());
+			}
+			
+			for(GridNode* neighbour : candidates) {
+				double distance = Math::getDistanceSquared(neighbour->pos, pos);
+
+				if(distance <= maxDistance && isStaticLineOfSightFree(newGridNode, neighbour)) {
+					newGridNode->neighbours.push_back(neighbour);
+					neighbour->neighbours.push_back(newGridNode);
+				}
+			}
+		}
+	}
+	
+	additionalNodes.push_back(newGridNode);
+	additionalNodesPerCell[cy * columns + cx].push_back(newGridNode);
+	
+	return true;
+}
 
-		for(std::pair<Point, GridNode*> neighbour : nodes) {
-			double distance = Math::getDistanceSquared(neighbour.first, pos);
+std::vector<const GridNode*> ThetaStarMap::getAllNodes() const {
+	std::vector<const GridNode*> allNodes;
+	allNodes.reserve(grid.size() + additionalNodes.size());
+	
+	for(const GridNode* node : grid) {
+		if(node != nullptr) {
+			allNodes.push_back(node);
+		}
+	}
+	allNodes.insert(allNodes.end(), additionalNodes.begin(), additionalNodes.end());
+	
+	return allNodes;
+}
 
-			if(distance <= maxDistance && map->isStaticLineOfSightFree(pos, neighbour.first))  {
-				newGridNode->neighbours.push_back(neighbour.second);
-				neighbour.second->neighbours.push_back(newGridNode);
+void ThetaStarMap::addDistanceField(const Point& target) {
+	const GridNode* targetNode = getNodeClosestTo(target);
+	if(targetNode == nullptr || distanceFields.count(targetNode->id) > 0) {
+		return;
+	}
+	
+	// Links and line of sight are symmetric, so a forward search from the target yields the distances towards it.
+	// Like theta*, a neighbour is connected to the parent of the current node if there is line of sight, so distances are any-angle
+	std::vector<float> distances(static_cast<unsigned long>(getNodeCount()), std::numeric_limits<float>::infinity());
+	std::vector<const GridNode*> parents(static_cast<unsigned long>(getNodeCount()), nullptr);
+	typedef std::pair<float, const GridNode*> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	
+	distances[targetNode->id] = 0;
+	queue.emplace(0.f, targetNode);
+	
+	while(!queue.empty()) {
+		QueueEntry current = queue.top();
+		queue.pop();
+		
+		if(current.first > distances[current.second->id]) {
+			continue;
+		}
+		
+		const GridNode* parent = parents[current.second->id];
+		for(const GridNode* neighbour : current.second->neighbours) {
+			const GridNode* newParent = current.second;
+			if(parent != nullptr && map->isStaticLineOfSightFree(parent->pos, neighbour->pos)) {
+				newParent = parent;
+			}
+			
+			float distance = distances[newParent->id] + static_cast<float>(Math::getDistance(newParent->pos, neighbour->pos));
+			if(distance < distances[neighbour->id]) {
+				distances[neighbour->id] = distance;
+				parents[neighbour->id] = newParent;
+				queue.emplace(distance, neighbour);
 			}
 		}
-	} else {
-		delete newGridNode;
 	}
 	
-	return true;
+	auto field = std::make_shared<const std::vector<float>>(std::move(distances));
+	distanceFields[targetNode->id] = std::shared_ptr<const float>(field, field->data());
+}
+
+const float* ThetaStarMap::getDistanceField(const GridNode* target) const {
+	auto field = distanceFields.find(target->id);
+	if(field == distanceFields.end()) {
+		return nullptr;
+	}
+	
+	return field->second.get();
+}
+
+bool ThetaStarMap::writeArtifact(const std::string& path, uint64_t configHash) const {
+	std::vector<const GridNode*> nodes(grid.begin(), grid.end());
+	nodes.insert(nodes.end(), additionalNodes.begin(), additionalNodes.end());
+	
+	std::unordered_map<int, const float*> fields;
+	for(const auto& field : distanceFields) {
+		fields[field.first] = field.second.get();
+	}
+	
+	return ThetaStarMapArtifact::write(path, configHash, resolution, origin, columns, rows, nodes, staticLineOfSightCache->getEntries(), fields);
+}
+
+void ThetaStarMap::buildClusterGraph(int clusterSize) {
+	clusterGraph = std::make_shared<const ClusterGraph>(getAllNodes(), origin, clusterSize * resolution);
+	ROS_INFO("[Agent %d] Hierarchical planning with %d clusters and %d entrances", getOwnerId(), clusterGraph->getClusterCount(), clusterGraph->getEntranceCount());
+}
+
+const ClusterGraph* ThetaStarMap::getClusterGraph() const {
+	return clusterGraph.get();
+}
+
+int ThetaStarMap::getNodeCount() const {
+	return static_cast<int>(grid.size() + additionalNodes.size());
+}
+
+ThetaStarSearchArena* ThetaStarMap::getSearchArena() {
+	return &searchArena;
 }
 
 int ThetaStarMap::getOwnerId() const {
 	return map->getOwnerId();
 }
 
-std::vector<Rectangle> ThetaStarMap::getRectanglesOnStartingPoint(Point p) const {
-	return map->getRectanglesOnStartingPoint(p);
+std::unordered_set<ReservationId> ThetaStarMap::getReservationIdsOnStartingPoint(Point p) const {
+	return map->getReservationIdsOnStartingPoint(p);
 }
 
 visualization_msgs::Marker ThetaStarMap::getGridVisualization() {
@@ -134,9 +426,8 @@ visualization_msgs::Marker ThetaStarMap::getGridVisualization() {
 	p.z = 0.f;
 
 	// Nodes
-	int i = 0;
-	for(const auto& node : nodes) {
-		const Point* point = &node.first;
+	for(const GridNode* node : getAllNodes()) {
+		const Point* point = &node->pos;
 
 		p.x = point->x;
 		p.y = point->y;
@@ -171,11 +462,10 @@ visualization_msgs::Marker ThetaStarMap::getLinkVisualization() {
 	p.z = 0.f;
 
 	// Nodes
-	int i = 0;
-	for(const auto& node : nodes) {
-		const Point* start = &node.first;
+	for(const GridNode* node : getAllNodes()) {
+		const Point* start = &node->pos;
 
-		for(const auto& neighbour : node.second->neighbours) {
+		for(const auto& neighbour : node->neighbours) {
 			const Point* end = &neighbour->pos;
 
 			p.x = start->x;
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "agent/path_planning/ThetaStarMapArtifact.h"
+
+#include "ros/ros.h"
+#include "Math.h"
+
+namespace {
+	const char artifactMagic[8] = {'T', 'S', 'M', 'A', 'P', 'A', 'R', 'T'};
+	const uint32_t byteOrderMark = 0x01020304;
+
+	uint64_t alignSection(uint64_t offset) {
+		return (offset + 7) & ~static_cast<uint64_t>(7);
+	}
+
+	// 64 bit FNV-1a
+	class ConfigHash {
+	public:
+		void add(const void* bytes, size_t count) {
+			auto data = static_cast<const unsigned char*>(bytes);
+			for(size_t i = 0; i < count; i++) {
+				hash = (hash ^ data[i]) * 1099511628211ull;
+			}
+		}
+
+		void add(double value) {
+			add(&value, sizeof(value));
+		}
+
+		void add(uint64_t value) {
+			add(&value, sizeof(value));
+		}
+
+		uint64_t get() const {
+			return hash;
+		}
+
+	private:
+		uint64_t hash = 14695981039346656037ull;
+	};
+
+	bool writeSection(FILE* file, uint64_t& position, uint64_t offset, const void* bytes, uint64_t size) {
+		static const char padding[8] = {};
+		if(offset > position && fwrite(padding, 1, offset - position, file) != offset - position) {
+			return false;
+		}
+		if(size > 0 && fwrite(bytes, 1, size, file) != size) {
+			return false;
+		}
+
+		position = offset + size;
+		return true;
+	}
+}
+
+std::shared_ptr<const ThetaStarMapArtifact> ThetaStarMapArtifact::load(const std::string& path, uint64_t configHash) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return nullptr;
+	}
+
+	struct stat fileStat{};
+	if(fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(Header))) {
+		ROS_WARN("Theta* map artifact %s is too small", path.c_str());
+		close(fd);
+		return nullptr;
+	}
+
+	auto size = static_cast<size_t>(fileStat.st_size);
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		ROS_WARN("Theta* map artifact %s could not be mapped", path.c_str());
+		return nullptr;
+	}
+
+	std::shared_ptr<ThetaStarMapArtifact> artifact(new ThetaStarMapArtifact(data, size));
+	if(!artifact->validate(configHash)) {
+		ROS_WARN("Theta* map artifact %s is invalid or was built for another configuration", path.c_str());
+		return nullptr;
+	}
+
+	return artifact;
+}
+
+bool ThetaStarMapArtifact::write(const std::string& path, uint64_t configHash, float resolution, const Point& origin, int columns, int rows,
+                                 const std::vector<const GridNode*>& nodes, const std::unordered_map<uint64_t, bool>& lineOfSight,
+                                 const std::unordered_map<int, const float*>& distanceFields) {
+	auto nodeCount = nodes.size();
+
+	// Nodes and links in compressed row storage, keeping the neighbour order
+	std::vector<uint8_t> flags(nodeCount, 0);
+	std::vector<double> positions(2 * nodeCount, 0);
+	std::vector<uint64_t> linkStarts(nodeCount + 1, 0);
+	std::vector<int32_t> links;
+	for(unsigned long id = 0; id < nodeCount; id++) {
+		linkStarts[id] = links.size();
+		const GridNode* node = nodes[id];
+		if(node == nullptr) {
+			continue;
+		}
+
+		flags[id] = 1;
+		positions[2 * id] = node->pos.x;
+		positions[2 * id + 1] = node->pos.y;
+		for(const GridNode* neighbour : node->neighbours) {
+			links.push_back(neighbour->id);
+		}
+	}
+	linkStarts[nodeCount] = links.size();
+
+	// Line of sight results sorted by key for binary search
+	std::vector<std::pair<uint64_t, bool>> sortedLineOfSight(lineOfSight.begin(), lineOfSight.end());
+	std::sort(sortedLineOfSight.begin(), sortedLineOfSight.end());
+	std::vector<uint64_t> lineOfSightKeys;
+	std::vector<uint8_t> lineOfSightValues;
+	lineOfSightKeys.reserve(sortedLineOfSight.size());
+	lineOfSightValues.reserve(sortedLineOfSight.size());
+	for(const auto& entry : sortedLineOfSight) {
+		lineOfSightKeys.push_back(entry.first);
+		lineOfSightValues.push_back(static_cast<uint8_t>(entry.second ? 1 : 0));
+	}
+
+	// Distance fields sorted by target, so equal maps give equal files
+	std::vector<int32_t> targets;
+	for(const auto& field : distanceFields) {
+		targets.push_back(field.first);
+	}
+	std::sort(targets.begin(), targets.end());
+
+	Header header{};
+	std::memcpy(header.magic, artifactMagic, sizeof(artifactMagic));
+	header.version = version;
+	header.byteOrderMark = byteOrderMark;
+	header.configHash = configHash;
+	header.originX = origin.x;
+	header.originY = origin.y;
+	header.resolution = resolution;
+	header.columns = columns;
+	header.rows = rows;
+	header.nodeCount = static_cast<int32_t>(nodeCount);
+	header.linkCount = links.size();
+	header.lineOfSightCount = lineOfSightKeys.size();
+	header.distanceFieldCount = targets.size();
+
+	uint64_t sizes[SECTION_COUNT] = {
+		flags.size(),
+		positions.size() * sizeof(double),
+		linkStarts.size() * sizeof(uint64_t),
+		links.size() * sizeof(int32_t),
+		lineOfSightKeys.size() * sizeof(uint64_t),
+		lineOfSightValues.size(),
+		targets.size() * sizeof(int32_t),
+		targets.size() * nodeCount * sizeof(float)
+	};
+	uint64_t offset = alignSection(sizeof(Header));
+	for(int section = 0; section < SECTION_COUNT; section++) {
+		header.sections[section].offset = offset;
+		header.sections[section].size = sizes[section];
+		offset = alignSection(offset + sizes[section]);
+	}
+	header.fileSize = offset;
+
+	// Write to a unique temporary file next to the target, several agents may build the same artifact at once
+	std::vector<char> temporaryPath(path.begin(), path.end());
+	const std::string suffix = ".XXXXXX";
+	temporaryPath.insert(temporaryPath.end(), suffix.begin(), suffix.end());
+	temporaryPath.push_back('\0');
+
+	int fd = mkstemp(temporaryPath.data());
+	if(fd < 0) {
+		ROS_WARN("Theta* map artifact %s could not be created", path.c_str());
+		return false;
+	}
+	fchmod(fd, 0644);
+
+	FILE* file = fdopen(fd, "wb");
+	if(file == nullptr) {
+		close(fd);
+		unlink(temporaryPath.data());
+		ROS_WARN("Theta* map artifact %s could not be created", path.c_str());
+		return false;
+	}
+
+	uint64_t position = 0;
+	bool success = writeSection(file, position, 0, &header, sizeof(Header));
+	success = success && writeSection(file, position, header.sections[NODE_FLAGS].offset, flags.data(), sizes[NODE_FLAGS]);
+	success = success && writeSection(file, position, header.sections[NODE_POSITIONS].offset, positions.data(), sizes[NODE_POSITIONS]);
+	success = success && writeSection(file, position, header.sections[LINK_STARTS].offset, linkStarts.data(), sizes[LINK_STARTS]);
+	success = success && writeSection(file, position, header.sections[LINKS].offset, links.data(), sizes[LINKS]);
+	success = success && writeSection(file, position, header.sections[LINE_OF_SIGHT_KEYS].offset, lineOfSightKeys.data(), sizes[LINE_OF_SIGHT_KEYS]);
+	success = success && writeSection(file, position, header.sections[LINE_OF_SIGHT_VALUES].offset, lineOfSightValues.data(), sizes[LINE_OF_SIGHT_VALUES]);
+	success = success && writeSection(file, position, header.sections[DISTANCE_FIELD_TARGETS].offset, targets.data(), sizes[DISTANCE_FIELD_TARGETS]);
+
+	uint64_t fieldOffset = header.sections[DISTANCE_FIELDS].offset;
+	for(int32_t target : targets) {
+		success = success && writeSection(file, position, fieldOffset, distanceFields.at(target), nodeCount * sizeof(float));
+		fieldOffset += nodeCount * sizeof(float);
+	}
+	success = success && writeSection(file, position, header.fileSize, nullptr, 0);
+
+	success = fclose(file) == 0 && success;
+	if(!success || rename(temporaryPath.data(), path.c_str()) != 0) {
+		unlink(temporaryPath.data());
+		ROS_WARN("Theta* map artifact %s could not be written", path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t ThetaStarMapArtifact::computeConfigHash(const auto_smart_factory::WarehouseConfiguration& warehouseConfig, const std::vector<Rectangle>& obstacles) {
+	ConfigHash hash;
+	hash.add(static_cast<uint64_t>(version));
+	hash.add(static_cast<double>(ROBOT_RADIUS));
+	hash.add(static_cast<double>(APPROACH_DISTANCE));
+	hash.add(static_cast<double>(DISTANCE_WHEN_APPROACHED));
+
+	const auto& mapConfig = warehouseConfig.map_configuration;
+	hash.add(static_cast<double>(mapConfig.width));
+	hash.add(static_cast<double>(mapConfig.height));
+	hash.add(static_cast<double>(mapConfig.margin));
+	hash.add(static_cast<double>(mapConfig.resolutionThetaStar));
+
+	hash.add(static_cast<uint64_t>(obstacles.size()));
+	for(const Rectangle& obstacle : obstacles) {
+		hash.add(obstacle.getPosition().x);
+		hash.add(obstacle.getPosition().y);
+		hash.add(obstacle.getSize().x);
+		hash.add(obstacle.getSize().y);
+		hash.add(static_cast<double>(obstacle.getRotation()));
+	}
+
+	hash.add(static_cast<uint64_t>(warehouseConfig.trays.size()));
+	for(const auto& tray : warehouseConfig.trays) {
+		hash.add(static_cast<double>(tray.x));
+		hash.add(static_cast<double>(tray.y));
+		hash.add(static_cast<double>(tray.orientation));
+	}
+
+	hash.add(static_cast<uint64_t>(warehouseConfig.idle_positions.size()));
+	for(const auto& idlePosition : warehouseConfig.idle_positions) {
+		hash.add(static_cast<double>(idlePosition.pose.x));
+		hash.add(static_cast<double>(idlePosition.pose.y));
+	}
+
+	return hash.get();
+}
+
+ThetaStarMapArtifact::ThetaStarMapArtifact(void* data, size_t size) :
+	data(data),
+	size(size),
+	header(static_cast<const Header*>(data)),
+	nodeFlags(nullptr),
+	nodePositions(nullptr),
+	linkStarts(nullptr),
+	links(nullptr),
+	lineOfSightKeys(nullptr),
+	lineOfSightValues(nullptr),
+	distanceFieldTargets(nullptr),
+	distanceFields(nullptr)
+{
+}
+
+ThetaStarMapArtifact::~ThetaStarMapArtifact() {
+	munmap(data, size);
+}
+
+bool ThetaStarMapArtifact::validate(uint64_t configHash) {
+	if(std::memcmp(header->magic, artifactMagic, sizeof(artifactMagic)) != 0 || header->version != version || header->byteOrderMark != byteOrderMark ||
+	   header->configHash != configHash || header->fileSize != size) {
+		return false;
+	}
+
+	if(header->columns < 0 || header->rows < 0 || header->nodeCount < 0 ||
+	   static_cast<int64_t>(header->columns) * header->rows > header->nodeCount) {
+		return false;
+	}
+
+	auto nodeCount = static_cast<uint64_t>(header->nodeCount);
+	uint64_t expectedSizes[SECTION_COUNT] = {
+		nodeCount,
+		2 * nodeCount * sizeof(double),
+		(nodeCount + 1) * sizeof(uint64_t),
+		header->linkCount * sizeof(int32_t),
+		header->lineOfSightCount * sizeof(uint64_t),
+		header->lineOfSightCount,
+		header->distanceFieldCount * sizeof(int32_t),
+		header->distanceFieldCount * nodeCount * sizeof(float)
+	};
+	for(int section = 0; section < SECTION_COUNT; section++) {
+		const SectionRange& range = header->sections[section];
+		if(range.offset % 8 != 0 || range.size != expectedSizes[section] || range.offset > size || range.size > size - range.offset) {
+			return false;
+		}
+	}
+
+	auto bytes = static_cast<const char*>(data);
+	nodeFlags = reinterpret_cast<const uint8_t*>(bytes + header->sections[NODE_FLAGS].offset);
+	nodePositions = reinterpret_cast<const double*>(bytes + header->sections[NODE_POSITIONS].offset);
+	linkStarts = reinterpret_cast<const uint64_t*>(bytes + header->sections[LINK_STARTS].offset);
+	links = reinterpret_cast<const int32_t*>(bytes + header->sections[LINKS].offset);
+	lineOfSightKeys = reinterpret_cast<const uint64_t*>(bytes + header->sections[LINE_OF_SIGHT_KEYS].offset);
+	lineOfSightValues = reinterpret_cast<const uint8_t*>(bytes + header->sections[LINE_OF_SIGHT_VALUES].offset);
+	distanceFieldTargets = reinterpret_cast<const int32_t*>(bytes + header->sections[DISTANCE_FIELD_TARGETS].offset);
+	distanceFields = reinterpret_cast<const float*>(bytes + header->sections[DISTANCE_FIELDS].offset);
+
+	// Links must only refer to existing nodes, so nodes can be created from the file without further checks
+	if(linkStarts[0] != 0 || linkStarts[nodeCount] != header->linkCount) {
+		return false;
+	}
+	// Only grid positions may be blocked, ids behind the grid belong to additional nodes which always exist
+	auto gridNodeCount = static_cast<uint64_t>(header->columns) * static_cast<uint64_t>(header->rows);
+	for(uint64_t id = 0; id < nodeCount; id++) {
+		if(linkStarts[id] > linkStarts[id + 1] || (nodeFlags[id] == 0 && (linkStarts[id] != linkStarts[id + 1] || id >= gridNodeCount))) {
+			return false;
+		}
+	}
+	for(uint64_t link = 0; link < header->linkCount; link++) {
+		if(links[link] < 0 || static_cast<uint64_t>(links[link]) >= nodeCount || nodeFlags[links[link]] == 0) {
+			return false;
+		}
+	}
+	for(uint64_t field = 0; field < header->distanceFieldCount; field++) {
+		if(distanceFieldTargets[field] < 0 || static_cast<uint64_t>(distanceFieldTargets[field]) >= nodeCount || nodeFlags[distanceFieldTargets[field]] == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+float ThetaStarMapArtifact::getResolution() const {
+	return header->resolution;
+}
+
+Point ThetaStarMapArtifact::getOrigin() const {
+	return Point(header->originX, header->originY);
+}
+
+int ThetaStarMapArtifact::getColumns() const {
+	return header->columns;
+}
+
+int ThetaStarMapArtifact::getRows() const {
+	return header->rows;
+}
+
+int ThetaStarMapArtifact::getNodeCount() const {
+	return header->nodeCount;
+}
+
+bool ThetaStarMapArtifact::hasNode(int id) const {
+	return nodeFlags[id] != 0;
+}
+
+Point ThetaStarMapArtifact::getNodePosition(int id) const {
+	return Point(nodePositions[2 * id], nodePositions[2 * id + 1]);
+}
+
+const int32_t* ThetaStarMapArtifact::getLinks(int id, int& count) const {
+	count = static_cast<int>(linkStarts[id + 1] - linkStarts[id]);
+	return links + linkStarts[id];
+}
+
+bool ThetaStarMapArtifact::findStaticLineOfSight(uint64_t key, bool& isFree) const {
+	const uint64_t* end = lineOfSightKeys + header->lineOfSightCount;
+	const uint64_t* iter = std::lower_bound(lineOfSightKeys, end, key);
+	if(iter == end || *iter != key) {
+		return false;
+	}
+
+	isFree = lineOfSightValues[iter - lineOfSightKeys] != 0;
+	return true;
+}
+
+int ThetaStarMapArtifact::getDistanceFieldCount() const {
+	return static_cast<int>(header->distanceFieldCount);
+}
+
+int ThetaStarMapArtifact::getDistanceFieldTarget(int index) const {
+	return distanceFieldTargets[index];
+}
+
+const float* ThetaStarMapArtifact::getDistanceField(int index) const {
+	return distanceFields + static_cast<uint64_t>(index) * header->nodeCount;
+}
@@ -0,0 +1,110 @@
+#include "agent/path_planning/ThetaStarOpenList.h"
+
+void ThetaStarOpenList::clear(int nodeCount) {
+	for(const Entry& entry : heap) {
+		positions[entry.second->node->id] = -1;
+	}
+	heap.clear();
+
+	auto size = static_cast<unsigned long>(nodeCount);
+	if(positions.size() < size) {
+		positions.resize(size, -1);
+	}
+}
+
+void ThetaStarOpenList::push(double priority, ThetaStarGridNodeInformation* information) {
+	if(trace != nullptr) {
+		trace->push_back({information->node->id, priority});
+	}
+
+	int index = positions[information->node->id];
+
+	if(index == -1) {
+		heap.emplace_back(priority, information);
+		index = static_cast<int>(heap.size()) - 1;
+		positions[information->node->id] = index;
+		siftUp(index);
+	} else if(priority < heap[index].first) {
+		heap[index].first = priority;
+		siftUp(index);
+	} else {
+		heap[index].first = priority;
+		siftDown(index);
+	}
+}
+
+ThetaStarGridNodeInformation* ThetaStarOpenList::pop() {
+	if(trace != nullptr) {
+		trace->push_back({-1, 0});
+	}
+
+	ThetaStarGridNodeInformation* top = heap.front().second;
+	positions[top->node->id] = -1;
+
+	Entry last = heap.back();
+	heap.pop_back();
+	if(!heap.empty()) {
+		place(0, last);
+		siftDown(0);
+	}
+
+	return top;
+}
+
+bool ThetaStarOpenList::isEmpty() const {
+	return heap.empty();
+}
+
+int ThetaStarOpenList::getSize() const {
+	return static_cast<int>(heap.size());
+}
+
+void ThetaStarOpenList::setTrace(std::vector<Operation>* trace) {
+	this->trace = trace;
+}
+
+void ThetaStarOpenList::siftUp(int index) {
+	Entry entry = heap[index];
+
+	while(index > 0) {
+		int parent = (index - 1) / 2;
+		if(heap[parent].first <= entry.first) {
+			break;
+		}
+
+		place(index, heap[parent]);
+		index = parent;
+	}
+
+	place(index, entry);
+}
+
+void ThetaStarOpenList::siftDown(int index) {
+	Entry entry = heap[index];
+	auto size = static_cast<int>(heap.size());
+
+	while(true) {
+		int child = 2 * index + 1;
+		if(child >= size) {
+			break;
+		}
+
+		if(child + 1 < size && heap[child + 1].first < heap[child].first) {
+			child++;
+		}
+
+		if(entry.first <= heap[child].first) {
+			break;
+		}
+
+		place(index, heap[child]);
+		index = child;
+	}
+
+	place(index, entry);
+}
+
+void ThetaStarOpenList::place(int index, const Entry& entry) {
+	heap[index] = entry;
+	positions[entry.second->node->id] = index;
+}
@@ -1,4 +1,5 @@
-#include <queue>
+#include <algorithm>
+#include <cmath>
 #include "agent/path_planning/TimedLineOfSightResult.h"
 #include "ros/ros.h"
 #include "Math.h"
@@ -7,10 +8,15 @@
 using namespace UncertaintyDirection;
 
 ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations) :
+	ThetaStarPathPlanner(thetaStarMap, hardwareProfile, start, std::vector<OrientedPoint>{target}, startingTime, targetReservationTime, ignoreStartingReservations)
+{
+}
+
+ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, const std::vector<OrientedPoint>& targets, double startingTime, double targetReservationTime, bool ignoreStartingReservations) :
 	map(thetaStarMap),
+	arena(thetaStarMap->getSearchArena()),
 	hardwareProfile(hardwareProfile),
 	start(OrientedPoint(start.x, start.y, Math::toDeg(start.o))),
-	target(OrientedPoint(target.x, target.y, Math::toDeg(target.o))),
 	startingTime(startingTime),
 	targetReservationTime(targetReservationTime),
 	timing(startingTime, start, hardwareProfile)
@@ -27,26 +33,45 @@ ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHard
 	*/
 
 	startNode = map->getNodeClosestTo(Point(start));
-	targetNode = map->getNodeClosestTo(Point(target));
 	
 	if(startNode == nullptr) {
 		ROS_FATAL("[Agent %d] StartPoint %f/%f is not in theta* map!", map->getOwnerId(), start.x, start.y);
 		isValidPathQuery = false;
 	}
-	if(targetNode == nullptr) {
-		ROS_FATAL("[Agent %d] TargetPoint %f/%f is not in theta* map!", map->getOwnerId(), target.x, target.y);
-		isValidPathQuery = false;
-	}	
+	
+	for(const OrientedPoint& target : targets) {
+		this->targets.emplace_back(target.x, target.y, Math::toDeg(target.o));
+		targetNodes.push_back(map->getNodeClosestTo(Point(target)));
+		
+		if(targetNodes.back() == nullptr) {
+			ROS_FATAL("[Agent %d] TargetPoint %f/%f is not in theta* map!", map->getOwnerId(), target.x, target.y);
+			targetDistanceFields.push_back(nullptr);
+		} else {
+			targetDistanceFields.push_back(map->getDistanceField(targetNodes.back()));
+		}
+	}
+	isTargetReached.assign(targets.size(), false);
+	
+	// Large maps are searched hierarchically, only the clusters of the abstract paths to the targets are expanded
+	clusterGraph = map->getClusterGraph();
+	if(clusterGraph != nullptr && startNode != nullptr) {
+		corridor.assign(static_cast<unsigned long>(clusterGraph->getClusterCount()), false);
+		for(const GridNode* targetNode : targetNodes) {
+			if(targetNode != nullptr) {
+				clusterGraph->addToCorridor(startNode, targetNode, corridor);
+			}
+		}
+	}
 
 	double initialWaitTime = 0;
 	// Use empty vector here
 	smallerReservations.clear();
-	TimedLineOfSightResult initialCheckResult = map->whenIsTimedLineOfSightFree(startNode->pos, startingTime, startNode->pos, startingTime + 1.1f, smallerReservations);
+	TimedLineOfSightResult initialCheckResult = map->whenIsTimedLineOfSightFree(startNode, startingTime, startNode, startingTime + 1.1f, smallerReservations);
 	if(initialCheckResult.blockedByTimed) {
 		initialWaitTime = initialCheckResult.freeAfter - (startingTime + 0.1f);
 
 		if(ignoreStartingReservations) {
-			smallerReservations = map->getRectanglesOnStartingPoint(startNode->pos);
+			smallerReservations = map->getReservationIdsOnStartingPoint(startNode->pos);
 			ROS_WARN("[Agent %d] Initial wait time of %f. Using %d smaller reservations instead!", map->getOwnerId(), initialWaitTime, (int) smallerReservations.size());	
 		} else {
 			//ROS_WARN("[Agent %d] Path would need initial wait time of %f", map->getOwnerId(), initialWaitTime);
@@ -56,39 +81,231 @@ ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHard
 }
 
 Path ThetaStarPathPlanner::findPath() {
+	return findPaths().front();
+}
+
+std::vector<Path> ThetaStarPathPlanner::findPaths() {
+	std::vector<Path> paths(targets.size());
 	if(!isValidPathQuery) {
-		return Path();
+		return paths;
 	}
 	
-	if(start.x == target.x && start.y == target.y) {
-		return Path(startingTime, {Point(start), Point(start)}, {0.0, 0.0}, hardwareProfile, targetReservationTime, start, start, map->getOwnerId());
+	int remainingTargets = prepareTargets(paths);
+	if(remainingTargets > 0) {
+		beginNewSearch();
+		remainingTargets = search(paths, remainingTargets);
+		searchWithoutCorridor(paths, remainingTargets);
 	}
 	
-	GridInformationMap exploredSet;
-	GridInformationPairQueue queue;
+	if(lazyLineOfSight) {
+		ROS_DEBUG("[Agent %d] Lazy theta* saved %d line of sight checks", map->getOwnerId(), savedLineOfSightChecks);
+	}
+	
+	// Paths to targets which were not reached stay invalid
+	return paths;
+}
+
+Path ThetaStarPathPlanner::repairPath(double previousStartingTime) {
+	return repairPaths(previousStartingTime).front();
+}
+
+std::vector<Path> ThetaStarPathPlanner::repairPaths(double previousStartingTime) {
+	std::vector<Path> paths(targets.size());
+	if(!isValidPathQuery) {
+		return paths;
+	}
+	
+	int remainingTargets = prepareTargets(paths);
+	if(remainingTargets > 0) {
+		if(!repairSearchTree(previousStartingTime)) {
+			beginNewSearch();
+		}
+		remainingTargets = search(paths, remainingTargets);
+		searchWithoutCorridor(paths, remainingTargets);
+	}
+	
+	if(lazyLineOfSight) {
+		ROS_DEBUG("[Agent %d] Lazy theta* saved %d line of sight checks", map->getOwnerId(), savedLineOfSightChecks);
+	}
+	
+	return paths;
+}
+
+void ThetaStarPathPlanner::setSearchArena(ThetaStarSearchArena* arena) {
+	this->arena = arena;
+}
+
+void ThetaStarPathPlanner::setLazyLineOfSight(bool lazy) {
+	lazyLineOfSight = lazy;
+}
+
+int ThetaStarPathPlanner::getSavedLineOfSightChecks() const {
+	return savedLineOfSightChecks;
+}
+
+int ThetaStarPathPlanner::prepareTargets(std::vector<Path>& paths) {
+	// Targets which are not in the map or at the start position need no search
+	int remainingTargets = 0;
+	for(unsigned long i = 0; i < targets.size(); i++) {
+		if(targetNodes[i] == nullptr) {
+			isTargetReached[i] = true;
+		} else if(start.x == targets[i].x && start.y == targets[i].y) {
+			paths[i] = Path(startingTime, {Point(start), Point(start)}, {0.0, 0.0}, hardwareProfile, targetReservationTime, start, start, map->getOwnerId());
+			isTargetReached[i] = true;
+		} else {
+			isTargetReached[i] = false;
+			remainingTargets++;
+		}
+	}
+	
+	return remainingTargets;
+}
+
+void ThetaStarPathPlanner::beginNewSearch() {
+	// Explored nodes and open list storage are reused from previous queries on the arena
+	arena->beginSearch(map->getNodeCount());
 
 	// Push start node
-	exploredSet.insert(std::make_pair(startNode->pos, ThetaStarGridNodeInformation(startNode, nullptr, startingTime)));
-	queue.push(std::make_pair(startingTime, &exploredSet.at(startNode->pos)));
+	ThetaStarGridNodeInformation* startInformation = arena->getInformation(startNode, startingTime);
+	arena->getOpenList()->push(startingTime, startInformation);
+}
 
-	bool targetFound = false;
-	ThetaStarGridNodeInformation* targetInformation = nullptr;
+bool ThetaStarPathPlanner::repairSearchTree(double previousStartingTime) {
+	ThetaStarGridNodeInformation* startInformation = arena->findInformation(startNode);
+	if(startInformation == nullptr || startInformation->prev != nullptr || startInformation->time != previousStartingTime) {
+		return false;
+	}
+	
+	double shift = startingTime - previousStartingTime;
+	const std::vector<const GridNode*>& searchedNodes = arena->getSearchedNodes();
+	std::vector<TreeNodeState> states(static_cast<unsigned long>(map->getNodeCount()), TreeNodeState::UNKNOWN);
+	states[startNode->id] = TreeNodeState::VALID;
+	
+	// A node stays in the tree iff all connections on its prev chain are still free. Chains are walked up to the first node with known state,
+	// which also detects nodes that were never reached (no prev) and prev cycles
+	std::vector<ThetaStarGridNodeInformation*> chain;
+	for(const GridNode* node : searchedNodes) {
+		ThetaStarGridNodeInformation* information = arena->findInformation(node);
+		chain.clear();
+		
+		while(information != nullptr && states[information->node->id] == TreeNodeState::UNKNOWN) {
+			states[information->node->id] = TreeNodeState::IN_PROGRESS;
+			chain.push_back(information);
+			information = information->prev;
+		}
+		
+		bool isValid = information != nullptr && states[information->node->id] == TreeNodeState::VALID;
+		for(auto it = chain.rbegin(); it != chain.rend(); ++it) {
+			isValid = isValid && isTreeConnectionValid(*it, shift);
+			states[(*it)->node->id] = isValid ? TreeNodeState::VALID : TreeNodeState::INVALID;
+		}
+	}
+	
+	// Move the remaining tree to the new starting time and reopen all other nodes
+	for(const GridNode* node : searchedNodes) {
+		ThetaStarGridNodeInformation* information = arena->findInformation(node);
+		if(states[node->id] == TreeNodeState::VALID) {
+			information->time += shift;
+		} else {
+			*information = ThetaStarGridNodeInformation(node, nullptr, initialTime);
+		}
+	}
+	startInformation->time = startingTime;
+	
+	// Only nodes at the border of the remaining tree can reach reopened or unexplored nodes. Targets inside the tree are pushed as well, 
+	// they are reached as soon as no border node can lead to a better connection
+	ThetaStarOpenList* openList = arena->getOpenList();
+	openList->clear(map->getNodeCount());
+	for(const GridNode* node : searchedNodes) {
+		if(states[node->id] != TreeNodeState::VALID) {
+			continue;
+		}
+		
+		bool isOnBorder = std::find(targetNodes.begin(), targetNodes.end(), node) != targetNodes.end();
+		for(const GridNode* neighbour : node->neighbours) {
+			isOnBorder = isOnBorder || states[neighbour->id] != TreeNodeState::VALID;
+		}
+		
+		if(isOnBorder) {
+			ThetaStarGridNodeInformation* information = arena->findInformation(node);
+			openList->push(information->time + getHeuristic(information), information);
+		}
+	}
+	
+	return true;
+}
+
+bool ThetaStarPathPlanner::isTreeConnectionValid(ThetaStarGridNodeInformation* information, double shift) const {
+	ThetaStarGridNodeInformation* prev = information->prev;
+	double timeAtPrev = prev->time + shift;
+	double waitingTime = information->waitTimeAtPrev;
+	double drivingTime = information->time - prev->time - waitingTime;
+	double earliestTime = timeAtPrev - timing.getPlanningUncertainty(timeAtPrev, Direction::BEHIND);
+	
+	TimedEdge edge;
+	map->collectTimedEdge(prev->node, information->node, earliestTime, smallerReservations, edge);
+	if(!edge.isConnectionFree(timeAtPrev, waitingTime, drivingTime)) {
+		return false;
+	}
+	
+	if(waitingTime > 0) {
+		return true;
+	}
+	
+	// Connections without waiting time additionally need to be free within the planning uncertainty
+	double timeAtNode = timeAtPrev + drivingTime;
+	timeAtNode += timing.getPlanningUncertainty(timeAtNode, Direction::AHEAD);
+	TimedLineOfSightResult result = edge.whenIsLineOfSightFree(earliestTime, timeAtNode);
+	
+	return !result.blockedByStatic && !result.blockedByTimed && (!result.hasUpcomingObstacle || timeAtNode < result.lastValidEntryTime);
+}
+
+int ThetaStarPathPlanner::search(std::vector<Path>& paths, int remainingTargets) {
+	ThetaStarOpenList* openList = arena->getOpenList();
 
-	while(!queue.empty()) {
-		ThetaStarGridNodeInformation* current = queue.top().second;
+	while(!openList->isEmpty()) {
+		ThetaStarGridNodeInformation* current = openList->pop();
+		
+		if(!current->isConnectionVerified && !verifyConnection(current)) {
+			continue;
+		}
 		ThetaStarGridNodeInformation* prev = current->prev;
-		queue.pop();
 
-		// Target found
-		if(current->node == targetNode) {
-			targetFound = true;
-			targetInformation = current;
+		// Target found. The path is constructed immediately because later relaxations may change the prev chain
+		for(unsigned long i = 0; i < targets.size(); i++) {
+			if(!isTargetReached[i] && current->node == targetNodes[i]) {
+				paths[i] = smoothPath(constructPath(startingTime, current, targetReservationTime, targets[i]));
+				isTargetReached[i] = true;
+				remainingTargets--;
+			}
+		}
+		
+		if(remainingTargets == 0) {
 			break;
 		}
 
 		// Explore all neighbours		
 		for(auto neighbourNode : current->node->neighbours) {
-			ThetaStarGridNodeInformation* neighbour = &exploredSet.insert(std::make_pair(neighbourNode->pos, ThetaStarGridNodeInformation(neighbourNode, nullptr, initialTime))).first->second;
+			if(!corridor.empty() && !clusterGraph->isInCorridor(neighbourNode, corridor)) {
+				continue;
+			}
+			
+			ThetaStarGridNodeInformation* neighbour = arena->getInformation(neighbourNode, initialTime);
+			
+			// Lazy theta*: assume the connection with prev, it is checked if the neighbour gets expanded
+			if(lazyLineOfSight && prev != nullptr && !neighbour->hadBlockedConnection) {
+				savedLineOfSightChecks++;
+				double drivingTime = timing.getDrivingAndTurningTime(prev, neighbour);
+				
+				if(prev->time + drivingTime < neighbour->time) {
+					neighbour->time = prev->time + drivingTime;
+					neighbour->prev = prev;
+					neighbour->waitTimeAtPrev = 0;
+					neighbour->isConnectionVerified = false;
+					openList->push(neighbour->time + getHeuristic(neighbour), neighbour);
+				}
+				continue;
+			}
 
 			// Driving time only includes the additional time to drive from newPrev to neighbour.
 			// Therefore: newPrev->time + drivingTime + waitingTime = neighbour->time must be true!
@@ -100,6 +317,7 @@ Path ThetaStarPathPlanner::findPath() {
 			double drivingTime = 0;
 			double waitingTime = 0;
 			ThetaStarGridNodeInformation* newPrev = nullptr;
+			TimedEdge* newPrevEdge = nullptr;
 			bool makeConnection = false;
 
 			// Only try direct connection with prev if not at start node (prev != nullptr) AND not blocked by timed obstacle
@@ -111,7 +329,9 @@ Path ThetaStarPathPlanner::findPath() {
 				double timeAtNeighbour = prev->time + timing.getDrivingAndTurningTime(prev, neighbour);
 				timeAtNeighbour += timing.getPlanningUncertainty(timeAtNeighbour, Direction::AHEAD);
 
-				TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(prev->node->pos, timeAtPrev, neighbour->node->pos, timeAtNeighbour, smallerReservations);
+				// All checks of the connection are done on the reservations collected once
+				map->collectTimedEdge(prev->node, neighbour->node, timeAtPrev, smallerReservations, prevEdge);
+				TimedLineOfSightResult result = prevEdge.whenIsLineOfSightFree(timeAtPrev, timeAtNeighbour);
 				
 				connectionWithPrevPossible = !result.blockedByStatic && !result.blockedByTimed && (!result.hasUpcomingObstacle || (result.hasUpcomingObstacle && timeAtNeighbour < result.lastValidEntryTime));
 			}
@@ -119,6 +339,7 @@ Path ThetaStarPathPlanner::findPath() {
 			if(prevNotNull && connectionWithPrevPossible) {
 				drivingTime = timing.getDrivingAndTurningTime(prev, neighbour);
 				newPrev = prev;
+				newPrevEdge = &prevEdge;
 				makeConnection = true;
 			} else {
 				// If no direct connection possible, try to connect via current
@@ -126,7 +347,8 @@ Path ThetaStarPathPlanner::findPath() {
 				timeAtCurrent -= timing.getPlanningUncertainty(timeAtCurrent, Direction::BEHIND);
 				double timeAtNeighbour = current->time + timing.getDrivingAndTurningTime(current, neighbour);
 				timeAtNeighbour += timing.getPlanningUncertainty(timeAtNeighbour, Direction::AHEAD);
-				TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(current->node->pos, timeAtCurrent, neighbour->node->pos, timeAtNeighbour, smallerReservations);
+				map->collectTimedEdge(current->node, neighbour->node, timeAtCurrent, smallerReservations, currentEdge);
+				TimedLineOfSightResult result = currentEdge.whenIsLineOfSightFree(timeAtCurrent, timeAtNeighbour);
 
 				if(!result.blockedByStatic) {
 					bool waitBecauseUpcomingObstacle = result.hasUpcomingObstacle && timeAtNeighbour >= result.lastValidEntryTime;
@@ -134,6 +356,7 @@ Path ThetaStarPathPlanner::findPath() {
 					if(!result.blockedByTimed && !waitBecauseUpcomingObstacle) {
 						drivingTime = timing.getDrivingAndTurningTime(current, neighbour);
 						newPrev = current;
+						newPrevEdge = &currentEdge;
 						makeConnection = true;
 					} else {
 						// Calculate wait time
@@ -147,6 +370,7 @@ Path ThetaStarPathPlanner::findPath() {
 
 						drivingTime = timing.getDrivingAndTurningTime(current, neighbour);
 						newPrev = current;
+						newPrevEdge = &currentEdge;
 						makeConnection = true;
 					}
 				}
@@ -155,27 +379,27 @@ Path ThetaStarPathPlanner::findPath() {
 			// Finally try to make connection
 			if(makeConnection && (newPrev->time + drivingTime + waitingTime) < neighbour->time) {
 				// Check for if connection is valid for upcoming obstacles
-				if(map->isTimedConnectionFree(newPrev->node->pos, neighbour->node->pos, newPrev->time, waitingTime, drivingTime, smallerReservations)) {
-					double heuristic = getHeuristic(neighbour, targetNode->pos);
+				if(newPrevEdge->isConnectionFree(newPrev->time, waitingTime, drivingTime)) {
+					double heuristic = getHeuristic(neighbour);
 
 					neighbour->time = newPrev->time + drivingTime + waitingTime;
 					neighbour->prev = newPrev;
 					neighbour->waitTimeAtPrev = waitingTime;
-					queue.push(std::make_pair(neighbour->time + heuristic, neighbour));
+					openList->push(neighbour->time + heuristic, neighbour);
 				} else {
-					TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(newPrev->node->pos, newPrev->time, neighbour->node->pos, newPrev->time + waitingTime + drivingTime, smallerReservations);
+					TimedLineOfSightResult result = newPrevEdge->whenIsLineOfSightFree(newPrev->time, newPrev->time + waitingTime + drivingTime);
 					
 					if(!result.blockedByStatic && result.blockedByTimed) {
 						double newWaitingTime = result.freeAfter - newPrev->time;
 						waitingTime = std::max(waitingTime, newWaitingTime);
 
-						if(map->isTimedConnectionFree(newPrev->node->pos, neighbour->node->pos, newPrev->time, waitingTime, drivingTime, smallerReservations)) {
-							double heuristic = getHeuristic(neighbour, targetNode->pos);
+						if(newPrevEdge->isConnectionFree(newPrev->time, waitingTime, drivingTime)) {
+							double heuristic = getHeuristic(neighbour);
 
 							neighbour->time = newPrev->time + drivingTime + waitingTime;
 							neighbour->prev = newPrev;
 							neighbour->waitTimeAtPrev = waitingTime;
-							queue.push(std::make_pair(neighbour->time + heuristic, neighbour));
+							openList->push(neighbour->time + heuristic, neighbour);
 							//ROS_INFO("[Agent %d] Made connection only after second attempt", map->getOwnerId());
 						}
 					}
@@ -183,27 +407,125 @@ Path ThetaStarPathPlanner::findPath() {
 			}
 		}
 	}
+	
+	return remainingTargets;
+}
 
-	if(targetFound) {
-		Path path = constructPath(startingTime, targetInformation, targetReservationTime);
-		return smoothPath(path);
-	} else {
-		//ROS_WARN("[Agent %d] No path found from node %f/%f to node %f/%f!", map->getOwnerId(), startNode->pos.x,startNode->pos.y, targetNode->pos.x, targetNode->pos.y);
-		//ROS_WARN("Reservations for start:");
-		//map->listAllReservationsIn(startNode->pos);
+bool ThetaStarPathPlanner::verifyConnection(ThetaStarGridNodeInformation* information) {
+	information->isConnectionVerified = true;
+	ThetaStarGridNodeInformation* prev = information->prev;
+	
+	double timeAtPrev = prev->time - timing.getPlanningUncertainty(prev->time, Direction::BEHIND);
+	double timeAtNode = information->time + timing.getPlanningUncertainty(information->time, Direction::AHEAD);
+	savedLineOfSightChecks--;
+	map->collectTimedEdge(prev->node, information->node, timeAtPrev, smallerReservations, prevEdge);
+	TimedLineOfSightResult result = prevEdge.whenIsLineOfSightFree(timeAtPrev, timeAtNode);
+	
+	bool isFree = !result.blockedByStatic && !result.blockedByTimed && (!result.hasUpcomingObstacle || timeAtNode < result.lastValidEntryTime);
+	if(isFree && prevEdge.isConnectionFree(prev->time, 0, information->time - prev->time)) {
+		return true;
+	}
+	
+	// Connect to the reached neighbour with the earliest arrival instead. Descendants of the node are skipped, connecting to them would create a cycle
+	information->time = initialTime;
+	information->prev = nullptr;
+	information->waitTimeAtPrev = 0;
+	information->hadBlockedConnection = true;
+	
+	for(const GridNode* neighbourNode : information->node->neighbours) {
+		ThetaStarGridNodeInformation* neighbour = arena->findInformation(neighbourNode);
+		if(neighbour == nullptr || neighbour->time >= initialTime || !neighbour->isConnectionVerified) {
+			continue;
+		}
+		
+		bool isDescendant = false;
+		for(ThetaStarGridNodeInformation* ancestor = neighbour->prev; ancestor != nullptr && !isDescendant; ancestor = ancestor->prev) {
+			isDescendant = ancestor == information;
+		}
+		if(isDescendant) {
+			continue;
+		}
+		
+		double waitingTime;
+		double drivingTime;
+		if(getConnection(neighbour, information, waitingTime, drivingTime) && neighbour->time + waitingTime + drivingTime < information->time) {
+			information->time = neighbour->time + waitingTime + drivingTime;
+			information->prev = neighbour;
+			information->waitTimeAtPrev = waitingTime;
+		}
+	}
+	
+	if(information->prev != nullptr) {
+		arena->getOpenList()->push(information->time + getHeuristic(information), information);
+	}
+	
+	return false;
+}
 
-		//ROS_WARN("Reservations for target:");
-		//map->listAllReservationsIn(targetNode->pos);
+bool ThetaStarPathPlanner::getConnection(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to, double& waitingTime, double& drivingTime) {
+	drivingTime = timing.getDrivingAndTurningTime(from, to);
+	waitingTime = 0;
+	
+	double timeAtFrom = from->time - timing.getPlanningUncertainty(from->time, Direction::BEHIND);
+	double timeAtTo = from->time + drivingTime;
+	timeAtTo += timing.getPlanningUncertainty(timeAtTo, Direction::AHEAD);
+	savedLineOfSightChecks--;
+	map->collectTimedEdge(from->node, to->node, timeAtFrom, smallerReservations, currentEdge);
+	TimedLineOfSightResult result = currentEdge.whenIsLineOfSightFree(timeAtFrom, timeAtTo);
+	if(result.blockedByStatic) {
+		return false;
+	}
+	
+	// Wait until upcoming obstacles at the target or obstacles on the connection have passed
+	if(result.hasUpcomingObstacle && timeAtTo >= result.lastValidEntryTime) {
+		waitingTime = std::max(0.0, result.freeAfterUpcomingObstacle - from->time);
+	} else if(result.blockedByTimed) {
+		waitingTime = std::max(0.0, result.freeAfter - from->time);
+	}
+	
+	if(currentEdge.isConnectionFree(from->time, waitingTime, drivingTime)) {
+		return true;
+	}
+	
+	// Obstacles which only block the connection after waiting
+	savedLineOfSightChecks--;
+	result = currentEdge.whenIsLineOfSightFree(from->time, from->time + waitingTime + drivingTime);
+	if(result.blockedByStatic || !result.blockedByTimed) {
+		return false;
+	}
+	
+	waitingTime = std::max(waitingTime, result.freeAfter - from->time);
+	return currentEdge.isConnectionFree(from->time, waitingTime, drivingTime);
+}
 
-		return Path();
+void ThetaStarPathPlanner::searchWithoutCorridor(std::vector<Path>& paths, int remainingTargets) {
+	if(remainingTargets == 0 || corridor.empty()) {
+		return;
 	}
+	
+	// Reservations can block the corridor although a static path exists
+	corridor.clear();
+	beginNewSearch();
+	search(paths, remainingTargets);
 }
 
-double ThetaStarPathPlanner::getHeuristic(ThetaStarGridNodeInformation* current, Point targetPos) const {
-	return hardwareProfile->getDrivingDuration(Math::getDistance(current->node->pos, targetPos));
+double ThetaStarPathPlanner::getHeuristic(ThetaStarGridNodeInformation* current) const {
+	double minDistance = std::numeric_limits<double>::max();
+	for(unsigned long i = 0; i < targetNodes.size(); i++) {
+		if(!isTargetReached[i]) {
+			double distance = Math::getDistance(current->node->pos, targetNodes[i]->pos);
+			// Nodes which cannot reach the target statically keep the euclidean distance, infinite values would destroy the expansion order
+			if(targetDistanceFields[i] != nullptr && std::isfinite(targetDistanceFields[i][current->node->id])) {
+				distance = std::max(distance, static_cast<double>(targetDistanceFields[i][current->node->id]));
+			}
+			minDistance = std::min(minDistance, distance);
+		}
+	}
+	
+	return hardwareProfile->getDrivingDuration(minDistance);
 }
 
-Path ThetaStarPathPlanner::constructPath(double startingTime, ThetaStarGridNodeInformation* targetInformation, double targetReservationTime) const {
+Path ThetaStarPathPlanner::constructPath(double startingTime, ThetaStarGridNodeInformation* targetInformation, double targetReservationTime, const OrientedPoint& target) const {
 	std::vector<Point> pathNodes;
 	std::vector<double> waitTimes;
 	ThetaStarGridNodeInformation* currentGridInformation = targetInformation;
@@ -0,0 +1,53 @@
+#include <algorithm>
+
+#include "agent/path_planning/ThetaStarSearchArena.h"
+
+void ThetaStarSearchArena::beginSearch(int nodeCount) {
+	// The open list still points into the records of the last search, so it has to be cleared before they are reallocated
+	openList.clear(nodeCount);
+	searchedNodes.clear();
+	
+	auto size = static_cast<unsigned long>(nodeCount);
+	if(records.size() < size) {
+		records.resize(size, ThetaStarGridNodeInformation(nullptr, nullptr, 0));
+		generations.resize(size, 0);
+	}
+	
+	generation++;
+	
+	// Generation counter wrapped around, stale records could look valid again
+	if(generation == 0) {
+		std::fill(generations.begin(), generations.end(), 0);
+		generation = 1;
+	}
+}
+
+ThetaStarGridNodeInformation* ThetaStarSearchArena::getInformation(const GridNode* node, double initialTime) {
+	auto index = static_cast<unsigned long>(node->id);
+	ThetaStarGridNodeInformation* information = &records[index];
+	
+	if(generations[index] != generation) {
+		generations[index] = generation;
+		*information = ThetaStarGridNodeInformation(node, nullptr, initialTime);
+		searchedNodes.push_back(node);
+	}
+	
+	return information;
+}
+
+ThetaStarGridNodeInformation* ThetaStarSearchArena::findInformation(const GridNode* node) {
+	auto index = static_cast<unsigned long>(node->id);
+	if(index >= generations.size() || generations[index] != generation) {
+		return nullptr;
+	}
+	
+	return &records[index];
+}
+
+const std::vector<const GridNode*>& ThetaStarSearchArena::getSearchedNodes() const {
+	return searchedNodes;
+}
+
+ThetaStarOpenList* ThetaStarSearchArena::getOpenList() {
+	return &openList;
+}
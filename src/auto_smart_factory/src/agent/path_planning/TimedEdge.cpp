@@ -0,0 +1,119 @@
+#include "agent/path_planning/TimedEdge.h"
+#include "Math.h"
+
+void TimedEdge::reset(const Point& pos1, const Point& pos2, bool isStaticLineOfSightFree) {
+	this->pos1 = pos1;
+	this->pos2 = pos2;
+	staticLineOfSightFree = isStaticLineOfSightFree;
+	entries.clear();
+}
+
+void TimedEdge::addReservation(const Rectangle* reservation, bool isSmaller) {
+	Entry entry{};
+	entry.startTime = reservation->getStartTime();
+	entry.endTime = reservation->getEndTime();
+	entry.latestStartTime = reservation->getShape() == RectangleShape::SWEPT_CAPSULE ? entry.endTime - reservation->getHoldDuration() : entry.startTime;
+	entry.reservation = reservation;
+	entry.isSmaller = isSmaller;
+	entries.push_back(entry);
+}
+
+TimedLineOfSightResult TimedEdge::whenIsLineOfSightFree(double startTime, double endTime) {
+	TimedLineOfSightResult result;
+	if(!staticLineOfSightFree) {
+		result.blockedByStatic = true;
+		return result;
+	}
+
+	for(Entry& entry : entries) {
+		// Directly blocked
+		if(startTime + 0.01f <= entry.endTime && endTime >= entry.startTime) {
+			const TimeRange* blocked = getTimeRange(entry, BLOCKS_SEGMENT);
+			
+			if(blocked != nullptr && startTime + 0.01f <= blocked->end && endTime >= blocked->start) {
+				result.blockedByTimed = true;
+				if(blocked->end > result.freeAfter) {
+					result.freeAfter = blocked->end;
+				}
+			}
+		}
+
+		// Upcoming obstacles
+		if(entry.latestStartTime > endTime) {
+			const TimeRange* upcoming = getTimeRange(entry, CONTAINS_END);
+			
+			if(upcoming != nullptr && upcoming->start > endTime) {
+				result.hasUpcomingObstacle = true;
+
+				double lastValidEntryTime = upcoming->start - minTimeToLeave;
+				if(lastValidEntryTime < result.lastValidEntryTime) {
+					result.lastValidEntryTime = lastValidEntryTime;
+					result.freeAfterUpcomingObstacle = upcoming->end;
+				}
+			}
+		}
+	}
+
+	// Treat "infinite" obstacles as completely blocked and dont wait forever
+	double maxTime = endTime + 1000.f;
+	if((result.blockedByTimed && result.freeAfter > maxTime) ||
+	   (result.hasUpcomingObstacle && (result.lastValidEntryTime > maxTime || result.freeAfterUpcomingObstacle > maxTime))) {
+		result.blockedByStatic = true;
+	}
+
+	return result;
+}
+
+bool TimedEdge::isConnectionFree(double startTime, double waitingTime, double drivingTime) {
+	double endTime = startTime + waitingTime + drivingTime;
+
+	for(Entry& entry : entries) {
+		// Check if the waiting part is free
+		if(startTime <= entry.endTime && startTime + waitingTime - 0.01f >= entry.startTime) {
+			const TimeRange* waiting = getTimeRange(entry, CONTAINS_START);
+			if(waiting != nullptr && startTime <= waiting->end && startTime + waitingTime - 0.01f >= waiting->start) {
+				return false;
+			}
+		}
+
+		// Check if the driving part is free
+		if(startTime + waitingTime + 0.01f <= entry.endTime && endTime >= entry.startTime) {
+			const TimeRange* driving = getTimeRange(entry, BLOCKS_SEGMENT);
+			if(driving != nullptr && startTime + waitingTime + 0.01f <= driving->end && endTime >= driving->start) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool TimedEdge::isStaticLineOfSightFree() const {
+	return staticLineOfSightFree;
+}
+
+const TimedEdge::TimeRange* TimedEdge::getTimeRange(Entry& entry, Relation relation) const {
+	unsigned char bit = static_cast<unsigned char>(1u << relation);
+	
+	if((entry.tested & bit) == 0) {
+		const Rectangle& reservation = *entry.reservation;
+		TimeRange& range = entry.ranges[relation];
+		bool holds;
+
+		if(entry.isSmaller) {
+			holds = relation == BLOCKS_SEGMENT ? Math::doesLineSegmentIntersectNonInflatedRectangle(pos1, pos2, reservation) : Math::isPointInNonInflatedRectangle(relation == CONTAINS_START ? pos1 : pos2, reservation);
+			range = TimeRange{entry.startTime, entry.endTime};
+		} else if(relation == BLOCKS_SEGMENT) {
+			holds = Math::getReservedTimeRangeOnLineSegment(pos1, pos2, reservation, range.start, range.end);
+		} else {
+			holds = Math::getReservedTimeRangeAtPoint(relation == CONTAINS_START ? pos1 : pos2, reservation, range.start, range.end);
+		}
+
+		entry.tested |= bit;
+		if(holds) {
+			entry.holding |= bit;
+		}
+	}
+
+	return (entry.holding & bit) != 0 ? &entry.ranges[relation] : nullptr;
+}
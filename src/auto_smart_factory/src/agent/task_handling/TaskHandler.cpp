@@ -11,6 +11,7 @@ TaskHandler::TaskHandler(Agent* agent, ros::Publisher* scorePub, ros::Publisher*
 	chargingManagement(cm),
 	reservationManager(rm)
 {
+	announcementWorkers = new PlanningWorkerPool(*map, announcementWorkerCount);
 }
 
 void TaskHandler::publishScore(unsigned int requestId, double score, uint32_t startTrayId, uint32_t endTrayId, double estimatedDuration) {
@@ -63,6 +64,9 @@ void TaskHandler::update() {
 }
 
 TaskHandler::~TaskHandler() {
+	// Stop the workers first, running jobs still use this task handler
+	delete announcementWorkers;
+	
 	if (currentTask != nullptr) {
 		delete currentTask;
 	}
@@ -315,10 +319,24 @@ void TaskHandler::announcementCallback(const auto_smart_factory::TaskAnnouncemen
 }
 
 void TaskHandler::answerAnnouncements() {
+	if(announcements.empty()) {
+		return;
+	}
+	
+	std::shared_ptr<const ReservationTable> reservations = map->getReservationSnapshot();
+	
 	while(!announcements.empty()) {
 		auto_smart_factory::TaskAnnouncement tA = announcements.front();
 		if(ros::Time::now() < tA.timeout){
-			answerAnnouncement(tA);
+			AnnouncementContext context = getAnnouncementContext(tA);
+			
+			announcementWorkers->submit([this, tA, context, reservations](Map& workerMap) {
+				// The announcement might have waited for a free worker
+				if(ros::Time::now() < tA.timeout) {
+					workerMap.setReservations(reservations);
+					answerAnnouncement(tA, context, workerMap);
+				}
+			});
 		} else {
 			//ROS_INFO("[Task Handler %d] will not answer to Request %d as it already timeouted", agent->getAgentIdInt(), tA.request_id);
 		}
@@ -326,36 +344,59 @@ void TaskHandler::answerAnnouncements() {
 	}
 }
 
-void TaskHandler::answerAnnouncement(auto_smart_factory::TaskAnnouncement& taskAnnouncement) {
-	double queuedDuration = getDuration();
-	double estimatedBatteryAfterQueuedTasks = getEstimatedBatteryLevelAfterQueuedTasks();
+TaskHandler::AnnouncementContext TaskHandler::getAnnouncementContext(const auto_smart_factory::TaskAnnouncement& taskAnnouncement) {
+	AnnouncementContext context;
+	context.queuedDuration = getDuration();
+	context.estimatedBatteryAfterQueuedTasks = getEstimatedBatteryLevelAfterQueuedTasks();
 	Task* lastTask = getLastTask();
 	
+	if(lastTask != nullptr){
+		// take the last position of the last task
+		context.startPosition = lastTask->getTargetPosition();
+		context.startTime = lastTask->getEndTime();
+	} else {
+		// take the current position
+		context.startPosition = agent->getCurrentOrientedPosition();
+		context.startTime = ros::Time::now().toSec();
+	}
+
+	for(uint32_t it_id : taskAnnouncement.start_ids) {
+		context.inputTrays.push_back(agent->getTray(it_id));
+	}
+	
+	for(uint32_t st_id : taskAnnouncement.end_ids) {
+		context.storageTrays.push_back(agent->getTray(st_id));
+	}
+	
+	return context;
+}
+
+void TaskHandler::answerAnnouncement(const auto_smart_factory::TaskAnnouncement& taskAnnouncement, const AnnouncementContext& context, Map& workerMap) {
+	const std::vector<auto_smart_factory::Tray>& inputTrays = context.inputTrays;
+	const std::vector<auto_smart_factory::Tray>& storageTrays = context.storageTrays;
+	double queuedDuration = context.queuedDuration;
+	double estimatedBatteryAfterQueuedTasks = context.estimatedBatteryAfterQueuedTasks;
+	double startTime = context.startTime;
+	
 	TrayScore* best = nullptr;
 
-	for(uint32_t it_id : taskAnnouncement.start_ids){
-		for(uint32_t st_id : taskAnnouncement.end_ids){
-			// get Path
-			auto_smart_factory::Tray input_tray = agent->getTray(it_id);
-			auto_smart_factory::Tray storage_tray = agent->getTray(st_id);
-			Path sourcePath;
-			double startTime;
-			
-			if(lastTask != nullptr){
-				// take the last position of the last task
-				startTime = lastTask->getEndTime();
-				sourcePath = map->getThetaStarPath(lastTask->getTargetPosition(), input_tray, startTime, TransportationTask::getPickUpTime());
-			} else {
-				// take the current position
-				startTime = ros::Time::now().toSec();
-				sourcePath = map->getThetaStarPath(agent->getCurrentOrientedPosition(), input_tray, startTime, TransportationTask::getPickUpTime());
-			}
-			
-			if(!sourcePath.isValid()){
-				continue;
-			}
-			
-			Path targetPath = map->getThetaStarPath(input_tray, storage_tray, startTime + sourcePath.getDuration() + TransportationTask::getPickUpTime(), TransportationTask::getDropOffTime());
+	// One search from the start position to all input trays
+	std::vector<Path> sourcePaths = workerMap.getThetaStarPaths(context.startPosition, inputTrays, startTime, TransportationTask::getPickUpTime());
+
+	for(unsigned long i = 0; i < inputTrays.size(); i++) {
+		const Path& sourcePath = sourcePaths[i];
+		uint32_t it_id = taskAnnouncement.start_ids[i];
+		
+		if(!sourcePath.isValid()){
+			continue;
+		}
+		
+		// One search from the input tray to all storage trays
+		std::vector<Path> targetPaths = workerMap.getThetaStarPaths(inputTrays[i], storageTrays, startTime + sourcePath.getDuration() + TransportationTask::getPickUpTime(), TransportationTask::getDropOffTime());
+		
+		for(unsigned long j = 0; j < storageTrays.size(); j++) {
+			const Path& targetPath = targetPaths[j];
+			uint32_t st_id = taskAnnouncement.end_ids[j];
 			
 			if(!targetPath.isValid()) {
 				continue;
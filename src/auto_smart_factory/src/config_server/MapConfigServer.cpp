@@ -135,6 +135,7 @@ void MapConfigServer::addStaticObstacles() {
 		rectangle.sizeY = r.getSize().y;
 		rectangle.rotation = r.getRotation();
 		rectangle.ownerId = -1;
+		rectangle.sequence = Rectangle::noSequence;
 
 		warehouseConfig.map_configuration.obstacles.push_back(rectangle);
 	}	
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include "ros/ros.h"
+#include "ros/serialization.h"
+#include "auto_smart_factory/ReservationBroadcast.h"
+#include "auto_smart_factory/Rectangle.h"
+#include "agent/path_planning/ReservationBroadcastCodec.h"
+#include "Math.h"
+
+// Compares the reservation broadcast with the former format, which carried every reservation as auto_smart_factory/Rectangle and
+// replaced all reservations of the owner. Measures the serialized size and the time an agent needs to deserialize and decode a broadcast
+
+// Former broadcast layout: ownerId, isReservationBroadcastOrDenial, isEmergencyStop, Rectangle[] reservations
+struct FormerBroadcast {
+	int32_t ownerId;
+	uint8_t isReservationBroadcastOrDenial;
+	uint8_t isEmergencyStop;
+	std::vector<auto_smart_factory::Rectangle> reservations;
+};
+
+// Path like reservations: waiting rectangles at the turns and swept capsules along the segments
+static std::vector<Rectangle> generatePathReservations(std::mt19937& random, int ownerId, int firstSequence, int count) {
+	std::uniform_real_distribution<double> coordinate(1, 40);
+	std::uniform_real_distribution<double> duration(0.5, 6);
+	double reservationSize = ROBOT_RADIUS * 2;
+
+	std::vector<Rectangle> reservations;
+	Point pos(coordinate(random), coordinate(random));
+	double time = 1000;
+	for(int i = 0; i < count; i++) {
+		if(i % 4 == 0) {
+			reservations.emplace_back(pos, Point(reservationSize, reservationSize) * 0.98f, 0, time - 0.5, time + 1.5, ownerId, firstSequence + i);
+		} else {
+			Point next(coordinate(random), coordinate(random));
+			double segmentDuration = duration(random);
+			Rectangle capsule = Rectangle::createSweptCapsule(pos, next, reservationSize * 0.5f, time - 0.6, time + segmentDuration + 1.2, 1.8, ownerId);
+			reservations.emplace_back(capsule.getPosition(), capsule.getSize(), capsule.getRotation(), capsule.getStartTime(), capsule.getEndTime(), ownerId,
+			                          firstSequence + i, capsule.getShape(), capsule.getHoldDuration());
+			pos = next;
+			time += segmentDuration;
+		}
+	}
+
+	return reservations;
+}
+
+static FormerBroadcast createFormerBroadcast(int ownerId, const std::vector<Rectangle>& reservations) {
+	FormerBroadcast msg;
+	msg.ownerId = ownerId;
+	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
+	msg.isEmergencyStop = static_cast<unsigned char>(false);
+
+	for(const auto& r : reservations) {
+		auto_smart_factory::Rectangle rectangle;
+		rectangle.posX = r.getPosition().x;
+		rectangle.posY = r.getPosition().y;
+		rectangle.sizeX = r.getSize().x;
+		rectangle.sizeY = r.getSize().y;
+		rectangle.rotation = r.getRotation();
+		rectangle.startTime = r.getStartTime();
+		rectangle.endTime = r.getEndTime();
+		rectangle.ownerId = r.getOwnerId();
+		rectangle.sequence = r.getSequence();
+		rectangle.shape = static_cast<uint8_t>(r.getShape());
+		rectangle.holdDuration = r.getHoldDuration();
+		msg.reservations.push_back(rectangle);
+	}
+
+	return msg;
+}
+
+static uint32_t getFormerSerializationLength(const FormerBroadcast& msg) {
+	return 4 + 1 + 1 + ros::serialization::serializationLength(msg.reservations);
+}
+
+// Returns the serialized size in bytes and the decode time in microseconds per broadcast
+static void benchmarkFormer(const FormerBroadcast& msg, int iterations, uint32_t& bytes, double& decodeMicroseconds) {
+	std::vector<uint8_t> buffer(ros::serialization::serializationLength(msg.reservations));
+	ros::serialization::OStream out(buffer.data(), static_cast<uint32_t>(buffer.size()));
+	ros::serialization::serialize(out, msg.reservations);
+	bytes = getFormerSerializationLength(msg);
+
+	size_t checksum = 0;
+	double start = ros::WallTime::now().toSec();
+	for(int i = 0; i < iterations; i++) {
+		std::vector<auto_smart_factory::Rectangle> decoded;
+		ros::serialization::IStream in(buffer.data(), static_cast<uint32_t>(buffer.size()));
+		ros::serialization::deserialize(in, decoded);
+
+		std::vector<Rectangle> reservations;
+		for(const auto& r : decoded) {
+			reservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId, r.sequence, static_cast<RectangleShape>(r.shape), r.holdDuration);
+		}
+		checksum += reservations.size();
+	}
+	decodeMicroseconds = (ros::WallTime::now().toSec() - start) * 1e6 / iterations;
+
+	if(checksum != msg.reservations.size() * iterations) {
+		ROS_ERROR("[reservation broadcast benchmark]: Decoded wrong number of reservations");
+	}
+}
+
+static void benchmarkCompact(const auto_smart_factory::ReservationBroadcast& msg, int iterations, uint32_t& bytes, double& decodeMicroseconds) {
+	bytes = ros::serialization::serializationLength(msg);
+	std::vector<uint8_t> buffer(bytes);
+	ros::serialization::OStream out(buffer.data(), bytes);
+	ros::serialization::serialize(out, msg);
+
+	size_t checksum = 0;
+	double start = ros::WallTime::now().toSec();
+	for(int i = 0; i < iterations; i++) {
+		auto_smart_factory::ReservationBroadcast decoded;
+		ros::serialization::IStream in(buffer.data(), bytes);
+		ros::serialization::deserialize(in, decoded);
+
+		checksum += ReservationBroadcastCodec::decode(decoded).size();
+	}
+	decodeMicroseconds = (ros::WallTime::now().toSec() - start) * 1e6 / iterations;
+
+	if(checksum != msg.reservations.size() * iterations) {
+		ROS_ERROR("[reservation broadcast benchmark]: Decoded wrong number of reservations");
+	}
+}
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "reservation_broadcast_benchmark");
+	ros::NodeHandle pn("~");
+
+	int reservationCount;
+	int changedReservationCount;
+	int iterations;
+	pn.param("reservations", reservationCount, 40);
+	pn.param("changed_reservations", changedReservationCount, 8);
+	pn.param("iterations", iterations, 20000);
+	changedReservationCount = std::min(changedReservationCount, reservationCount);
+
+	std::mt19937 random(42);
+	int ownerId = 3;
+	std::vector<Rectangle> reservations = generatePathReservations(random, ownerId, 1, reservationCount);
+
+	// A full path and an extension which keeps all but the last reservations of the path
+	int keptCount = reservationCount - changedReservationCount;
+	std::vector<int> keptSequences;
+	for(int i = 0; i < keptCount; i++) {
+		keptSequences.push_back(reservations[i].getSequence());
+	}
+	std::vector<Rectangle> changedReservations = generatePathReservations(random, ownerId, reservationCount + 1, changedReservationCount);
+	std::vector<Rectangle> extendedReservations(reservations.begin(), reservations.begin() + keptCount);
+	extendedReservations.insert(extendedReservations.end(), changedReservations.begin(), changedReservations.end());
+
+	auto_smart_factory::ReservationBroadcast full;
+	full.ownerId = ownerId;
+	full.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
+	ReservationBroadcastCodec::encode(full, std::vector<int>(), reservations, 1000);
+
+	auto_smart_factory::ReservationBroadcast delta;
+	delta.ownerId = ownerId;
+	delta.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
+	ReservationBroadcastCodec::encode(delta, keptSequences, changedReservations, 1000);
+
+	uint32_t formerBytes, formerExtensionBytes, fullBytes, deltaBytes;
+	double formerMicroseconds, formerExtensionMicroseconds, fullMicroseconds, deltaMicroseconds;
+	benchmarkFormer(createFormerBroadcast(ownerId, reservations), iterations, formerBytes, formerMicroseconds);
+	benchmarkFormer(createFormerBroadcast(ownerId, extendedReservations), iterations, formerExtensionBytes, formerExtensionMicroseconds);
+	benchmarkCompact(full, iterations, fullBytes, fullMicroseconds);
+	benchmarkCompact(delta, iterations, deltaBytes, deltaMicroseconds);
+
+	ROS_INFO("[reservation broadcast benchmark]: %d reservations, extension changes %d", reservationCount, changedReservationCount);
+	ROS_INFO("[reservation broadcast benchmark]: Path: former %u bytes, %.2fus decode | compact %u bytes, %.2fus decode",
+	         formerBytes, formerMicroseconds, fullBytes, fullMicroseconds);
+	ROS_INFO("[reservation broadcast benchmark]: Extension: former %u bytes, %.2fus decode | compact delta %u bytes, %.2fus decode",
+	         formerExtensionBytes, formerExtensionMicroseconds, deltaBytes, deltaMicroseconds);
+
+	return 0;
+}
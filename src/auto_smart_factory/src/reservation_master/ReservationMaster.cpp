@@ -1,85 +1,420 @@
 
+#include <algorithm>
+#include <iterator>
 #include <include/reservation_master/ReservationMaster.h>
 
 #include "reservation_master/ReservationMaster.h"
 #include "auto_smart_factory/ReservationBroadcast.h"
+#include "auto_smart_factory/GetWarehouseConfig.h"
+#include "agent/path_planning/ReservationBroadcastCodec.h"
+#include "Math.h"
 
-ReservationMaster::ReservationMaster() {
-	ros::NodeHandle pn("~");
+ReservationMaster::ReservationMaster() :
+		pn("~")
+{
+	ros::NodeHandle n;
+	
+	pn.param("event_driven", eventDriven, false);
+	pn.param("collection_window", collectionWindow, 0.005);
+	epoch = static_cast<uint32_t>(static_cast<uint64_t>(ros::WallTime::now().toSec() * 1000));
+	
+	std::string srv_name = "config_server/get_map_configuration";
+	ros::ServiceClient client = n.serviceClient<auto_smart_factory::GetWarehouseConfig>(srv_name.c_str());
+	auto_smart_factory::GetWarehouseConfig srv;
+	ros::service::waitForService(srv_name.c_str());
+	if(!client.call(srv)) {
+		// Without the map size there are no reservation tables to check requests against
+		ROS_FATAL("[Reservation Master] Failed to call service %s!", srv_name.c_str());
+		ros::shutdown();
+		return;
+	}
+	
+	const auto& mapConfig = srv.response.warehouse_configuration.map_configuration;
+	zoneLayout = ReservationZones::fromParameters(mapConfig.width, mapConfig.height);
+	zones.resize(zoneLayout.getZoneCount());
+	for(Zone& zone : zones) {
+		zone.reservations = ReservationTable(mapConfig.width, mapConfig.height, reservationCellSize);
+	}
 	
 	reservationBroadcastPublisher = pn.advertise<auto_smart_factory::ReservationBroadcast>("/reservation_broadcast", 100, true);
+	if(zoneLayout.isPartitioned()) {
+		for(int zone = 0; zone < static_cast<int>(zones.size()); zone++) {
+			zones[zone].broadcastPublisher = pn.advertise<auto_smart_factory::ReservationBroadcast>(ReservationZones::getBroadcastTopic(zone), 100, true);
+		}
+		ROS_INFO("[Reservation Master] Resolving rounds in %lu zones", zones.size());
+	}
+	requestLatencyPublisher = pn.advertise<std_msgs::Float64>("request_latency_median", 10);
 	reservationRequestSubscriber = pn.subscribe("/reservation_request", 100, &ReservationMaster::reservationRequestCallback, this);
+	reservationSnapshotServer = pn.advertiseService("get_reservation_snapshot", &ReservationMaster::reservationSnapshotCallback, this);
 }
 
 void ReservationMaster::update() {
-	if(!requests.empty()) {
-		double highestBid = -1.f;
-		int highestRequestIndex = -1;
-		std::vector<int> emergencyStopRequests;
+	resolveEmergencyStops();
+	
+	for(int zone = 0; zone < static_cast<int>(zones.size()); zone++) {
+		resolveRound(zone);
+	}
+}
+
+void ReservationMaster::resolveRound(int zone) {
+	Zone& z = zones[zone];
+	if(z.roundRequests.empty()) {
+		return;
+	}
+	
+	z.reservations.removeExpired(ros::Time::now().toSec());
+	
+	std::vector<unsigned long> round;
+	round.swap(z.roundRequests);
+	
+	// Highest bid first
+	std::stable_sort(round.begin(), round.end(), [this](unsigned long a, unsigned long b) {
+		return pendingRequests.at(a).msg.bid > pendingRequests.at(b).msg.bid;
+	});
+	
+	unsigned long grantedBefore = grantedRequestCount;
+	unsigned long deniedBefore = deniedRequestCount;
+	int waitingCount = 0;
+	
+	std::unordered_set<int> roundOwners;
+	for(unsigned long requestId : round) {
+		auto request = pendingRequests.find(requestId);
+		if(request == pendingRequests.end()) {
+			continue;
+		}
 		
-		for(int i = 0; i < requests.size(); i++) {
-			if(requests[i].isEmergencyStop) {
-				emergencyStopRequests.push_back(i);
-				continue;
-			}
+		int ownerId = request->second.msg.ownerId;
+		if(roundOwners.count(ownerId) > 0 || hasVotedForOwner(zone, ownerId) || isConflictingInZone(zone, request->second)) {
+			denyRequest(requestId);
+		} else {
+			roundOwners.insert(ownerId);
+			request->second.votes++;
 			
-			if(requests[i].bid > highestBid) {
-				highestBid = requests[i].bid;
-				highestRequestIndex = i;
+			if(request->second.votes == static_cast<int>(request->second.zones.size())) {
+				grantRequest(requestId);
+			} else {
+				z.votedRequests.push_back(requestId);
+				waitingCount++;
 			}
 		}
-		
-		if(!emergencyStopRequests.empty()) {
-			for(int i = 0; i < requests.size(); i++) {
-				if(std::find(emergencyStopRequests.begin(), emergencyStopRequests.end(), i) != emergencyStopRequests.end()) {
-					sendEmergencyStopBroadcastMessage(i);
-				} else {
-					sendDenyMessage(i);		
-				}
-			}			
-		} else {
-			sendReservationBroadcastMessage(highestRequestIndex);
+	}
+	
+	ROS_DEBUG("[Reservation Master] Zone %d round: %lu granted, %lu denied, %d waiting for other zones",
+	          zone, grantedRequestCount - grantedBefore, deniedRequestCount - deniedBefore, waitingCount);
+	logRequestTotals();
+}
 
-			// Send deny to others
-			for(int i = 0; i < requests.size(); i++) {
-				if(i != highestRequestIndex) {
-					sendDenyMessage(i);
-				}
+void ReservationMaster::resolveEmergencyStops() {
+	if(emergencyStopRequests.empty()) {
+		return;
+	}
+	
+	std::vector<unsigned long> emergencyStops;
+	emergencyStops.swap(emergencyStopRequests);
+	unsigned long deniedBefore = deniedRequestCount;
+	
+	for(unsigned long emergencyStopId : emergencyStops) {
+		int ownerId = pendingRequests.at(emergencyStopId).msg.ownerId;
+		std::vector<int> emergencyStopZones = pendingRequests.at(emergencyStopId).zones;
+		grantRequest(emergencyStopId);
+		
+		// Requests in the zones of the emergency stop were planned without it, other requests of its owner are outdated
+		std::vector<unsigned long> outdatedRequests;
+		for(int zone : emergencyStopZones) {
+			outdatedRequests.insert(outdatedRequests.end(), zones[zone].roundRequests.begin(), zones[zone].roundRequests.end());
+			outdatedRequests.insert(outdatedRequests.end(), zones[zone].votedRequests.begin(), zones[zone].votedRequests.end());
+		}
+		for(const auto& request : pendingRequests) {
+			if(request.second.msg.ownerId == ownerId && !request.second.msg.isEmergencyStop) {
+				outdatedRequests.push_back(request.first);
 			}
 		}
+		
+		for(unsigned long requestId : outdatedRequests) {
+			if(pendingRequests.count(requestId) > 0) {
+				denyRequest(requestId);
+			}
+		}
+	}
+	
+	ROS_DEBUG("[Reservation Master] %lu emergency stops, %lu requests denied", emergencyStops.size(), deniedRequestCount - deniedBefore);
+	logRequestTotals();
+}
 
-		requests.clear();
-	}	
+bool ReservationMaster::isEventDriven() const {
+	return eventDriven;
 }
 
 void ReservationMaster::reservationRequestCallback(const auto_smart_factory::ReservationRequest& msg) {
-	requests.push_back(msg);	
+	unsigned long requestId = nextRequestId++;
+	PendingRequest& request = pendingRequests[requestId];
+	request.msg = msg;
+	request.reservations = getReservationsFromRequest(msg);
+	request.zones = zoneLayout.getZones(request.reservations, 0);
+	request.receiveTime = ros::WallTime::now().toSec();
+	if(request.zones.empty()) {
+		// Only removes the reservations of the owner, any zone can vote for it
+		request.zones.push_back(0);
+	}
+	
+	if(msg.isEmergencyStop) {
+		emergencyStopRequests.push_back(requestId);
+		if(eventDriven) {
+			resolveEmergencyStops();
+		}
+		return;
+	}
+	
+	for(int zone : request.zones) {
+		zones[zone].roundRequests.push_back(requestId);
+		
+		if(eventDriven && zones[zone].roundRequests.size() == 1) {
+			zones[zone].collectionWindowTimer = pn.createWallTimer(ros::WallDuration(collectionWindow), [this, zone](const ros::WallTimerEvent& event) {
+				resolveRound(zone);
+			}, true);
+		}
+	}
 }
 
-void ReservationMaster::sendDenyMessage(int requestIndex) {
-	//ROS_INFO("[Reservation Master] Agent %d lost auction", requests[i].ownerId);
-	auto_smart_factory::ReservationBroadcast msg;
-	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(false);
-	msg.ownerId = requests[requestIndex].ownerId;
-	reservationBroadcastPublisher.publish(msg);
+bool ReservationMaster::reservationSnapshotCallback(auto_smart_factory::GetReservationSnapshot::Request& req, auto_smart_factory::GetReservationSnapshot::Response& res) {
+	double now = ros::Time::now().toSec();
+	
+	for(const auto& grant : grants) {
+		std::vector<Rectangle> liveReservations;
+		std::vector<int> requestedGrantZones;
+		std::set_intersection(grant.second.zones.begin(), grant.second.zones.end(), req.zones.begin(), req.zones.end(), std::back_inserter(requestedGrantZones));
+		
+		// The requester does not need reservations outside its zones, it drops the ones it knows
+		if(req.zones.empty() || !requestedGrantZones.empty()) {
+			for(const Rectangle& r : grant.second.reservations) {
+				if(r.getEndTime() >= now) {
+					liveReservations.push_back(r);
+				}
+			}
+		}
+		
+		auto_smart_factory::ReservationBroadcast msg;
+		msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
+		msg.isEmergencyStop = static_cast<unsigned char>(false);
+		msg.ownerId = grant.first;
+		msg.epoch = epoch;
+		msg.broadcastSequence = grant.second.broadcastSequence;
+		msg.zone = -1;
+		ReservationBroadcastCodec::encode(msg, std::vector<int>(), liveReservations, now);
+		res.reservations.push_back(msg);
+	}
+	
+	res.epoch = epoch;
+	res.broadcastSequence = broadcastSequence;
+	for(int zone : req.zones) {
+		res.zoneBroadcastSequences.push_back(zone >= 0 && zone < static_cast<int>(zones.size()) ? zones[zone].broadcastSequence : 0);
+	}
+	
+	return true;
 }
 
-void ReservationMaster::sendReservationBroadcastMessage(int requestIndex) {
-	//ROS_INFO("[Reservation Master] Agent %d won auction", requests[highestRequestIndex].ownerId);
+void ReservationMaster::grantRequest(unsigned long requestId) {
+	const PendingRequest& request = pendingRequests.at(requestId);
+	int ownerId = request.msg.ownerId;
+	Grant& grant = grants[ownerId];
+	
+	// The owner reuses the sequence number of a reservation only for an unchanged reservation
+	std::unordered_set<ReservationId> grantedIds;
+	for(const Rectangle& r : grant.reservations) {
+		grantedIds.insert(r.getId());
+	}
+	std::vector<int> keptSequences;
+	std::vector<Rectangle> newReservations;
+	for(const Rectangle& r : request.reservations) {
+		if(grantedIds.count(r.getId()) > 0) {
+			keptSequences.push_back(r.getSequence());
+		} else {
+			newReservations.push_back(r);
+		}
+	}
+	
+	for(int zone : ReservationZones::unite(grant.zones, request.zones)) {
+		replaceZoneReservations(zone, ownerId, request.reservations);
+	}
+	
+	double now = ros::Time::now().toSec();
 	auto_smart_factory::ReservationBroadcast msg;
 	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
-	msg.isEmergencyStop = static_cast<unsigned char>(false);
-	msg.ownerId = requests[requestIndex].ownerId;
-	msg.reservations = requests[requestIndex].reservations;
-	reservationBroadcastPublisher.publish(msg);
+	msg.isEmergencyStop = request.msg.isEmergencyStop;
+	msg.ownerId = ownerId;
+	msg.baseSequence = grant.broadcastSequence;
+	ReservationBroadcastCodec::encode(msg, keptSequences, newReservations, now);
+	publishBroadcast(msg, grant.zones);
+	
+	// Agents in zones the owner did not touch before may not know the kept reservations
+	std::vector<int> enteredZones;
+	std::set_difference(request.zones.begin(), request.zones.end(), grant.zones.begin(), grant.zones.end(), std::back_inserter(enteredZones));
+	if(zoneLayout.isPartitioned() && !enteredZones.empty()) {
+		auto_smart_factory::ReservationBroadcast replacement = msg;
+		replacement.baseSequence = 0;
+		ReservationBroadcastCodec::encode(replacement, std::vector<int>(), request.reservations, now);
+		publishZoneBroadcast(replacement, enteredZones);
+	}
+	
+	for(int zone : ReservationZones::unite(grant.zones, request.zones)) {
+		zones[zone].grantSequence = msg.broadcastSequence;
+	}
+	
+	grant.reservations = request.reservations;
+	grant.zones = request.zones;
+	grant.broadcastSequence = msg.broadcastSequence;
+	
+	grantedRequestCount++;
+	finishRequest(requestId);
 }
 
-void ReservationMaster::sendEmergencyStopBroadcastMessage(int requestIndex) {
-	//ROS_INFO("[Reservation Master] Sending emergency stop for agent %d", requests[requestIndex].ownerId);
+void ReservationMaster::denyRequest(unsigned long requestId) {
+	const PendingRequest& request = pendingRequests.at(requestId);
+	
 	auto_smart_factory::ReservationBroadcast msg;
-	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
-	msg.isEmergencyStop = static_cast<unsigned char>(true);
-	msg.ownerId = requests[requestIndex].ownerId;
-	msg.reservations = requests[requestIndex].reservations;
+	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(false);
+	msg.ownerId = request.msg.ownerId;
+	
+	auto grant = grants.find(request.msg.ownerId);
+	publishBroadcast(msg, grant != grants.end() ? ReservationZones::unite(grant->second.zones, request.zones) : request.zones);
+	
+	deniedRequestCount++;
+	finishRequest(requestId);
+}
+
+void ReservationMaster::finishRequest(unsigned long requestId) {
+	auto request = pendingRequests.find(requestId);
+	
+	for(int zone : request->second.zones) {
+		std::vector<unsigned long>& roundRequests = zones[zone].roundRequests;
+		roundRequests.erase(std::remove(roundRequests.begin(), roundRequests.end(), requestId), roundRequests.end());
+		std::vector<unsigned long>& votedRequests = zones[zone].votedRequests;
+		votedRequests.erase(std::remove(votedRequests.begin(), votedRequests.end(), requestId), votedRequests.end());
+	}
+	
+	recordRequestLatency(ros::WallTime::now().toSec() - request->second.receiveTime);
+	pendingRequests.erase(request);
+}
+
+void ReservationMaster::publishBroadcast(auto_smart_factory::ReservationBroadcast& msg, const std::vector<int>& broadcastZones) {
+	msg.epoch = epoch;
+	msg.broadcastSequence = ++broadcastSequence;
+	msg.zone = -1;
+	msg.zoneSequence = broadcastSequence;
 	reservationBroadcastPublisher.publish(msg);
+	
+	if(zoneLayout.isPartitioned()) {
+		publishZoneBroadcast(msg, broadcastZones);
+	}
+}
+
+void ReservationMaster::publishZoneBroadcast(auto_smart_factory::ReservationBroadcast msg, const std::vector<int>& broadcastZones) {
+	for(int zone : broadcastZones) {
+		msg.zone = zone;
+		msg.zoneSequence = ++zones[zone].broadcastSequence;
+		zones[zone].broadcastPublisher.publish(msg);
+	}
+}
+
+std::vector<Rectangle> ReservationMaster::getReservationsFromRequest(const auto_smart_factory::ReservationRequest& msg) {
+	std::vector<Rectangle> requestedReservations;
+	for(const auto& r : msg.reservations) {
+		requestedReservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId, r.sequence, static_cast<RectangleShape>(r.shape), r.holdDuration);
+	}
+	
+	return requestedReservations;
+}
+
+bool ReservationMaster::isConflictingInZone(int zone, const PendingRequest& request) const {
+	const Zone& z = zones[zone];
+	int ownerId = request.msg.ownerId;
+	
+	// Sequence numbers of an earlier epoch say nothing about the grants of this one
+	uint64_t knownSequence = request.msg.knownEpoch == epoch ? request.msg.knownBroadcastSequence : 0;
+	
+	for(const Rectangle& requested : request.reservations) {
+		bool isConflicting = false;
+		if(z.grantSequence > knownSequence) {
+			z.reservations.forEachReservationInBox(requested.getMinXInflated(), requested.getMaxXInflated(), requested.getMinYInflated(), requested.getMaxYInflated(),
+			                                       requested.getStartTime(), requested.getEndTime(), [&](int slot, const Rectangle& granted) {
+				isConflicting = granted.getOwnerId() != ownerId && grants.at(granted.getOwnerId()).broadcastSequence > knownSequence &&
+				                Math::doReservationsConflict(requested, granted);
+				return !isConflicting;
+			});
+		}
+		
+		if(isConflicting) {
+			return true;
+		}
+		
+		// Requests waiting for other zones hold their reservations until they are granted or denied
+		for(unsigned long votedId : z.votedRequests) {
+			for(const Rectangle& voted : pendingRequests.at(votedId).reservations) {
+				if(Math::doReservationsConflict(requested, voted)) {
+					return true;
+				}
+			}
+		}
+	}
+	
+	return false;
+}
+
+bool ReservationMaster::hasVotedForOwner(int zone, int ownerId) const {
+	for(unsigned long votedId : zones[zone].votedRequests) {
+		if(pendingRequests.at(votedId).msg.ownerId == ownerId) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void ReservationMaster::replaceZoneReservations(int zone, int ownerId, const std::vector<Rectangle>& reservations) {
+	ReservationTable& table = zones[zone].reservations;
+	
+	for(int slot = 0; slot < table.getSlotCount(); slot++) {
+		if(table.isUsed(slot) && table.get(slot).getOwnerId() == ownerId) {
+			table.remove(slot);
+		}
+	}
+	
+	for(const Rectangle& r : reservations) {
+		std::vector<int> reservationZones = zoneLayout.getZonesInBox(r.getMinXInflated(), r.getMaxXInflated(), r.getMinYInflated(), r.getMaxYInflated());
+		if(std::binary_search(reservationZones.begin(), reservationZones.end(), zone)) {
+			table.add(r);
+		}
+	}
+}
+
+void ReservationMaster::recordRequestLatency(double latency) {
+	if(requestLatencies.size() < requestLatencyWindow) {
+		requestLatencies.push_back(latency);
+	} else {
+		requestLatencies[requestLatencyCount % requestLatencyWindow] = latency;
+	}
+	requestLatencyCount++;
+}
+
+void ReservationMaster::logRequestTotals() {
+	double medianLatency = publishRequestLatencyMedian();
+	
+	ROS_INFO_THROTTLE(requestTotalsLogPeriod, "[Reservation Master] Total: %lu granted, %lu denied, median latency %.1fms",
+	                  grantedRequestCount, deniedRequestCount, medianLatency * 1000);
+}
+
+double ReservationMaster::publishRequestLatencyMedian() {
+	if(requestLatencies.empty()) {
+		return 0;
+	}
+	
+	std::vector<double> sortedLatencies = requestLatencies;
+	auto median = sortedLatencies.begin() + sortedLatencies.size() / 2;
+	std::nth_element(sortedLatencies.begin(), median, sortedLatencies.end());
+	
+	std_msgs::Float64 msg;
+	msg.data = *median;
+	requestLatencyPublisher.publish(msg);
+	
+	return msg.data;
 }
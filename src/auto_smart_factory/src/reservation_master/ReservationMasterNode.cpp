@@ -6,8 +6,16 @@ int main(int argc, char** argv) {
 	ros::NodeHandle nh;
 
 	ReservationMaster reservationMaster;
+	if(!ros::ok()) {
+		return 1;
+	}
 	ROS_INFO("Reservation master ready!");
 
+	if(reservationMaster.isEventDriven()) {
+		ros::spin();
+		return 0;
+	}
+
 	ros::Rate r(10);
 	while(ros::ok()) {
 		reservationMaster.update();